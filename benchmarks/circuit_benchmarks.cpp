@@ -0,0 +1,83 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cmath>
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+
+#include "circuit.h"
+#include "types.h"
+
+template <typename T>
+static void BM_Circuit_measure(benchmark::State& state) {
+  const uint64_t dim = state.range(0);
+  qengine::Circuit<T> circuit(1, dim);
+  for (uint64_t i = 1; i < dim; ++i)
+    circuit.applyX(0, i, std::sqrt(T(1.0) / dim),
+                   std::sqrt(static_cast<T>(dim - i) / dim));
+
+  for (auto _ : state) {
+    circuit.measure(0, 0);
+    benchmark::DoNotOptimize(circuit.get_creg(0));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_Circuit_measure, float)
+  ->RangeMultiplier(8)->Range(64, 1 << 18);
+BENCHMARK_TEMPLATE(BM_Circuit_measure, double)
+  ->RangeMultiplier(8)->Range(64, 1 << 18);
+
+// The fingerprint circuit of examples/example.cpp: state |psi(a)> followed
+// by the reverse test against word b. Arguments are n and epsilon * 100.
+template <typename T>
+static void BM_Circuit_fingerprint(benchmark::State& state) {
+  const uint64_t n = state.range(0);
+  const double epsilon = state.range(1) / 100.0;
+  const auto dim = static_cast<uint64_t>(std::llround(n / (epsilon * epsilon)));
+  const uint64_t word_a = 15;
+  const uint64_t word_b = 15;
+
+  for (auto _ : state) {
+    qengine::Circuit<T> circuit(1, dim);
+    for (uint64_t i = 1; i < dim; ++i)
+      circuit.applyX(0, i, std::sqrt(T(1.0) / dim),
+                     std::sqrt(static_cast<T>(dim - i) / dim));
+    for (uint64_t i = 0; i < dim; ++i)
+      circuit.applyZ(0, i, static_cast<double>(word_a * i) / n);
+    for (uint64_t i = 0; i < dim; ++i)
+      circuit.applyZconjugate(
+        0, dim - i - 1, static_cast<double>(word_b * (dim - i - 1)) / n);
+    for (uint64_t i = dim - 1; i > 0; --i)
+      circuit.applyXconjugate(0, i, std::sqrt(T(1.0) / dim),
+                              std::sqrt(static_cast<T>(dim - i) / dim));
+    circuit.measure(0, 0);
+    benchmark::DoNotOptimize(circuit.get_creg(0));
+  }
+  state.counters["dim"] = benchmark::Counter(
+    dim, benchmark::Counter::kAvgThreads);
+  state.SetItemsProcessed(state.iterations() * (4 * dim - 1));
+}
+BENCHMARK_TEMPLATE(BM_Circuit_fingerprint, float)
+  ->ArgsProduct({{8, 16, 32}, {20, 10, 5}})->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Circuit_fingerprint, double)
+  ->ArgsProduct({{8, 16, 32}, {20, 10, 5}})->ThreadRange(1, 4)->UseRealTime();
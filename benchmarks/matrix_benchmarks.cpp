@@ -0,0 +1,84 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstdint>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "types.h"
+
+template <typename T>
+using Mat = qengine::Matrix<qengine::Cmplx<T>>;
+
+template <typename T>
+static Mat<T> make_mat(uint64_t n) {
+  Mat<T> mat(n, n);
+  for (uint64_t j = 0; j < n; ++j)
+    for (uint64_t i = 0; i < n; ++i)
+      mat(i, j) = qengine::Cmplx<T>(T(1.0) / (1 + i + j), T(1.0) / (1 + i));
+  return mat;
+}
+
+template <typename T>
+static void BM_Matrix_gemm(benchmark::State& state) {
+  const uint64_t n = state.range(0);
+  const auto A = make_mat<T>(n);
+  const auto B = make_mat<T>(n);
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(A * B);
+  state.counters["GFLOPS"] = benchmark::Counter(
+    8.0 * n * n * n * state.iterations() / 1e9, benchmark::Counter::kIsRate);
+}
+BENCHMARK_TEMPLATE(BM_Matrix_gemm, float)->RangeMultiplier(2)->Range(16, 256);
+BENCHMARK_TEMPLATE(BM_Matrix_gemm, double)->RangeMultiplier(2)->Range(16, 256);
+
+template <typename T>
+static void BM_Matrix_gemv(benchmark::State& state) {
+  const uint64_t n = state.range(0);
+  const auto A = make_mat<T>(n);
+  const qengine::CVec<T> b(n, qengine::Cmplx<T>(1.0, 0.5));
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(A * b);
+  state.SetBytesProcessed(
+    state.iterations() * n * n * sizeof(qengine::Cmplx<T>));
+}
+BENCHMARK_TEMPLATE(BM_Matrix_gemv, float)->RangeMultiplier(4)->Range(16, 4096);
+BENCHMARK_TEMPLATE(BM_Matrix_gemv, double)->RangeMultiplier(4)->Range(16, 4096);
+
+template <typename T>
+static void BM_Matrix_tensor_times(benchmark::State& state) {
+  const uint64_t n = state.range(0);
+  const auto A = make_mat<T>(n);
+  const auto B = make_mat<T>(n);
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(A.tensor_times(B));
+  state.SetBytesProcessed(
+    state.iterations() * n * n * n * n * sizeof(qengine::Cmplx<T>));
+}
+BENCHMARK_TEMPLATE(BM_Matrix_tensor_times, float)
+  ->RangeMultiplier(2)->Range(4, 32);
+BENCHMARK_TEMPLATE(BM_Matrix_tensor_times, double)
+  ->RangeMultiplier(2)->Range(4, 32);
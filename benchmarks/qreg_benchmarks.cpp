@@ -0,0 +1,118 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cmath>
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+
+#include "qreg.h"
+#include "types.h"
+
+template <typename T>
+static void BM_QReg_applyX_ladder(benchmark::State& state) {
+  const uint64_t dim = state.range(0);
+  qengine::QReg<T> qreg(dim);
+  const T x = std::sqrt(T(1.0) / dim);
+
+  for (auto _ : state) {
+    for (uint64_t i = 1; i < dim; ++i)
+      qreg.applyX(i, x, std::sqrt(static_cast<T>(dim - i) / dim));
+    benchmark::DoNotOptimize(qreg.data());
+  }
+  state.SetItemsProcessed(state.iterations() * (dim - 1));
+  state.SetBytesProcessed(
+    state.iterations() * (dim - 1) * 4 * sizeof(qengine::Cmplx<T>));
+}
+BENCHMARK_TEMPLATE(BM_QReg_applyX_ladder, float)
+  ->RangeMultiplier(8)->Range(64, 1 << 18)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_QReg_applyX_ladder, double)
+  ->RangeMultiplier(8)->Range(64, 1 << 18)->ThreadRange(1, 4)->UseRealTime();
+
+template <typename T>
+static void BM_QReg_applyZ_ladder(benchmark::State& state) {
+  const uint64_t dim = state.range(0);
+  qengine::QReg<T> qreg(dim);
+
+  for (auto _ : state) {
+    for (uint64_t i = 0; i < dim; ++i)
+      qreg.applyZ(i, 0.1 * i);
+    benchmark::DoNotOptimize(qreg.data());
+  }
+  state.SetItemsProcessed(state.iterations() * dim);
+  state.SetBytesProcessed(
+    state.iterations() * dim * 2 * sizeof(qengine::Cmplx<T>));
+}
+BENCHMARK_TEMPLATE(BM_QReg_applyZ_ladder, float)
+  ->RangeMultiplier(8)->Range(64, 1 << 18)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_QReg_applyZ_ladder, double)
+  ->RangeMultiplier(8)->Range(64, 1 << 18)->ThreadRange(1, 4)->UseRealTime();
+
+template <typename T>
+static void BM_QReg_apply_dense(benchmark::State& state) {
+  const uint64_t dim = state.range(0);
+  qengine::QReg<T> qreg(dim);
+  qengine::CMat<T> mat(dim);
+  for (uint64_t j = 0; j < dim; ++j)
+    mat((j + 1) % dim, j) = 1.0;
+
+  for (auto _ : state) {
+    qreg.apply(mat);
+    benchmark::DoNotOptimize(qreg.data());
+  }
+  state.SetItemsProcessed(state.iterations() * 8 * dim * dim);
+}
+BENCHMARK_TEMPLATE(BM_QReg_apply_dense, float)
+  ->RangeMultiplier(4)->Range(16, 1024);
+BENCHMARK_TEMPLATE(BM_QReg_apply_dense, double)
+  ->RangeMultiplier(4)->Range(16, 1024);
+
+template <typename T>
+static void BM_QReg_probabilities(benchmark::State& state) {
+  const uint64_t dim = state.range(0);
+  qengine::QReg<T> qreg(dim);
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(qreg.probabilities());
+  state.SetBytesProcessed(
+    state.iterations() * dim * (sizeof(qengine::Cmplx<T>) + sizeof(T)));
+}
+BENCHMARK_TEMPLATE(BM_QReg_probabilities, float)
+  ->RangeMultiplier(8)->Range(64, 1 << 21);
+BENCHMARK_TEMPLATE(BM_QReg_probabilities, double)
+  ->RangeMultiplier(8)->Range(64, 1 << 21);
+
+template <typename T>
+static void BM_QReg_braket_product(benchmark::State& state) {
+  const uint64_t dim = state.range(0);
+  qengine::QReg<T> bra(dim);
+  qengine::QReg<T> ket(dim);
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(bra.braket_product(ket));
+  state.SetBytesProcessed(
+    state.iterations() * dim * 2 * sizeof(qengine::Cmplx<T>));
+}
+BENCHMARK_TEMPLATE(BM_QReg_braket_product, float)
+  ->RangeMultiplier(8)->Range(64, 1 << 21);
+BENCHMARK_TEMPLATE(BM_QReg_braket_product, double)
+  ->RangeMultiplier(8)->Range(64, 1 << 21);
@@ -48,18 +48,19 @@ int main(int argc, char const *argv[]) {
   const uint64_t nreg = 1;
   qengine::Circuit<double> circuit(nreg, dim);
 
-  const auto applyF0 = [&dim, &circuit] (uint64_t idx) -> void {
-    for (uint64_t i = 1ULL; i < dim; ++i) {
-      auto b = std::sqrt(static_cast<double>(dim - i) / dim);
-      circuit.applyX(idx, i, std::sqrt(1.0 / dim), b);
-    }
+  // rotation i acts on levels i - 1, i with x = sqrt(1 / dim),
+  // y = sqrt((dim - i) / dim)
+  const std::vector<double> f0_x(dim - 1, std::sqrt(1.0 / dim));
+  std::vector<double> f0_y(dim - 1);
+  for (uint64_t i = 1ULL; i < dim; ++i)
+    f0_y[i - 1] = std::sqrt(static_cast<double>(dim - i) / dim);
+
+  const auto applyF0 = [&] (uint64_t idx) -> void {
+    circuit.apply_givens_ladder(idx, f0_x, f0_y);
   };
 
-  const auto applyF0conjugate = [&dim, &circuit] (uint64_t idx) -> void {
-    for (uint64_t i = dim - 1; i > 0ULL; --i) {
-      auto b = std::sqrt(static_cast<double>(dim - i) / dim);
-      circuit.applyXconjugate(idx, i, std::sqrt(1.0 / dim), b);
-    }
+  const auto applyF0conjugate = [&] (uint64_t idx) -> void {
+    circuit.apply_givens_ladder_conjugate(idx, f0_x, f0_y);
   };
 
   std::cout << "n   = " << n << "\n";
@@ -75,15 +76,13 @@ int main(int argc, char const *argv[]) {
 
   // Применение хеш-функции
   // Получаем состяние $\ket{\psi(a)}$
+  // k_i = i, so the phase word * k_i / n is linear in the level
   applyF0(0);
-  for (uint64_t i = 0; i < dim; ++i)
-    circuit.applyZ(0, i, static_cast<double>(word_a * k[i]) / n);
+  circuit.applyPhaseLinear(0, static_cast<double>(word_a) / n);
 
 
   // Reverse-тест
-  for (uint64_t i = 0; i < dim; ++i)
-    circuit.applyZconjugate(
-      0, dim - i - 1, static_cast<double>(word_b * k[dim - i - 1]) / n);
+  circuit.applyPhaseLinearConjugate(0, static_cast<double>(word_b) / n);
   applyF0conjugate(0);
 
   circuit.measure(0, 0);
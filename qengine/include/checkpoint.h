@@ -0,0 +1,401 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_INCLUDE_CHECKPOINT_H_
+#define QENGINE_INCLUDE_CHECKPOINT_H_
+
+#if defined(__unix__) || defined(__APPLE__)
+#define QENGINE_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "qreg.h"
+#include "types.h"
+
+#include <gsl/gsl_assert>
+
+namespace qengine {
+inline namespace io {
+
+// File layout (all offsets are from the beginning of the file):
+//   CheckpointHeader
+//   RegisterHeader x nreg
+//   CReg x ncregs
+//   RNG state (text form of std::mt19937), rng_bytes long
+//   amplitudes of every register, each block aligned to kCheckpointAlign
+// Integers and amplitudes are stored in the byte order of the writer;
+// `endian` lets a reader on another host reject the file.
+
+constexpr char kCheckpointMagic[8] = {'Q', 'E', 'N', 'G', 'C', 'K', 'P', 'T'};
+constexpr uint32_t kCheckpointVersion = 1;
+constexpr uint32_t kCheckpointEndian = 0x01020304;
+constexpr uint64_t kCheckpointAlign = 64;
+
+struct CheckpointHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t endian;
+  uint32_t precision;
+  uint32_t nreg;
+  uint64_t ncregs;
+  uint64_t rng_bytes;
+  uint64_t reserved[3];
+};
+
+struct RegisterHeader {
+  uint64_t sdim;
+  uint64_t size;
+  uint64_t dim;
+  uint64_t offset;
+  uint64_t reserved[4];
+};
+
+static_assert(sizeof(CheckpointHeader) == 64, "unexpected header padding");
+static_assert(sizeof(RegisterHeader) == 64, "unexpected header padding");
+
+inline uint64_t align_up(uint64_t offset) {
+  return (offset + kCheckpointAlign - 1) / kCheckpointAlign * kCheckpointAlign;
+}
+
+template <typename T>
+struct CheckpointData {
+  std::vector<QReg<T>> qregs;
+  std::vector<CReg> cregs;
+  std::string rng_state;
+};
+
+template <typename T>
+void write_checkpoint(
+    const std::string& path, const std::vector<const QReg<T>*>& qregs,
+    const std::vector<CReg>& cregs, const std::string& rng_state) {
+  CheckpointHeader header{};
+  std::memcpy(header.magic, kCheckpointMagic, sizeof(header.magic));
+  header.version = kCheckpointVersion;
+  header.endian = kCheckpointEndian;
+  header.precision = sizeof(T);
+  header.nreg = static_cast<uint32_t>(qregs.size());
+  header.ncregs = cregs.size();
+  header.rng_bytes = rng_state.size();
+
+  uint64_t offset = sizeof(CheckpointHeader)
+                  + qregs.size() * sizeof(RegisterHeader)
+                  + cregs.size() * sizeof(CReg)
+                  + rng_state.size();
+  std::vector<RegisterHeader> reg_headers(qregs.size());
+  for (uint64_t r = 0; r < qregs.size(); ++r) {
+    offset = align_up(offset);
+    reg_headers[r].sdim = qregs[r]->sdim();
+    reg_headers[r].size = qregs[r]->size();
+    reg_headers[r].dim = qregs[r]->dim();
+    reg_headers[r].offset = offset;
+    offset += qregs[r]->dim() * sizeof(Cmplx<T>);
+  }
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out)
+    throw std::runtime_error("qengine: cannot open checkpoint " + path);
+
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(reg_headers.data()),
+            reg_headers.size() * sizeof(RegisterHeader));
+  out.write(reinterpret_cast<const char*>(cregs.data()),
+            cregs.size() * sizeof(CReg));
+  out.write(rng_state.data(), rng_state.size());
+
+  const char zeros[kCheckpointAlign] = {};
+  for (uint64_t r = 0; r < qregs.size(); ++r) {
+    const uint64_t pos = static_cast<uint64_t>(out.tellp());
+    out.write(zeros, reg_headers[r].offset - pos);
+    qregs[r]->write_amplitudes(out);
+  }
+
+  if (!out)
+    throw std::runtime_error("qengine: cannot write checkpoint " + path);
+}
+
+template <typename T>
+void check_header(const CheckpointHeader& header, const std::string& path) {
+  if (std::memcmp(header.magic, kCheckpointMagic, sizeof(header.magic)) != 0)
+    throw std::runtime_error("qengine: not a checkpoint " + path);
+  if (header.version != kCheckpointVersion)
+    throw std::runtime_error("qengine: unsupported checkpoint version " + path);
+  if (header.endian != kCheckpointEndian)
+    throw std::runtime_error("qengine: checkpoint byte order mismatch " + path);
+  if (header.precision != sizeof(T))
+    throw std::runtime_error("qengine: checkpoint precision mismatch " + path);
+}
+
+// Whether the register, creg and RNG tables fit in a file of `length`
+// bytes. Each size is compared with what is left of the file, so a corrupt
+// count cannot overflow the bound.
+inline bool tables_fit(const CheckpointHeader& header, uint64_t length) {
+  if (length < sizeof(CheckpointHeader))
+    return false;
+  uint64_t tail = length - sizeof(CheckpointHeader);
+  if (header.nreg > tail / sizeof(RegisterHeader))
+    return false;
+  tail -= header.nreg * sizeof(RegisterHeader);
+  if (header.ncregs > tail / sizeof(CReg))
+    return false;
+  tail -= header.ncregs * sizeof(CReg);
+  return header.rng_bytes <= tail;
+}
+
+// Whether a register has sdim * size == dim amplitudes, all inside a file
+// of `length` bytes.
+template <typename T>
+bool register_fits(const RegisterHeader& reg, uint64_t length) {
+  return reg.size > 0 && reg.dim % reg.size == 0
+         && reg.dim / reg.size == reg.sdim && reg.offset <= length
+         && reg.dim <= (length - reg.offset) / sizeof(Cmplx<T>);
+}
+
+template <typename T>
+CheckpointData<T> read_checkpoint(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+    throw std::runtime_error("qengine: cannot open checkpoint " + path);
+
+  CheckpointHeader header;
+  in.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!in)
+    throw std::runtime_error("qengine: truncated checkpoint " + path);
+  check_header<T>(header, path);
+
+  // nothing is sized from the header before it is checked against the file
+  in.seekg(0, std::ios::end);
+  const uint64_t length = static_cast<uint64_t>(in.tellg());
+  if (!tables_fit(header, length))
+    throw std::runtime_error("qengine: truncated checkpoint " + path);
+  in.seekg(sizeof(CheckpointHeader));
+
+  std::vector<RegisterHeader> reg_headers(header.nreg);
+  in.read(reinterpret_cast<char*>(reg_headers.data()),
+          reg_headers.size() * sizeof(RegisterHeader));
+  for (const auto & reg : reg_headers)
+    if (!register_fits<T>(reg, length))
+      throw std::runtime_error("qengine: truncated checkpoint " + path);
+
+  CheckpointData<T> data;
+  data.cregs.resize(header.ncregs);
+  in.read(reinterpret_cast<char*>(data.cregs.data()),
+          data.cregs.size() * sizeof(CReg));
+  data.rng_state.resize(header.rng_bytes);
+  in.read(&data.rng_state[0], data.rng_state.size());
+
+  data.qregs.reserve(header.nreg);
+  for (const auto & reg : reg_headers) {
+    data.qregs.emplace_back(reg.sdim, reg.size);
+    in.seekg(reg.offset);
+    data.qregs.back().read_amplitudes(in);
+  }
+
+  if (!in)
+    throw std::runtime_error("qengine: truncated checkpoint " + path);
+  return data;
+}
+
+template <typename T>
+void save_checkpoint(const std::string& path, const QReg<T>& qreg) {
+  write_checkpoint<T>(path, {&qreg}, {}, {});
+}
+
+template <typename T>
+QReg<T> load_checkpoint(const std::string& path) {
+  CheckpointData<T> data = read_checkpoint<T>(path);
+  Expects(data.qregs.size() == 1);
+  return std::move(data.qregs[0]);
+}
+
+// Read-only view of a checkpoint file. Where mmap is available the file is
+// mapped shared, so amplitudes are read in place and several processes
+// can map one prepared state; otherwise the file is read into memory.
+template <typename T>
+class MappedCheckpoint {
+public:
+  MappedCheckpoint<T>() = delete;
+  ~MappedCheckpoint<T>();
+  MappedCheckpoint<T>(const MappedCheckpoint<T>&) = delete;
+  MappedCheckpoint<T>(MappedCheckpoint<T>&&) = delete;
+  MappedCheckpoint<T>& operator=(const MappedCheckpoint<T>&) = delete;
+  MappedCheckpoint<T>& operator=(MappedCheckpoint<T>&&) = delete;
+
+  explicit MappedCheckpoint<T>(const std::string& path);
+
+  uint64_t nreg() const;
+  uint64_t sdim(uint64_t idx_qreg) const;
+  uint64_t size(uint64_t idx_qreg) const;
+  uint64_t dim(uint64_t idx_qreg) const;
+  const Cmplx<T>* amplitudes(uint64_t idx_qreg) const;
+  QReg<T> qreg(uint64_t idx_qreg) const;
+
+  std::vector<CReg> cregs() const;
+  std::string rng_state() const;
+
+private:
+  void release();
+  const RegisterHeader& reg_header(uint64_t idx_qreg) const;
+
+  const char* base_;
+  uint64_t length_;
+  std::vector<char> buffer_;
+};
+
+template <typename T>
+MappedCheckpoint<T>::MappedCheckpoint(const std::string& path)
+  : base_{nullptr}, length_{0} {
+#ifdef QENGINE_HAS_MMAP
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("qengine: cannot open checkpoint " + path);
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size < 0) {
+    ::close(fd);
+    throw std::runtime_error("qengine: cannot stat checkpoint " + path);
+  }
+  length_ = static_cast<uint64_t>(st.st_size);
+
+  void* addr = length_ > 0
+             ? ::mmap(nullptr, length_, PROT_READ, MAP_SHARED, fd, 0)
+             : MAP_FAILED;
+  ::close(fd);
+  if (addr == MAP_FAILED)
+    throw std::runtime_error("qengine: cannot map checkpoint " + path);
+  base_ = static_cast<const char*>(addr);
+#else
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  if (!in)
+    throw std::runtime_error("qengine: cannot open checkpoint " + path);
+  length_ = static_cast<uint64_t>(in.tellg());
+  buffer_.resize(length_ + kCheckpointAlign);
+  char* aligned = buffer_.data() + (kCheckpointAlign
+      - reinterpret_cast<uintptr_t>(buffer_.data()) % kCheckpointAlign);
+  in.seekg(0);
+  in.read(aligned, length_);
+  base_ = aligned;
+#endif
+
+  if (length_ < sizeof(CheckpointHeader)) {
+    release();
+    throw std::runtime_error("qengine: truncated checkpoint " + path);
+  }
+
+  const auto & header = *reinterpret_cast<const CheckpointHeader*>(base_);
+  try {
+    check_header<T>(header, path);
+    if (!tables_fit(header, length_))
+      throw std::runtime_error("qengine: truncated checkpoint " + path);
+    for (uint64_t r = 0; r < header.nreg; ++r)
+      if (!register_fits<T>(reg_header(r), length_))
+        throw std::runtime_error("qengine: truncated checkpoint " + path);
+  } catch (...) {
+    release();
+    throw;
+  }
+}
+
+template <typename T>
+MappedCheckpoint<T>::~MappedCheckpoint() { release(); }
+
+template <typename T>
+void MappedCheckpoint<T>::release() {
+#ifdef QENGINE_HAS_MMAP
+  if (base_ != nullptr)
+    ::munmap(const_cast<char*>(base_), length_);
+#endif
+  base_ = nullptr;
+}
+
+template <typename T>
+const RegisterHeader& MappedCheckpoint<T>::reg_header(uint64_t idx_qreg) const {
+  return reinterpret_cast<const RegisterHeader*>(
+      base_ + sizeof(CheckpointHeader))[idx_qreg];
+}
+
+template <typename T>
+uint64_t MappedCheckpoint<T>::nreg() const {
+  return reinterpret_cast<const CheckpointHeader*>(base_)->nreg;
+}
+
+template <typename T>
+uint64_t MappedCheckpoint<T>::sdim(uint64_t idx_qreg) const {
+  Expects(idx_qreg < nreg());
+  return reg_header(idx_qreg).sdim;
+}
+
+template <typename T>
+uint64_t MappedCheckpoint<T>::size(uint64_t idx_qreg) const {
+  Expects(idx_qreg < nreg());
+  return reg_header(idx_qreg).size;
+}
+
+template <typename T>
+uint64_t MappedCheckpoint<T>::dim(uint64_t idx_qreg) const {
+  Expects(idx_qreg < nreg());
+  return reg_header(idx_qreg).dim;
+}
+
+template <typename T>
+const Cmplx<T>* MappedCheckpoint<T>::amplitudes(uint64_t idx_qreg) const {
+  Expects(idx_qreg < nreg());
+  return reinterpret_cast<const Cmplx<T>*>(
+      base_ + reg_header(idx_qreg).offset);
+}
+
+template <typename T>
+QReg<T> MappedCheckpoint<T>::qreg(uint64_t idx_qreg) const {
+  return QReg<T>(sdim(idx_qreg), size(idx_qreg), amplitudes(idx_qreg));
+}
+
+template <typename T>
+std::vector<CReg> MappedCheckpoint<T>::cregs() const {
+  const auto & header = *reinterpret_cast<const CheckpointHeader*>(base_);
+  const auto first = reinterpret_cast<const CReg*>(
+      base_ + sizeof(CheckpointHeader) + header.nreg * sizeof(RegisterHeader));
+  return std::vector<CReg>(first, first + header.ncregs);
+}
+
+template <typename T>
+std::string MappedCheckpoint<T>::rng_state() const {
+  const auto & header = *reinterpret_cast<const CheckpointHeader*>(base_);
+  const char* first = base_ + sizeof(CheckpointHeader)
+                    + header.nreg * sizeof(RegisterHeader)
+                    + header.ncregs * sizeof(CReg);
+  return std::string(first, header.rng_bytes);
+}
+
+} // namespace io
+} // namespace qengine
+
+#endif // QENGINE_INCLUDE_CHECKPOINT_H_
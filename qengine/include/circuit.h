@@ -23,10 +23,18 @@
 #ifndef QENGINE_INCLUDE_CIRCUIT_H_
 #define QENGINE_INCLUDE_CIRCUIT_H_
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
+#include "checkpoint.h"
+#include "compressed_reg.h"
+#include "profiler.h"
 #include "rand_num_engine.h"
 #include "qreg.h"
 #include "types.h"
@@ -44,7 +52,7 @@ public:
   Circuit<T>& operator=(const Circuit<T>&) = delete;
   Circuit<T>& operator=(Circuit<T>&&) = delete;
 
-  Circuit<T>(uint64_t nreg, uint64_t dim);
+  Circuit<T>(uint64_t nreg, uint64_t dim, uint32_t seed = 1);
 
   std::vector<QReg<T>> qregs() const;
   std::vector<CReg> cregs() const;
@@ -61,26 +69,129 @@ public:
   void applyXconjugate(uint64_t idx_qreg, uint64_t i, T x, T y);
   void applyXconjugate(uint64_t idx_qreg, uint64_t i, Cmplx<T> x, Cmplx<T> y);
   void applyZconjugate(uint64_t idx_qreg, uint64_t i, double tau);
+  void applyDiagonal(uint64_t idx_qreg, const RVec<double>& tau);
+  void applyDiagonal(uint64_t idx_qreg, const CVec<T>& d);
+  void applyPermutation(uint64_t idx_qreg, const std::vector<uint64_t>& perm,
+                        const CVec<T>& d);
+  void applyBanded(
+      uint64_t idx_qreg, uint64_t kl, uint64_t ku, const CVec<T>& band);
+
+  void apply_givens_ladder(
+      uint64_t idx_qreg, const RVec<T>& x, const RVec<T>& y);
+  void apply_givens_ladder(
+      uint64_t idx_qreg, const CVec<T>& x, const CVec<T>& y);
+  void apply_givens_ladder_conjugate(
+      uint64_t idx_qreg, const RVec<T>& x, const RVec<T>& y);
+  void apply_givens_ladder_conjugate(
+      uint64_t idx_qreg, const CVec<T>& x, const CVec<T>& y);
+  void prepare_state(uint64_t idx_qreg, const CVec<T>& amplitudes);
+
+  void applyPhaseLinear(uint64_t idx_qreg, double c, double offset = 0.0);
+  void applyPhaseLinearConjugate(
+      uint64_t idx_qreg, double c, double offset = 0.0);
+  void applyPhasePolynomial(uint64_t idx_qreg, const RVec<double>& coeffs);
+  void applyPhasePolynomialConjugate(
+      uint64_t idx_qreg, const RVec<double>& coeffs);
+  void applyPhasePolynomial(uint64_t idx_qreg, const RVec<double>& forward,
+                            const RVec<double>& inverse);
 
   void measure(uint64_t idx_qreg, uint64_t idx_creg);
+  void track_probabilities(uint64_t idx_qreg, bool enable = true);
+  bool tracks_probabilities(uint64_t idx_qreg) const;
 
   CReg get_creg(uint64_t idx_creg) const;
 
+  void checkpoint(const std::string& path) const;
+  void restore(const std::string& path);
+
+  // Least recently used registers are compressed losslessly (see
+  // compressed_reg.h) while the resident amplitudes exceed bytes, and
+  // decompressed by their next gate; bytes = 0 lifts the limit. A register
+  // may be evicted and thawed many times, so only compress takes a lossy
+  // tolerance. Under a budget every gate takes a single residency mutex to
+  // pin and unpin its register, which serializes the bookkeeping of gates
+  // that a DagExecutor runs concurrently; only the gate bodies overlap.
+  // set_memory_budget, compress and restore must not overlap any gate.
+  void set_memory_budget(uint64_t bytes);
+  void compress(uint64_t idx_qreg, double tolerance = 0.0);
+  bool compressed(uint64_t idx_qreg) const;
+  uint64_t resident_bytes() const;
+
+#ifdef QENGINE_PROFILING
+  Profiler& profiler() { return profiler_; }
+  const Profiler& profiler() const { return profiler_; }
+#endif
+
 protected:
+  // Register a gate runs on: decompressed first, and never evicted while
+  // the guard lives. Without a budget or a compressed register it only
+  // stamps the use and takes no lock.
+  class ResidentReg {
+  public:
+    ResidentReg(Circuit<T>& circuit, uint64_t idx_qreg)
+      : circuit_(circuit), idx_qreg_{idx_qreg},
+        pinned_{circuit.managed_.load(std::memory_order_acquire)},
+        reg_{pinned_ ? &circuit.pin(idx_qreg) : &circuit.stamp(idx_qreg)} {}
+    ~ResidentReg() {
+      if (pinned_)
+        circuit_.unpin(idx_qreg_);
+    }
+    ResidentReg(const ResidentReg&) = delete;
+    ResidentReg& operator=(const ResidentReg&) = delete;
+
+    QReg<T>* operator->() const { return reg_; }
+
+  private:
+    Circuit<T>& circuit_;
+    uint64_t idx_qreg_;
+    bool pinned_;
+    QReg<T>* reg_;
+  };
+
+  QReg<T>& stamp(uint64_t idx_qreg);
+  QReg<T>& pin(uint64_t idx_qreg);
+  void unpin(uint64_t idx_qreg);
+  // Compresses unpinned resident registers, oldest first, until the budget
+  // holds. Callers hold residency_.
+  void evict();
+  void freeze(uint64_t idx_qreg, double tolerance);
+
   std::vector<QReg<T>> qregs_;
   std::vector<CReg> cregs_;
   RandNumEngine rand_eng_;
+  // Residency state below is guarded by residency_, except the use stamps.
+  mutable std::mutex residency_;
+  std::atomic<bool> managed_;
+  std::vector<std::unique_ptr<CompressedReg<T>>> cold_;
+  std::vector<uint64_t> pins_;
+  std::unique_ptr<std::atomic<uint64_t>[]> last_use_;
+  std::atomic<uint64_t> clock_;
+  uint64_t budget_;
+  uint64_t resident_bytes_;
+#ifdef QENGINE_PROFILING
+  Profiler profiler_;
+#endif
 };
 
 template <typename T>
 Circuit<T>::~Circuit() = default;
 
 template <typename T>
-Circuit<T>::Circuit(uint64_t nreg, uint64_t dim)
-  : qregs_(nreg, QReg<T>(dim)), cregs_(nreg), rand_eng_() {}
+Circuit<T>::Circuit(uint64_t nreg, uint64_t dim, uint32_t seed)
+  : qregs_(nreg, QReg<T>(dim)), cregs_(nreg), rand_eng_(seed),
+    managed_{false}, cold_(nreg), pins_(nreg),
+    last_use_(new std::atomic<uint64_t>[nreg]()), clock_{0}, budget_{0},
+    resident_bytes_{nreg * dim * sizeof(Cmplx<T>)} {}
 
 template <typename T>
-std::vector<QReg<T>> Circuit<T>::qregs() const { return qregs_; }
+std::vector<QReg<T>> Circuit<T>::qregs() const {
+  std::lock_guard<std::mutex> lock(residency_);
+  std::vector<QReg<T>> res(qregs_);
+  for (uint64_t i = 0; i < res.size(); ++i)
+    if (cold_[i])
+      res[i] = cold_[i]->decompress();
+  return res;
+}
 
 template <typename T>
 std::vector<CReg> Circuit<T>::cregs() const { return cregs_; }
@@ -89,68 +200,378 @@ template <typename T>
 uint64_t Circuit<T>::nreg() const { return qregs_.size(); }
 
 template <typename T>
-uint64_t Circuit<T>::dim() const { return qregs_[0].sdim(); }
+uint64_t Circuit<T>::dim() const {
+  std::lock_guard<std::mutex> lock(residency_);
+  return cold_[0] ? cold_[0]->sdim() : qregs_[0].sdim();
+}
 
 template <typename T>
 void Circuit<T>::apply(uint64_t idx_qreg, RMat<T> mat_op) {
-  qregs_[idx_qreg].apply(mat_op);
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(profiler_, "apply", idx_qreg,
+                  mat_op.size() * sizeof(T)
+                  + 2 * reg->dim() * sizeof(Cmplx<T>),
+                  4 * mat_op.size());
+  reg->apply(mat_op);
 }
 
 template <typename T>
 void Circuit<T>::apply(uint64_t idx_qreg, CMat<T> mat_op) {
-  qregs_[idx_qreg].apply(mat_op);
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(profiler_, "apply", idx_qreg,
+                  (mat_op.size() + 2 * reg->dim())
+                  * sizeof(Cmplx<T>),
+                  8 * mat_op.size());
+  reg->apply(mat_op);
 }
 
 template <typename T>
 void Circuit<T>::applyX(uint64_t idx_qreg, uint64_t i, T x, T y) {
-  qregs_[idx_qreg].applyX(i, x, y);
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(profiler_, "applyX", idx_qreg, 4 * sizeof(Cmplx<T>), 16);
+  reg->applyX(i, x, y);
 }
 
 template <typename T>
 void Circuit<T>::applyX(uint64_t idx_qreg, uint64_t i, Cmplx<T> x, Cmplx<T> y) {
-  qregs_[idx_qreg].applyX(i, x, y);
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(profiler_, "applyX", idx_qreg, 4 * sizeof(Cmplx<T>), 32);
+  reg->applyX(i, x, y);
 }
 
 template <typename T>
 void Circuit<T>::applyZ(uint64_t idx_qreg, uint64_t i, double tau) {
-  qregs_[idx_qreg].applyZ(i, tau);
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(profiler_, "applyZ", idx_qreg, 2 * sizeof(Cmplx<T>), 6);
+  reg->applyZ(i, tau);
 }
 
 template <typename T>
 void Circuit<T>::applyXconjugate(
     uint64_t idx_qreg, uint64_t i, T x, T y) {
-  qregs_[idx_qreg].applyXconjugate(i, x, y);
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(
+    profiler_, "applyXconjugate", idx_qreg, 4 * sizeof(Cmplx<T>), 16);
+  reg->applyXconjugate(i, x, y);
 }
 
 template <typename T>
 void Circuit<T>::applyXconjugate(
     uint64_t idx_qreg, uint64_t i, Cmplx<T> x, Cmplx<T> y) {
-  qregs_[idx_qreg].applyXconjugate(i, x, y);
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(
+    profiler_, "applyXconjugate", idx_qreg, 4 * sizeof(Cmplx<T>), 32);
+  reg->applyXconjugate(i, x, y);
 }
 
 template <typename T>
 void Circuit<T>::applyZconjugate(uint64_t idx_qreg, uint64_t i, double tau) {
-  qregs_[idx_qreg].applyZconjugate(i, tau);
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(
+    profiler_, "applyZconjugate", idx_qreg, 2 * sizeof(Cmplx<T>), 6);
+  reg->applyZconjugate(i, tau);
 }
 
 template <typename T>
-void Circuit<T>::measure(uint64_t idx_qreg, uint64_t idx_creg) {
-  RVec<T> probs(qregs_[idx_qreg].probabilities());
-  std::discrete_distribution<CReg> distrib(probs.begin(), probs.end());
+void Circuit<T>::applyDiagonal(uint64_t idx_qreg, const RVec<double>& tau) {
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(profiler_, "applyDiagonal", idx_qreg,
+                  tau.size() * (2 * sizeof(Cmplx<T>) + sizeof(double)),
+                  6 * tau.size());
+  reg->applyDiagonal(tau);
+}
+
+template <typename T>
+void Circuit<T>::applyDiagonal(uint64_t idx_qreg, const CVec<T>& d) {
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(profiler_, "applyDiagonal", idx_qreg,
+                  3 * d.size() * sizeof(Cmplx<T>), 6 * d.size());
+  reg->applyDiagonal(d);
+}
+
+template <typename T>
+void Circuit<T>::applyPermutation(
+    uint64_t idx_qreg, const std::vector<uint64_t>& perm, const CVec<T>& d) {
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(profiler_, "applyPermutation", idx_qreg,
+                  perm.size() * (4 * sizeof(Cmplx<T>) + sizeof(uint64_t)),
+                  6 * perm.size());
+  reg->applyPermutation(perm, d);
+}
+
+template <typename T>
+void Circuit<T>::applyBanded(
+    uint64_t idx_qreg, uint64_t kl, uint64_t ku, const CVec<T>& band) {
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(profiler_, "applyBanded", idx_qreg,
+                  (band.size() + 3 * reg->sdim())
+                  * sizeof(Cmplx<T>),
+                  8 * band.size());
+  reg->applyBanded(kl, ku, band);
+}
+
+template <typename T>
+void Circuit<T>::apply_givens_ladder(
+    uint64_t idx_qreg, const RVec<T>& x, const RVec<T>& y) {
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(profiler_, "apply_givens_ladder", idx_qreg,
+                  x.size() * (2 * sizeof(Cmplx<T>) + 2 * sizeof(T)),
+                  16 * x.size());
+  reg->apply_givens_ladder(x, y);
+}
+
+template <typename T>
+void Circuit<T>::apply_givens_ladder(
+    uint64_t idx_qreg, const CVec<T>& x, const CVec<T>& y) {
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(profiler_, "apply_givens_ladder", idx_qreg,
+                  4 * x.size() * sizeof(Cmplx<T>), 32 * x.size());
+  reg->apply_givens_ladder(x, y);
+}
+
+template <typename T>
+void Circuit<T>::apply_givens_ladder_conjugate(
+    uint64_t idx_qreg, const RVec<T>& x, const RVec<T>& y) {
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(profiler_, "apply_givens_ladder_conjugate", idx_qreg,
+                  x.size() * (2 * sizeof(Cmplx<T>) + 2 * sizeof(T)),
+                  16 * x.size());
+  reg->apply_givens_ladder_conjugate(x, y);
+}
+
+template <typename T>
+void Circuit<T>::apply_givens_ladder_conjugate(
+    uint64_t idx_qreg, const CVec<T>& x, const CVec<T>& y) {
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(profiler_, "apply_givens_ladder_conjugate", idx_qreg,
+                  4 * x.size() * sizeof(Cmplx<T>), 32 * x.size());
+  reg->apply_givens_ladder_conjugate(x, y);
+}
+
+template <typename T>
+void Circuit<T>::prepare_state(uint64_t idx_qreg, const CVec<T>& amplitudes) {
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(profiler_, "prepare_state", idx_qreg,
+                  2 * reg->dim() * sizeof(Cmplx<T>),
+                  4 * reg->dim());
+  reg->prepare_state(amplitudes);
+}
+
+template <typename T>
+void Circuit<T>::applyPhaseLinear(uint64_t idx_qreg, double c, double offset) {
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(profiler_, "applyPhaseLinear", idx_qreg,
+                  2 * reg->sdim() * sizeof(Cmplx<T>),
+                  12 * reg->sdim());
+  reg->applyPhaseLinear(c, offset);
+}
 
-  const CReg result = distrib(rand_eng_.mte());
+template <typename T>
+void Circuit<T>::applyPhaseLinearConjugate(
+    uint64_t idx_qreg, double c, double offset) {
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(profiler_, "applyPhaseLinearConjugate", idx_qreg,
+                  2 * reg->sdim() * sizeof(Cmplx<T>),
+                  12 * reg->sdim());
+  reg->applyPhaseLinearConjugate(c, offset);
+}
+
+template <typename T>
+void Circuit<T>::applyPhasePolynomial(
+    uint64_t idx_qreg, const RVec<double>& coeffs) {
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(profiler_, "applyPhasePolynomial", idx_qreg,
+                  2 * reg->sdim() * sizeof(Cmplx<T>),
+                  6 * (coeffs.size() + 1) * reg->sdim());
+  reg->applyPhasePolynomial(coeffs);
+}
+
+template <typename T>
+void Circuit<T>::applyPhasePolynomialConjugate(
+    uint64_t idx_qreg, const RVec<double>& coeffs) {
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(profiler_, "applyPhasePolynomialConjugate", idx_qreg,
+                  2 * reg->sdim() * sizeof(Cmplx<T>),
+                  6 * (coeffs.size() + 1) * reg->sdim());
+  reg->applyPhasePolynomialConjugate(coeffs);
+}
+
+template <typename T>
+void Circuit<T>::applyPhasePolynomial(
+    uint64_t idx_qreg, const RVec<double>& forward,
+    const RVec<double>& inverse) {
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(profiler_, "applyPhasePolynomial", idx_qreg,
+                  2 * reg->sdim() * sizeof(Cmplx<T>),
+                  6 * (std::max(forward.size(), inverse.size()) + 1)
+                  * reg->sdim());
+  reg->applyPhasePolynomial(forward, inverse);
+}
+
+template <typename T>
+void Circuit<T>::measure(uint64_t idx_qreg, uint64_t idx_creg) {
+  ResidentReg reg(*this, idx_qreg);
+  QENGINE_PROFILE(profiler_, "measure", idx_qreg,
+                  reg->tracks_probabilities()
+                  ? sizeof(T) * std::log2(reg->dim() + 1)
+                  : reg->dim() * (sizeof(Cmplx<T>) + sizeof(T)),
+                  reg->tracks_probabilities()
+                  ? std::log2(reg->dim() + 1)
+                  : 3 * reg->dim());
+  const CReg result = reg->sample(rand_eng_.mte());
 
   // TODO: применить ли изменение состояния после измерения?
   // RMat<T> Z(probs.size());
   // Z(result, result) = 1.0 / std::sqrt(probs[result]);
-  // qregs_[idx_qreg].apply(Z);
+  // reg->apply(Z);
 
   cregs_[idx_creg] = result;
 }
 
+template <typename T>
+void Circuit<T>::track_probabilities(uint64_t idx_qreg, bool enable) {
+  ResidentReg reg(*this, idx_qreg);
+  reg->track_probabilities(enable);
+}
+
+template <typename T>
+bool Circuit<T>::tracks_probabilities(uint64_t idx_qreg) const {
+  std::lock_guard<std::mutex> lock(residency_);
+  return cold_[idx_qreg] ? cold_[idx_qreg]->tracks_probabilities()
+                         : qregs_[idx_qreg].tracks_probabilities();
+}
+
 template <typename T>
 CReg Circuit<T>::get_creg(uint64_t idx_creg) const { return cregs_[idx_creg]; }
 
+template <typename T>
+void Circuit<T>::checkpoint(const std::string& path) const {
+  std::lock_guard<std::mutex> lock(residency_);
+  std::vector<QReg<T>> thawed;
+  thawed.reserve(qregs_.size());
+  std::vector<const QReg<T>*> qregs;
+  qregs.reserve(qregs_.size());
+  for (uint64_t i = 0; i < qregs_.size(); ++i) {
+    if (cold_[i]) {
+      thawed.push_back(cold_[i]->decompress());
+      qregs.push_back(&thawed.back());
+    } else {
+      qregs.push_back(&qregs_[i]);
+    }
+  }
+  write_checkpoint<T>(path, qregs, cregs_, rand_eng_.state());
+}
+
+template <typename T>
+void Circuit<T>::restore(const std::string& path) {
+  CheckpointData<T> data = read_checkpoint<T>(path);
+  Expects(!data.qregs.empty() && data.qregs.size() == data.cregs.size());
+
+  qregs_ = std::move(data.qregs);
+  cregs_ = std::move(data.cregs);
+  rand_eng_.set_state(data.rng_state);
+
+  std::lock_guard<std::mutex> lock(residency_);
+  cold_.clear();
+  cold_.resize(qregs_.size());
+  pins_.assign(qregs_.size(), 0);
+  last_use_.reset(new std::atomic<uint64_t>[qregs_.size()]());
+  resident_bytes_ = 0;
+  for (const auto & qreg : qregs_)
+    resident_bytes_ += qreg.dim() * sizeof(Cmplx<T>);
+  managed_ = budget_ > 0;
+  evict();
+}
+
+template <typename T>
+void Circuit<T>::set_memory_budget(uint64_t bytes) {
+  std::lock_guard<std::mutex> lock(residency_);
+  budget_ = bytes;
+  managed_ = budget_ > 0 || std::any_of(
+      cold_.begin(), cold_.end(),
+      [](const std::unique_ptr<CompressedReg<T>>& c) { return c != nullptr; });
+  evict();
+}
+
+template <typename T>
+void Circuit<T>::compress(uint64_t idx_qreg, double tolerance) {
+  Expects(idx_qreg < qregs_.size());
+  std::lock_guard<std::mutex> lock(residency_);
+  managed_ = true;
+  freeze(idx_qreg, tolerance);
+}
+
+template <typename T>
+bool Circuit<T>::compressed(uint64_t idx_qreg) const {
+  std::lock_guard<std::mutex> lock(residency_);
+  return cold_[idx_qreg] != nullptr;
+}
+
+template <typename T>
+uint64_t Circuit<T>::resident_bytes() const {
+  std::lock_guard<std::mutex> lock(residency_);
+  return resident_bytes_;
+}
+
+template <typename T>
+QReg<T>& Circuit<T>::stamp(uint64_t idx_qreg) {
+  last_use_[idx_qreg].store(clock_.fetch_add(1, std::memory_order_relaxed) + 1,
+                            std::memory_order_relaxed);
+  return qregs_[idx_qreg];
+}
+
+// Only a decompression can raise resident_bytes_, and the register it
+// brings back is already pinned, so evict() never takes it again.
+template <typename T>
+QReg<T>& Circuit<T>::pin(uint64_t idx_qreg) {
+  std::lock_guard<std::mutex> lock(residency_);
+  ++pins_[idx_qreg];
+  if (cold_[idx_qreg]) {
+    qregs_[idx_qreg] = cold_[idx_qreg]->decompress();
+    cold_[idx_qreg].reset();
+    resident_bytes_ += qregs_[idx_qreg].dim() * sizeof(Cmplx<T>);
+    evict();
+  }
+  return stamp(idx_qreg);
+}
+
+// Registers that were pinned when a decompression overran the budget are
+// evicted once their gates finish.
+template <typename T>
+void Circuit<T>::unpin(uint64_t idx_qreg) {
+  std::lock_guard<std::mutex> lock(residency_);
+  --pins_[idx_qreg];
+  evict();
+}
+
+template <typename T>
+void Circuit<T>::evict() {
+  while (budget_ > 0 && resident_bytes_ > budget_) {
+    uint64_t oldest = qregs_.size();
+    for (uint64_t i = 0; i < qregs_.size(); ++i)
+      if (!cold_[i] && pins_[i] == 0
+          && (oldest == qregs_.size() || last_use_[i] < last_use_[oldest]))
+        oldest = i;
+    if (oldest == qregs_.size())
+      break;
+    freeze(oldest, 0.0);
+  }
+}
+
+template <typename T>
+void Circuit<T>::freeze(uint64_t idx_qreg, double tolerance) {
+  if (cold_[idx_qreg])
+    return;
+  cold_[idx_qreg].reset(new CompressedReg<T>(qregs_[idx_qreg], tolerance));
+  resident_bytes_ -= qregs_[idx_qreg].dim() * sizeof(Cmplx<T>);
+  qregs_[idx_qreg] = QReg<T>();
+}
+
+#ifdef QENGINE_EXTERN_TEMPLATES
+extern template class Circuit<float>;
+extern template class Circuit<double>;
+#endif
+
 } // namespace qsystem
 } // namespace qengine
 
@@ -0,0 +1,270 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_INCLUDE_CIRCUIT_DAG_H_
+#define QENGINE_INCLUDE_CIRCUIT_DAG_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "circuit.h"
+#include "instruction.h"
+#include "work_stealing_pool.h"
+
+#include <gsl/gsl_assert>
+
+namespace qengine {
+inline namespace qsystem {
+
+// Run of instructions executed as one task, in program order.
+struct GateBlock {
+  std::vector<uint64_t> instructions;
+  std::vector<uint64_t> successors;
+  uint64_t npredecessors = 0;
+};
+
+// Dependency graph of a Program. applyX writes levels (i - 1, i) and applyZ
+// level i of its register; apply, applyDiagonal and measure touch the whole
+// register, and so does every gate on a register flagged `whole_register`
+// (one that tracks probabilities shares its Fenwick tree between all levels).
+// Measurements are also chained in program order because they draw from
+// the circuit's single engine. Chains of single-predecessor,
+// single-successor instructions are contracted into one block.
+template <typename T>
+class CircuitDag {
+public:
+  CircuitDag<T>() = delete;
+  ~CircuitDag<T>() = default;
+  CircuitDag<T>(const CircuitDag<T>&) = default;
+  CircuitDag<T>(CircuitDag<T>&&) = default;
+  CircuitDag<T>& operator=(const CircuitDag<T>&) = default;
+  CircuitDag<T>& operator=(CircuitDag<T>&&) = default;
+
+  CircuitDag<T>(Program<T> program, uint64_t nreg, uint64_t dim,
+                std::vector<bool> whole_register = {});
+  CircuitDag<T>(Program<T> program, const Circuit<T>& circuit);
+
+  const Program<T>& program() const { return program_; }
+  const std::vector<GateBlock>& blocks() const { return blocks_; }
+  uint64_t nblocks() const { return blocks_.size(); }
+  // Number of blocks on the longest dependency path.
+  uint64_t depth() const;
+
+private:
+  static std::vector<bool> whole_registers(const Circuit<T>& circuit);
+
+  Program<T> program_;
+  std::vector<GateBlock> blocks_;
+};
+
+template <typename T>
+CircuitDag<T>::CircuitDag(Program<T> program, uint64_t nreg, uint64_t dim,
+                          std::vector<bool> whole_register)
+  : program_{std::move(program)} {
+  whole_register.resize(nreg, false);
+
+  // Last instruction that wrote each level; entries older than the last
+  // whole-register instruction are stale and replaced by it. since_whole
+  // lists the levels written after that instruction.
+  std::vector<std::vector<int64_t>> last_level(
+      nreg, std::vector<int64_t>(dim, -1));
+  std::vector<int64_t> last_whole(nreg, -1);
+  std::vector<std::vector<uint64_t>> since_whole(nreg);
+  int64_t last_measure = -1;
+
+  const uint64_t n = program_.size();
+  std::vector<std::vector<uint64_t>> preds(n);
+  std::vector<std::vector<uint64_t>> succs(n);
+  auto depend = [&preds](uint64_t k, int64_t on) {
+    if (on >= 0 && std::find(preds[k].begin(), preds[k].end(), on)
+                   == preds[k].end())
+      preds[k].push_back(static_cast<uint64_t>(on));
+  };
+
+  for (uint64_t k = 0; k < n; ++k) {
+    const Instruction<T>& ins = program_[k];
+    Expects(ins.idx_qreg < nreg);
+    const uint64_t r = ins.idx_qreg;
+
+    const bool whole = whole_register[r] || ins.op == OpCode::apply
+                       || ins.op == OpCode::measure
+                       || ins.op == OpCode::applyDiagonal;
+    if (whole) {
+      depend(k, last_whole[r]);
+      // Only the last writer of each level touched since then is needed.
+      std::vector<uint64_t> frontier;
+      for (const auto & l : since_whole[r])
+        frontier.push_back(static_cast<uint64_t>(last_level[r][l]));
+      std::sort(frontier.begin(), frontier.end());
+      frontier.erase(std::unique(frontier.begin(), frontier.end()),
+                     frontier.end());
+      preds[k].insert(preds[k].end(), frontier.begin(), frontier.end());
+      last_whole[r] = k;
+      since_whole[r].clear();
+    } else {
+      const bool pair = ins.op == OpCode::applyX
+                        || ins.op == OpCode::applyXconjugate;
+      Expects(ins.i < dim && (!pair || ins.i > 0));
+      for (uint64_t l = pair ? ins.i - 1 : ins.i; l <= ins.i; ++l) {
+        depend(k, last_level[r][l] > last_whole[r] ? last_level[r][l]
+                                                   : last_whole[r]);
+        last_level[r][l] = k;
+        since_whole[r].push_back(l);
+      }
+    }
+
+    if (ins.op == OpCode::measure) {
+      depend(k, last_measure);
+      last_measure = k;
+    }
+
+    // Drop edges implied by another direct predecessor, e.g. a measure after
+    // X(1), Z(1) needs only Z(1); otherwise chains would not contract.
+    const std::vector<uint64_t> direct(preds[k]);
+    auto & pk = preds[k];
+    pk.erase(std::remove_if(pk.begin(), pk.end(), [&](uint64_t p) {
+      return std::any_of(direct.begin(), direct.end(), [&](uint64_t q) {
+        return std::find(preds[q].begin(), preds[q].end(), p)
+               != preds[q].end();
+      });
+    }), pk.end());
+  }
+  for (uint64_t k = 0; k < n; ++k)
+    for (const auto & p : preds[k])
+      succs[p].push_back(k);
+
+  std::vector<uint64_t> block_of(n);
+  for (uint64_t k = 0; k < n; ++k) {
+    if (preds[k].size() == 1 && succs[preds[k][0]].size() == 1) {
+      block_of[k] = block_of[preds[k][0]];
+    } else {
+      block_of[k] = blocks_.size();
+      blocks_.emplace_back();
+    }
+    blocks_[block_of[k]].instructions.push_back(k);
+  }
+  for (uint64_t k = 0; k < n; ++k) {
+    for (const auto & s : succs[k]) {
+      if (block_of[s] == block_of[k])
+        continue;
+      auto & out = blocks_[block_of[k]].successors;
+      if (std::find(out.begin(), out.end(), block_of[s]) == out.end()) {
+        out.push_back(block_of[s]);
+        ++blocks_[block_of[s]].npredecessors;
+      }
+    }
+  }
+}
+
+template <typename T>
+CircuitDag<T>::CircuitDag(Program<T> program, const Circuit<T>& circuit)
+  : CircuitDag<T>(std::move(program), circuit.nreg(), circuit.dim(),
+                  whole_registers(circuit)) {}
+
+template <typename T>
+std::vector<bool> CircuitDag<T>::whole_registers(const Circuit<T>& circuit) {
+  std::vector<bool> res(circuit.nreg());
+  for (uint64_t r = 0; r < circuit.nreg(); ++r)
+    res[r] = circuit.tracks_probabilities(r);
+  return res;
+}
+
+template <typename T>
+uint64_t CircuitDag<T>::depth() const {
+  // Blocks are created in program order, which is a topological order.
+  std::vector<uint64_t> level(blocks_.size(), 1);
+  uint64_t res = 0;
+  for (uint64_t b = 0; b < blocks_.size(); ++b) {
+    res = std::max(res, level[b]);
+    for (const auto & s : blocks_[b].successors)
+      level[s] = std::max(level[s], level[b] + 1);
+  }
+  return res;
+}
+
+// Runs the blocks of a CircuitDag on a work-stealing pool as soon as their
+// predecessors finish; a finished block submits its ready successors from
+// the same worker, so dependent chains stay on one core.
+template <typename T>
+class DagExecutor {
+public:
+  DagExecutor<T>() = delete;
+  ~DagExecutor<T>() = default;
+  DagExecutor<T>(const DagExecutor<T>&) = delete;
+  DagExecutor<T>(DagExecutor<T>&&) = delete;
+  DagExecutor<T>& operator=(const DagExecutor<T>&) = delete;
+  DagExecutor<T>& operator=(DagExecutor<T>&&) = delete;
+
+  explicit DagExecutor<T>(uint64_t nthreads) : pool_(nthreads) {}
+
+  void run(Circuit<T>& circuit, const CircuitDag<T>& dag);
+
+private:
+  void run_block(Circuit<T>& circuit, const CircuitDag<T>& dag, uint64_t b,
+                 std::atomic<uint64_t>* remaining);
+
+  WorkStealingPool pool_;
+};
+
+template <typename T>
+void DagExecutor<T>::run(Circuit<T>& circuit, const CircuitDag<T>& dag) {
+  const auto & blocks = dag.blocks();
+  std::unique_ptr<std::atomic<uint64_t>[]> remaining(
+      new std::atomic<uint64_t>[blocks.size()]);
+  for (uint64_t b = 0; b < blocks.size(); ++b)
+    remaining[b] = blocks[b].npredecessors;
+
+  std::atomic<uint64_t>* counters = remaining.get();
+  for (uint64_t b = 0; b < blocks.size(); ++b)
+    if (blocks[b].npredecessors == 0)
+      pool_.submit([this, &circuit, &dag, b, counters] {
+        run_block(circuit, dag, b, counters);
+      });
+  pool_.wait();
+}
+
+template <typename T>
+void DagExecutor<T>::run_block(Circuit<T>& circuit, const CircuitDag<T>& dag,
+                               uint64_t b, std::atomic<uint64_t>* remaining) {
+  const GateBlock& block = dag.blocks()[b];
+  for (const auto & k : block.instructions)
+    execute(circuit, dag.program()[k]);
+  for (const auto & s : block.successors)
+    if (--remaining[s] == 0)
+      pool_.submit([this, &circuit, &dag, s, remaining] {
+        run_block(circuit, dag, s, remaining);
+      });
+}
+
+template <typename T>
+void execute(Circuit<T>& circuit, const Program<T>& program,
+             DagExecutor<T>& executor) {
+  executor.run(circuit, CircuitDag<T>(program, circuit));
+}
+
+} // namespace qsystem
+} // namespace qengine
+
+#endif // QENGINE_INCLUDE_CIRCUIT_DAG_H_
@@ -0,0 +1,441 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_INCLUDE_CIRCUIT_STREAM_H_
+#define QENGINE_INCLUDE_CIRCUIT_STREAM_H_
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "circuit.h"
+#include "instruction.h"
+#include "types.h"
+
+namespace qengine {
+inline namespace io {
+
+// Text format, one instruction per line, '#' starts a comment:
+//   qengine <nreg> <dim>                    header, first line
+//   x    <reg> <i> <x> <y>                  applyX with real x, y
+//   cx   <reg> <i> <xre> <xim> <yre> <yim>  applyX with complex x, y
+//   xdg  / cxdg                             applyXconjugate, same operands
+//   z    <reg> <i> <tau>                    applyZ
+//   zdg  <reg> <i> <tau>                    applyZconjugate
+//   u    <reg> <n> <re> <im> ...            apply, n x n column-major
+//   diag <reg> <n> <tau_0> ... <tau_n-1>    applyDiagonal, n <= dim
+//   m    <reg> <creg>                       measure
+// Binary format: "QENGCIRC", uint32 version, uint32 precision, uint64 nreg,
+// uint64 dim, then records of uint8 opcode, uint64 reg, uint64 i and an
+// opcode specific payload (x, y as 4 T; tau as double; n and n * n
+// Cmplx<T> for apply; n and n doubles for applyDiagonal, version 2 on).
+// Records are read one at a time, so a stream of any length is executed in
+// constant memory.
+
+enum class StreamFormat { text, binary };
+
+constexpr char kCircuitMagic[8] = {'Q', 'E', 'N', 'G', 'C', 'I', 'R', 'C'};
+constexpr uint32_t kCircuitVersion = 2;
+
+template <typename T>
+class CircuitReader {
+public:
+  CircuitReader<T>() = delete;
+  ~CircuitReader<T>() = default;
+  CircuitReader<T>(const CircuitReader<T>&) = delete;
+  CircuitReader<T>(CircuitReader<T>&&) = delete;
+  CircuitReader<T>& operator=(const CircuitReader<T>&) = delete;
+  CircuitReader<T>& operator=(CircuitReader<T>&&) = delete;
+
+  explicit CircuitReader<T>(std::istream& in);
+
+  StreamFormat format() const;
+  uint64_t nreg() const;
+  uint64_t dim() const;
+
+  bool next(Instruction<T>& ins);
+
+private:
+  bool next_text(Instruction<T>& ins);
+  bool next_binary(Instruction<T>& ins);
+  bool next_line(std::istringstream& tokens);
+  void check(const Instruction<T>& ins) const;
+  [[noreturn]] void fail(const std::string& what) const;
+
+  template <typename U>
+  U read_pod();
+
+  std::istream& in_;
+  StreamFormat format_;
+  uint64_t nreg_;
+  uint64_t dim_;
+  uint64_t line_;
+  std::string buf_;
+};
+
+template <typename T>
+class CircuitWriter {
+public:
+  CircuitWriter<T>() = delete;
+  ~CircuitWriter<T>() = default;
+  CircuitWriter<T>(const CircuitWriter<T>&) = delete;
+  CircuitWriter<T>(CircuitWriter<T>&&) = delete;
+  CircuitWriter<T>& operator=(const CircuitWriter<T>&) = delete;
+  CircuitWriter<T>& operator=(CircuitWriter<T>&&) = delete;
+
+  CircuitWriter<T>(
+      std::ostream& out, StreamFormat format, uint64_t nreg, uint64_t dim);
+
+  void write(const Instruction<T>& ins);
+
+private:
+  void write_text(const Instruction<T>& ins);
+  void write_binary(const Instruction<T>& ins);
+
+  template <typename U>
+  void write_pod(U value);
+
+  std::ostream& out_;
+  StreamFormat format_;
+};
+
+template <typename T>
+CircuitReader<T>::CircuitReader(std::istream& in)
+  : in_(in), format_{StreamFormat::text}, nreg_{0}, dim_{0}, line_{0} {
+  if (in_.peek() == kCircuitMagic[0]) {
+    format_ = StreamFormat::binary;
+    char magic[sizeof(kCircuitMagic)];
+    in_.read(magic, sizeof(magic));
+    if (!in_ || std::memcmp(magic, kCircuitMagic, sizeof(magic)) != 0)
+      fail("bad magic");
+    const uint32_t version = read_pod<uint32_t>();
+    if (version == 0 || version > kCircuitVersion)
+      fail("unsupported version");
+    if (read_pod<uint32_t>() != sizeof(T))
+      fail("precision mismatch");
+    nreg_ = read_pod<uint64_t>();
+    dim_ = read_pod<uint64_t>();
+  } else {
+    std::istringstream tokens;
+    std::string keyword;
+    if (!next_line(tokens) || !(tokens >> keyword >> nreg_ >> dim_)
+        || keyword != "qengine")
+      fail("expected header 'qengine <nreg> <dim>'");
+  }
+  if (nreg_ == 0 || dim_ == 0)
+    fail("empty circuit");
+}
+
+template <typename T>
+StreamFormat CircuitReader<T>::format() const { return format_; }
+
+template <typename T>
+uint64_t CircuitReader<T>::nreg() const { return nreg_; }
+
+template <typename T>
+uint64_t CircuitReader<T>::dim() const { return dim_; }
+
+template <typename T>
+bool CircuitReader<T>::next(Instruction<T>& ins) {
+  const bool res = format_ == StreamFormat::binary
+                 ? next_binary(ins) : next_text(ins);
+  if (res)
+    check(ins);
+  return res;
+}
+
+template <typename T>
+bool CircuitReader<T>::next_line(std::istringstream& tokens) {
+  while (std::getline(in_, buf_)) {
+    ++line_;
+    const auto comment = buf_.find('#');
+    if (comment != std::string::npos)
+      buf_.erase(comment);
+    if (buf_.find_first_not_of(" \t\r") == std::string::npos)
+      continue;
+    tokens.clear();
+    tokens.str(buf_);
+    return true;
+  }
+  return false;
+}
+
+template <typename T>
+bool CircuitReader<T>::next_text(Instruction<T>& ins) {
+  std::istringstream tokens;
+  if (!next_line(tokens))
+    return false;
+
+  std::string op;
+  tokens >> op >> ins.idx_qreg >> ins.i;
+  T re_x = 0.0, im_x = 0.0, re_y = 0.0, im_y = 0.0;
+  if (op == "x" || op == "xdg") {
+    ins.op = op == "x" ? OpCode::applyX : OpCode::applyXconjugate;
+    tokens >> re_x >> re_y;
+    ins.x = Cmplx<T>(re_x, 0.0);
+    ins.y = Cmplx<T>(re_y, 0.0);
+  } else if (op == "cx" || op == "cxdg") {
+    ins.op = op == "cx" ? OpCode::applyX : OpCode::applyXconjugate;
+    tokens >> re_x >> im_x >> re_y >> im_y;
+    ins.x = Cmplx<T>(re_x, im_x);
+    ins.y = Cmplx<T>(re_y, im_y);
+  } else if (op == "z" || op == "zdg") {
+    ins.op = op == "z" ? OpCode::applyZ : OpCode::applyZconjugate;
+    tokens >> ins.tau;
+  } else if (op == "m") {
+    ins.op = OpCode::measure;
+  } else if (op == "u") {
+    ins.op = OpCode::apply;
+    const uint64_t n = ins.i;
+    ins.i = 0;
+    if (n != dim_)
+      fail("matrix size does not match dim");
+    ins.mat = CMat<T>(n);
+    for (uint64_t j = 0; j < n; ++j)
+      for (uint64_t i = 0; i < n; ++i) {
+        tokens >> re_x >> im_x;
+        ins.mat(i, j) = Cmplx<T>(re_x, im_x);
+      }
+  } else if (op == "diag") {
+    ins.op = OpCode::applyDiagonal;
+    const uint64_t n = ins.i;
+    ins.i = 0;
+    if (n > dim_)
+      fail("phase vector longer than dim");
+    ins.phases.resize(n);
+    for (auto & tau : ins.phases)
+      tokens >> tau;
+  } else {
+    fail("unknown instruction '" + op + "'");
+  }
+
+  std::string rest;
+  if (tokens.fail() || (tokens >> rest))
+    fail("malformed operands for '" + op + "'");
+  return true;
+}
+
+template <typename T>
+bool CircuitReader<T>::next_binary(Instruction<T>& ins) {
+  const auto op = in_.get();
+  if (op == std::istream::traits_type::eof())
+    return false;
+
+  ins.op = static_cast<OpCode>(op);
+  ins.idx_qreg = read_pod<uint64_t>();
+  ins.i = read_pod<uint64_t>();
+  switch (ins.op) {
+  case OpCode::applyX:
+  case OpCode::applyXconjugate: {
+    const T re_x = read_pod<T>(), im_x = read_pod<T>();
+    const T re_y = read_pod<T>(), im_y = read_pod<T>();
+    ins.x = Cmplx<T>(re_x, im_x);
+    ins.y = Cmplx<T>(re_y, im_y);
+    break;
+  }
+  case OpCode::applyZ:
+  case OpCode::applyZconjugate:
+    ins.tau = read_pod<double>();
+    break;
+  case OpCode::measure:
+    break;
+  case OpCode::apply: {
+    const uint64_t n = read_pod<uint64_t>();
+    if (n != dim_)
+      fail("matrix size does not match dim");
+    ins.mat = CMat<T>(n);
+    for (uint64_t j = 0; j < n; ++j)
+      for (uint64_t i = 0; i < n; ++i)
+        ins.mat(i, j) = read_pod<Cmplx<T>>();
+    break;
+  }
+  case OpCode::applyDiagonal: {
+    const uint64_t n = read_pod<uint64_t>();
+    if (n > dim_)
+      fail("phase vector longer than dim");
+    ins.phases.resize(n);
+    for (auto & tau : ins.phases)
+      tau = read_pod<double>();
+    break;
+  }
+  default:
+    fail("unknown opcode " + std::to_string(op));
+  }
+  return true;
+}
+
+template <typename T>
+void CircuitReader<T>::check(const Instruction<T>& ins) const {
+  if (ins.idx_qreg >= nreg_)
+    fail("register index out of range");
+  const bool pair = ins.op == OpCode::applyX
+                    || ins.op == OpCode::applyXconjugate;
+  if (ins.op == OpCode::measure ? ins.i >= nreg_ : ins.i >= dim_)
+    fail("level index out of range");
+  // a rotation mixes levels i - 1 and i
+  if (pair && ins.i == 0)
+    fail("level index out of range");
+}
+
+template <typename T>
+void CircuitReader<T>::fail(const std::string& what) const {
+  std::string where = format_ == StreamFormat::text
+                    ? "line " + std::to_string(line_)
+                    : "offset " + std::to_string(in_.tellg());
+  throw std::runtime_error("qengine: circuit stream, " + where + ": " + what);
+}
+
+template <typename T>
+template <typename U>
+U CircuitReader<T>::read_pod() {
+  U value;
+  in_.read(reinterpret_cast<char*>(&value), sizeof(U));
+  if (!in_)
+    fail("truncated record");
+  return value;
+}
+
+template <typename T>
+CircuitWriter<T>::CircuitWriter(
+    std::ostream& out, StreamFormat format, uint64_t nreg, uint64_t dim)
+  : out_(out), format_{format} {
+  if (format_ == StreamFormat::binary) {
+    out_.write(kCircuitMagic, sizeof(kCircuitMagic));
+    write_pod<uint32_t>(kCircuitVersion);
+    write_pod<uint32_t>(sizeof(T));
+    write_pod<uint64_t>(nreg);
+    write_pod<uint64_t>(dim);
+  } else {
+    out_.precision(std::numeric_limits<double>::max_digits10);
+    out_ << "qengine " << nreg << " " << dim << "\n";
+  }
+}
+
+template <typename T>
+void CircuitWriter<T>::write(const Instruction<T>& ins) {
+  if (format_ == StreamFormat::binary)
+    write_binary(ins);
+  else
+    write_text(ins);
+}
+
+template <typename T>
+void CircuitWriter<T>::write_text(const Instruction<T>& ins) {
+  const bool real = ins.x.imag() == 0.0 && ins.y.imag() == 0.0;
+  switch (ins.op) {
+  case OpCode::applyX:
+  case OpCode::applyXconjugate:
+    out_ << (real ? "x" : "cx")
+         << (ins.op == OpCode::applyXconjugate ? "dg " : " ")
+         << ins.idx_qreg << " " << ins.i << " ";
+    if (real)
+      out_ << ins.x.real() << " " << ins.y.real();
+    else
+      out_ << ins.x.real() << " " << ins.x.imag() << " "
+           << ins.y.real() << " " << ins.y.imag();
+    break;
+  case OpCode::applyZ:
+  case OpCode::applyZconjugate:
+    out_ << (ins.op == OpCode::applyZ ? "z " : "zdg ")
+         << ins.idx_qreg << " " << ins.i << " " << ins.tau;
+    break;
+  case OpCode::measure:
+    out_ << "m " << ins.idx_qreg << " " << ins.i;
+    break;
+  case OpCode::apply:
+    out_ << "u " << ins.idx_qreg << " " << ins.mat.nrows();
+    for (uint64_t j = 0; j < ins.mat.ncols(); ++j)
+      for (uint64_t i = 0; i < ins.mat.nrows(); ++i)
+        out_ << " " << ins.mat(i, j).real() << " " << ins.mat(i, j).imag();
+    break;
+  case OpCode::applyDiagonal:
+    out_ << "diag " << ins.idx_qreg << " " << ins.phases.size();
+    for (const auto & tau : ins.phases)
+      out_ << " " << tau;
+    break;
+  }
+  out_ << "\n";
+}
+
+template <typename T>
+void CircuitWriter<T>::write_binary(const Instruction<T>& ins) {
+  write_pod<uint8_t>(static_cast<uint8_t>(ins.op));
+  write_pod<uint64_t>(ins.idx_qreg);
+  write_pod<uint64_t>(
+      ins.op == OpCode::apply || ins.op == OpCode::applyDiagonal ? 0 : ins.i);
+  switch (ins.op) {
+  case OpCode::applyX:
+  case OpCode::applyXconjugate:
+    write_pod<T>(ins.x.real());
+    write_pod<T>(ins.x.imag());
+    write_pod<T>(ins.y.real());
+    write_pod<T>(ins.y.imag());
+    break;
+  case OpCode::applyZ:
+  case OpCode::applyZconjugate:
+    write_pod<double>(ins.tau);
+    break;
+  case OpCode::measure:
+    break;
+  case OpCode::apply:
+    write_pod<uint64_t>(ins.mat.nrows());
+    for (uint64_t j = 0; j < ins.mat.ncols(); ++j)
+      for (uint64_t i = 0; i < ins.mat.nrows(); ++i)
+        write_pod<Cmplx<T>>(ins.mat(i, j));
+    break;
+  case OpCode::applyDiagonal:
+    write_pod<uint64_t>(ins.phases.size());
+    for (const auto & tau : ins.phases)
+      write_pod<double>(tau);
+    break;
+  }
+}
+
+template <typename T>
+template <typename U>
+void CircuitWriter<T>::write_pod(U value) {
+  out_.write(reinterpret_cast<const char*>(&value), sizeof(U));
+}
+
+// Executes instructions as they are parsed; returns how many were run.
+template <typename T>
+uint64_t run_stream(Circuit<T>& circuit, CircuitReader<T>& reader) {
+  Expects(circuit.nreg() == reader.nreg() && circuit.dim() == reader.dim());
+
+  Instruction<T> ins{};
+  uint64_t count = 0;
+  while (reader.next(ins)) {
+    execute(circuit, ins);
+    ++count;
+  }
+  return count;
+}
+
+} // namespace io
+} // namespace qengine
+
+#endif // QENGINE_INCLUDE_CIRCUIT_STREAM_H_
@@ -0,0 +1,102 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_INCLUDE_COMPRESSED_REG_H_
+#define QENGINE_INCLUDE_COMPRESSED_REG_H_
+
+#include <cstdint>
+
+#include "compression.h"
+#include "qreg.h"
+#include "types.h"
+
+namespace qengine {
+inline namespace qstate {
+
+// Snapshot of a QReg in compressed form, see compression.h. tolerance 0 is
+// lossless; otherwise every real component is kept within tolerance.
+// decompress() gives back an equivalent register, including whether it
+// tracked probabilities.
+template <typename T>
+class CompressedReg {
+public:
+  CompressedReg<T>() = delete;
+  ~CompressedReg<T>() = default;
+  CompressedReg<T>(const CompressedReg<T>&) = default;
+  CompressedReg<T>(CompressedReg<T>&&) = default;
+  CompressedReg<T>& operator=(const CompressedReg<T>&) = default;
+  CompressedReg<T>& operator=(CompressedReg<T>&&) = default;
+
+  explicit CompressedReg<T>(const QReg<T>& qreg, double tolerance = 0.0);
+
+  QReg<T> decompress() const;
+
+  uint64_t sdim() const;
+  uint64_t dim() const;
+  // Size of the encoded amplitudes.
+  uint64_t bytes() const;
+  bool lossless() const;
+  bool tracks_probabilities() const;
+
+private:
+  uint64_t sdim_;
+  uint64_t size_;
+  bool track_;
+  CompressedBlock block_;
+};
+
+template <typename T>
+CompressedReg<T>::CompressedReg(const QReg<T>& qreg, double tolerance)
+  : sdim_{qreg.sdim()}, size_{qreg.size()},
+    track_{qreg.tracks_probabilities()},
+    block_(compress(qreg.data(), qreg.dim(), tolerance)) {}
+
+template <typename T>
+QReg<T> CompressedReg<T>::decompress() const {
+  CVec<T> amplitudes(dim());
+  qengine::decompress(block_, amplitudes.data());
+  QReg<T> res(sdim_, size_, amplitudes.data());
+  res.track_probabilities(track_);
+  return res;
+}
+
+template <typename T>
+uint64_t CompressedReg<T>::sdim() const { return sdim_; }
+
+template <typename T>
+uint64_t CompressedReg<T>::dim() const { return block_.count / 2; }
+
+template <typename T>
+uint64_t CompressedReg<T>::bytes() const { return block_.bytes.size(); }
+
+template <typename T>
+bool CompressedReg<T>::lossless() const {
+  return block_.codec == Codec::lossless;
+}
+
+template <typename T>
+bool CompressedReg<T>::tracks_probabilities() const { return track_; }
+
+} // namespace qstate
+} // namespace qengine
+
+#endif // QENGINE_INCLUDE_COMPRESSED_REG_H_
@@ -0,0 +1,307 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_INCLUDE_DENSITY_REG_H_
+#define QENGINE_INCLUDE_DENSITY_REG_H_
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "ireg.h"
+#include "math_operations.h"
+#include "qreg.h"
+#include "types.h"
+
+#include <gsl/gsl_assert>
+
+namespace qengine {
+inline namespace qstate {
+
+// Mixed state of a register. rho is kept as one column-major dim x dim
+// block, rho(i, j) = rho_[i + j * dim], like Matrix. Gates are applied as
+// U rho U^dagger: a level-local gate touches two rows and two columns, so
+// applyX/applyZ cost O(dim) instead of two dense products.
+template <typename T>
+class DensityReg : public IReg<T> {
+public:
+  DensityReg<T>();
+  virtual ~DensityReg<T>();
+  DensityReg<T>(const DensityReg<T>&);
+  DensityReg<T>(DensityReg<T>&&);
+  DensityReg<T>& operator=(const DensityReg<T>&);
+  DensityReg<T>& operator=(DensityReg<T>&&);
+
+  DensityReg<T>(uint64_t sdim, uint64_t size = 1);
+  explicit DensityReg<T>(const QReg<T>& qreg);
+
+  virtual uint64_t size() const override;
+
+  void apply(const RMat<T>& mat);
+  void apply(const CMat<T>& mat);
+  void apply_channel(const std::vector<CMat<T>>& kraus);
+
+  void applyX(uint64_t i, T x, T y);
+  void applyX(uint64_t i, Cmplx<T> x, Cmplx<T> y);
+  void applyZ(uint64_t i, double tau);
+  void applyXconjugate(uint64_t i, T x, T y);
+  void applyXconjugate(uint64_t i, Cmplx<T> x, Cmplx<T> y);
+  void applyZconjugate(uint64_t i, double tau);
+
+  void dephase(uint64_t i, T p);
+  void damp(uint64_t i, T gamma);
+
+  uint64_t dim() const;
+  uint64_t sdim() const;
+
+  Cmplx<T> operator()(uint64_t i, uint64_t j) const;
+  T trace() const;
+  T purity() const;
+  RVec<T> probabilities() const;
+  CReg measure(std::mt19937& mte) const;
+
+private:
+  template <typename C>
+  void apply_givens_both(uint64_t i, const Givens<C>& g);
+  void apply_phase_both(uint64_t i, Cmplx<T> phase);
+  template <typename M>
+  CVec<T> sandwich(const Matrix<M>& mat) const;
+
+  uint64_t sdim_;
+  uint64_t size_;
+  uint64_t dim_;
+  CVec<T> rho_;
+};
+
+template <typename T>
+DensityReg<T>::DensityReg() = default;
+
+template <typename T>
+DensityReg<T>::~DensityReg() = default;
+
+template <typename T>
+DensityReg<T>::DensityReg(const DensityReg<T>&) = default;
+
+template <typename T>
+DensityReg<T>::DensityReg(DensityReg<T>&&) = default;
+
+template <typename T>
+DensityReg<T>& DensityReg<T>::operator=(const DensityReg<T>&) = default;
+
+template <typename T>
+DensityReg<T>& DensityReg<T>::operator=(DensityReg<T>&&) = default;
+
+template <typename T>
+DensityReg<T>::DensityReg(uint64_t sdim, uint64_t size)
+  : sdim_{sdim}, size_{size}, dim_{sdim * size}, rho_(dim_ * dim_) {
+  rho_[0] = 1.0;
+}
+
+template <typename T>
+DensityReg<T>::DensityReg(const QReg<T>& qreg)
+  : sdim_{qreg.sdim()}, size_{qreg.size()}, dim_{qreg.dim()},
+    rho_(dim_ * dim_) {
+  const Cmplx<T>* a = qreg.data();
+  for (uint64_t j = 0; j < dim_; ++j) {
+    const Cmplx<T> a_j = std::conj(a[j]);
+    for (uint64_t i = 0; i < dim_; ++i)
+      rho_[i + j * dim_] = a[i] * a_j;
+  }
+}
+
+template <typename T>
+uint64_t DensityReg<T>::size() const { return size_; }
+
+template <typename T>
+uint64_t DensityReg<T>::dim() const { return dim_; }
+
+template <typename T>
+uint64_t DensityReg<T>::sdim() const { return sdim_; }
+
+template <typename T>
+Cmplx<T> DensityReg<T>::operator()(uint64_t i, uint64_t j) const {
+  return rho_[i + j * dim_];
+}
+
+template <typename T>
+template <typename C>
+void DensityReg<T>::apply_givens_both(uint64_t i, const Givens<C>& g) {
+  for (uint64_t j = 0; j < dim_; ++j)
+    apply_givens(g, rho_[i - 1 + j * dim_], rho_[i + j * dim_]);
+
+  const Givens<C> g_conj = conjugate(g);
+  Cmplx<T>* col_i_1 = &rho_[(i - 1) * dim_];
+  Cmplx<T>* col_i = &rho_[i * dim_];
+  for (uint64_t r = 0; r < dim_; ++r)
+    apply_givens(g_conj, col_i_1[r], col_i[r]);
+}
+
+template <typename T>
+void DensityReg<T>::apply_phase_both(uint64_t i, Cmplx<T> phase) {
+  const Cmplx<T> phase_conj = std::conj(phase);
+  for (uint64_t j = 0; j < dim_; ++j)
+    rho_[i + j * dim_] *= phase;
+  for (uint64_t r = 0; r < dim_; ++r)
+    rho_[r + i * dim_] *= phase_conj;
+}
+
+template <typename T>
+void DensityReg<T>::applyX(uint64_t i, T x, T y) {
+  Expects(0 < i && i < sdim_);
+  apply_givens_both(i, givens_X(x, y));
+}
+
+template <typename T>
+void DensityReg<T>::applyX(uint64_t i, Cmplx<T> x, Cmplx<T> y) {
+  Expects(0 < i && i < sdim_);
+  apply_givens_both(i, givens_X(x, y));
+}
+
+template <typename T>
+void DensityReg<T>::applyZ(uint64_t i, double tau) {
+  Expects(i < sdim_);
+  apply_phase_both(i, Cmplx<T>(std::cos(tau), std::sin(tau)));
+}
+
+template <typename T>
+void DensityReg<T>::applyXconjugate(uint64_t i, T x, T y) {
+  Expects(0 < i && i < sdim_);
+  apply_givens_both(i, givens_Xconjugate(x, y));
+}
+
+template <typename T>
+void DensityReg<T>::applyXconjugate(uint64_t i, Cmplx<T> x, Cmplx<T> y) {
+  Expects(0 < i && i < sdim_);
+  apply_givens_both(i, givens_Xconjugate(x, y));
+}
+
+template <typename T>
+void DensityReg<T>::applyZconjugate(uint64_t i, double tau) {
+  Expects(i < sdim_);
+  apply_phase_both(i, Cmplx<T>(std::cos(tau), -std::sin(tau)));
+}
+
+// Phase flip of level i with probability p:
+// rho -> (1 - p) rho + p Z_i rho Z_i.
+template <typename T>
+void DensityReg<T>::dephase(uint64_t i, T p) {
+  Expects(i < dim_ && 0 <= p && p <= 1);
+  const T factor = 1 - 2 * p;
+  for (uint64_t j = 0; j < dim_; ++j)
+    if (j != i) {
+      rho_[i + j * dim_] *= factor;
+      rho_[j + i * dim_] *= factor;
+    }
+}
+
+// Decay of level i into level i - 1 with probability gamma, Kraus operators
+// K_1 = sqrt(gamma) |i - 1><i| and K_0 = I - (1 - sqrt(1 - gamma)) |i><i|.
+template <typename T>
+void DensityReg<T>::damp(uint64_t i, T gamma) {
+  Expects(0 < i && i < dim_ && 0 <= gamma && gamma <= 1);
+  const T s = std::sqrt(1 - gamma);
+  const Cmplx<T> rho_ii = rho_[i + i * dim_];
+  for (uint64_t j = 0; j < dim_; ++j) {
+    rho_[i + j * dim_] *= s;
+    rho_[j + i * dim_] *= s;
+  }
+  rho_[i - 1 + (i - 1) * dim_] += gamma * rho_ii;
+}
+
+template <typename T>
+template <typename M>
+CVec<T> DensityReg<T>::sandwich(const Matrix<M>& mat) const {
+  Expects(mat.nrows() == dim_ && mat.ncols() == dim_);
+
+  CVec<T> tmp(dim_ * dim_);
+  for (uint64_t j = 0; j < dim_; ++j)
+    for (uint64_t k = 0; k < dim_; ++k) {
+      const Cmplx<T> rho_kj = rho_[k + j * dim_];
+      for (uint64_t i = 0; i < dim_; ++i)
+        tmp[i + j * dim_] += mat(i, k) * rho_kj;
+    }
+
+  CVec<T> res(dim_ * dim_);
+  for (uint64_t j = 0; j < dim_; ++j)
+    for (uint64_t k = 0; k < dim_; ++k) {
+      const Cmplx<T> m_jk = std::conj(Cmplx<T>(mat(j, k)));
+      for (uint64_t i = 0; i < dim_; ++i)
+        res[i + j * dim_] += tmp[i + k * dim_] * m_jk;
+    }
+  return res;
+}
+
+template <typename T>
+void DensityReg<T>::apply(const RMat<T>& mat) { rho_ = sandwich(mat); }
+
+template <typename T>
+void DensityReg<T>::apply(const CMat<T>& mat) { rho_ = sandwich(mat); }
+
+template <typename T>
+void DensityReg<T>::apply_channel(const std::vector<CMat<T>>& kraus) {
+  Expects(!kraus.empty());
+
+  CVec<T> res(dim_ * dim_);
+  for (const auto & k : kraus) {
+    const CVec<T> term = sandwich(k);
+    for (uint64_t n = 0; n < res.size(); ++n)
+      res[n] += term[n];
+  }
+  rho_ = std::move(res);
+}
+
+template <typename T>
+T DensityReg<T>::trace() const {
+  T res = 0;
+  for (uint64_t i = 0; i < dim_; ++i)
+    res += rho_[i + i * dim_].real();
+  return res;
+}
+
+template <typename T>
+T DensityReg<T>::purity() const {
+  T res = 0;
+  for (const auto & r : rho_)
+    res += std::norm(r);
+  return res;
+}
+
+template <typename T>
+RVec<T> DensityReg<T>::probabilities() const {
+  RVec<T> res(dim_);
+  for (uint64_t i = 0; i < dim_; ++i)
+    res[i] = rho_[i + i * dim_].real();
+  return res;
+}
+
+template <typename T>
+CReg DensityReg<T>::measure(std::mt19937& mte) const {
+  const RVec<T> probs = probabilities();
+  std::discrete_distribution<CReg> distrib(probs.begin(), probs.end());
+  return distrib(mte);
+}
+
+} // namespace qstate
+} // namespace qengine
+
+#endif // QENGINE_INCLUDE_DENSITY_REG_H_
@@ -0,0 +1,273 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_INCLUDE_DIST_REG_H_
+#define QENGINE_INCLUDE_DIST_REG_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "ireg.h"
+#include "math_operations.h"
+#include "qreg.h"
+#include "transport.h"
+#include "types.h"
+
+#include <gsl/gsl_assert>
+
+namespace qengine {
+inline namespace qstate {
+
+// Register whose amplitudes are split into contiguous blocks, one per rank
+// of a Transport. All ranks call every method with the same arguments.
+// Gates whose levels lie in one block run locally without communication;
+// applyX across a block boundary swaps one amplitude between the two
+// neighbouring ranks; only dense apply() gathers the whole state.
+template <typename T>
+class DistQReg : public IReg<T> {
+public:
+  DistQReg<T>() = delete;
+  virtual ~DistQReg<T>();
+  DistQReg<T>(const DistQReg<T>&) = delete;
+  DistQReg<T>(DistQReg<T>&&) = delete;
+  DistQReg<T>& operator=(const DistQReg<T>&) = delete;
+  DistQReg<T>& operator=(DistQReg<T>&&) = delete;
+
+  DistQReg<T>(Transport& transport, uint64_t sdim, uint64_t size = 1);
+
+  virtual uint64_t size() const override;
+
+  void apply(const CMat<T>& mat);
+
+  void applyX(uint64_t i, T x, T y);
+  void applyX(uint64_t i, Cmplx<T> x, Cmplx<T> y);
+  void applyZ(uint64_t i, double tau);
+  void applyXconjugate(uint64_t i, T x, T y);
+  void applyXconjugate(uint64_t i, Cmplx<T> x, Cmplx<T> y);
+  void applyZconjugate(uint64_t i, double tau);
+
+  uint64_t dim() const;
+  uint64_t sdim() const;
+  uint64_t owner(uint64_t i) const;
+  uint64_t local_begin() const;
+  uint64_t local_end() const;
+  const CVec<T>& local_amplitudes() const;
+
+  RVec<T> local_probabilities() const;
+  T norm() const;
+  CReg measure(std::mt19937& mte) const;
+  QReg<T> gather() const;
+
+private:
+  template <typename C>
+  void apply_pair(uint64_t i, const Givens<C>& g);
+
+  Transport& transport_;
+  uint64_t sdim_;
+  uint64_t size_;
+  uint64_t dim_;
+  uint64_t block_;
+  uint64_t begin_;
+  uint64_t end_;
+  CVec<T> local_;
+};
+
+template <typename T>
+DistQReg<T>::~DistQReg() = default;
+
+template <typename T>
+DistQReg<T>::DistQReg(Transport& transport, uint64_t sdim, uint64_t size)
+  : transport_(transport), sdim_{sdim}, size_{size}, dim_{sdim * size},
+    block_{(dim_ + transport.nranks() - 1) / transport.nranks()},
+    begin_{std::min(dim_, transport.rank() * block_)},
+    end_{std::min(dim_, begin_ + block_)}, local_(end_ - begin_) {
+  if (begin_ == 0 && end_ > 0)
+    local_[0] = 1.0;
+}
+
+template <typename T>
+uint64_t DistQReg<T>::size() const { return size_; }
+
+template <typename T>
+uint64_t DistQReg<T>::dim() const { return dim_; }
+
+template <typename T>
+uint64_t DistQReg<T>::sdim() const { return sdim_; }
+
+template <typename T>
+uint64_t DistQReg<T>::owner(uint64_t i) const { return i / block_; }
+
+template <typename T>
+uint64_t DistQReg<T>::local_begin() const { return begin_; }
+
+template <typename T>
+uint64_t DistQReg<T>::local_end() const { return end_; }
+
+template <typename T>
+const CVec<T>& DistQReg<T>::local_amplitudes() const { return local_; }
+
+template <typename T>
+template <typename C>
+void DistQReg<T>::apply_pair(uint64_t i, const Givens<C>& g) {
+  const bool has_i_1 = begin_ <= i - 1 && i - 1 < end_;
+  const bool has_i = begin_ <= i && i < end_;
+  if (has_i_1 && has_i) {
+    apply_givens(g, local_[i - 1 - begin_], local_[i - begin_]);
+  } else if (has_i_1) {
+    Cmplx<T> a_i_1 = local_[i - 1 - begin_];
+    Cmplx<T> a_i;
+    transport_.sendrecv(owner(i), &a_i_1, &a_i, sizeof(Cmplx<T>));
+    apply_givens(g, a_i_1, a_i);
+    local_[i - 1 - begin_] = a_i_1;
+  } else if (has_i) {
+    Cmplx<T> a_i_1;
+    Cmplx<T> a_i = local_[i - begin_];
+    transport_.sendrecv(owner(i - 1), &a_i, &a_i_1, sizeof(Cmplx<T>));
+    apply_givens(g, a_i_1, a_i);
+    local_[i - begin_] = a_i;
+  }
+}
+
+template <typename T>
+void DistQReg<T>::applyX(uint64_t i, T x, T y) {
+  Expects(0 < i && i < sdim_);
+  apply_pair(i, givens_X(x, y));
+}
+
+template <typename T>
+void DistQReg<T>::applyX(uint64_t i, Cmplx<T> x, Cmplx<T> y) {
+  Expects(0 < i && i < sdim_);
+  apply_pair(i, givens_X(x, y));
+}
+
+template <typename T>
+void DistQReg<T>::applyXconjugate(uint64_t i, T x, T y) {
+  Expects(0 < i && i < sdim_);
+  apply_pair(i, givens_Xconjugate(x, y));
+}
+
+template <typename T>
+void DistQReg<T>::applyXconjugate(uint64_t i, Cmplx<T> x, Cmplx<T> y) {
+  Expects(0 < i && i < sdim_);
+  apply_pair(i, givens_Xconjugate(x, y));
+}
+
+template <typename T>
+void DistQReg<T>::applyZ(uint64_t i, double tau) {
+  Expects(i < sdim_);
+  if (begin_ <= i && i < end_)
+    local_[i - begin_] *= Cmplx<T>(std::cos(tau), std::sin(tau));
+}
+
+template <typename T>
+void DistQReg<T>::applyZconjugate(uint64_t i, double tau) {
+  Expects(i < sdim_);
+  if (begin_ <= i && i < end_)
+    local_[i - begin_] *= Cmplx<T>(std::cos(tau), -std::sin(tau));
+}
+
+template <typename T>
+void DistQReg<T>::apply(const CMat<T>& mat) {
+  Expects(mat.nrows() == dim_);
+
+  CVec<T> block(block_);
+  std::copy(local_.begin(), local_.end(), block.begin());
+  CVec<T> full(block_ * transport_.nranks());
+  transport_.allgather(block.data(), full.data(), block_ * sizeof(Cmplx<T>));
+
+  CVec<T> res(local_.size());
+  for (uint64_t j = 0; j < dim_; ++j)
+    for (uint64_t i = begin_; i < end_; ++i)
+      res[i - begin_] += mat(i, j) * full[j];
+  local_ = std::move(res);
+}
+
+template <typename T>
+RVec<T> DistQReg<T>::local_probabilities() const {
+  RVec<T> res;
+  res.reserve(local_.size());
+  for (auto const & a : local_)
+    res.push_back(probability(a));
+  return res;
+}
+
+template <typename T>
+T DistQReg<T>::norm() const {
+  T local = 0.0;
+  for (auto const & a : local_)
+    local += probability(a);
+  return std::sqrt(transport_.allreduce_sum(local));
+}
+
+// `mte` must be in the same state on every rank: all ranks draw the same
+// number, find the owning block from the gathered block sums, and the owner
+// contributes the level to a final reduction.
+template <typename T>
+CReg DistQReg<T>::measure(std::mt19937& mte) const {
+  T local = 0.0;
+  for (auto const & a : local_)
+    local += probability(a);
+  const std::vector<T> sums = transport_.allgather(local);
+
+  T total = 0.0;
+  for (const auto & s : sums)
+    total += s;
+  std::uniform_real_distribution<T> uniform;
+  T u = uniform(mte) * total;
+
+  uint64_t rank = 0;
+  while (rank + 1 < sums.size() && (u >= sums[rank] || sums[rank] == 0)) {
+    u -= sums[rank];
+    ++rank;
+  }
+
+  uint64_t level = 0;
+  if (rank == transport_.rank()) {
+    level = end_ - 1;
+    for (uint64_t i = begin_; i < end_; ++i) {
+      const T p = probability(local_[i - begin_]);
+      if (u < p && p > 0) {
+        level = i;
+        break;
+      }
+      u -= p;
+    }
+  }
+  return static_cast<CReg>(transport_.allreduce_sum(level));
+}
+
+template <typename T>
+QReg<T> DistQReg<T>::gather() const {
+  CVec<T> block(block_);
+  std::copy(local_.begin(), local_.end(), block.begin());
+  CVec<T> full(block_ * transport_.nranks());
+  transport_.allgather(block.data(), full.data(), block_ * sizeof(Cmplx<T>));
+  return QReg<T>(sdim_, size_, full.data());
+}
+
+} // namespace qstate
+} // namespace qengine
+
+#endif // QENGINE_INCLUDE_DIST_REG_H_
@@ -0,0 +1,336 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_INCLUDE_EVOLUTION_H_
+#define QENGINE_INCLUDE_EVOLUTION_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "decompositions.h"
+#include "instruction.h"
+#include "math_operations.h"
+#include "qreg.h"
+#include "sparse_matrix.h"
+#include "types.h"
+
+#include <gsl/gsl_assert>
+
+namespace qengine {
+inline namespace qsystem {
+
+// e^{-iHt} on the first dim levels of a register, for a Hermitian H given
+// as CMat or CSR. Hermiticity is assumed, not checked.
+enum class EvolutionMethod { automatic, eigen, krylov, trotter };
+
+constexpr uint64_t kKrylovDim = 30;
+constexpr double kEvolutionTolerance = 1e-10;
+// Operation counts per n^3 for the Jacobi eigendecomposition, used only to
+// compare paths.
+constexpr uint64_t kEighCost = 20;
+
+// max_i sum_j |H(i, j)|, an upper bound of the spectral radius.
+template <typename T>
+T row_norm(const SparseMatrix<Cmplx<T>>& H) {
+  T norm = 0.0;
+  for (uint64_t i = 0; i < H.nrows(); ++i) {
+    T sum = 0.0;
+    for (uint64_t k = H.row_ptr()[i]; k < H.row_ptr()[i + 1]; ++k)
+      sum += std::abs(H.vals()[k]);
+    norm = std::max(norm, sum);
+  }
+  return norm;
+}
+
+// e^{-iHt} psi by Lanczos: psi is projected on an (at most krylov_dim)
+// dimensional Krylov space, fully reorthogonalized, where the small
+// tridiagonal exponential is exact. The step is halved until the a
+// posteriori estimate beta_m |(e^{-iT dt} e_1)_m| is below tolerance, and
+// [0, t] is covered in as many such steps as needed.
+template <typename T>
+CVec<T> expm_multiply(const SparseMatrix<Cmplx<T>>& H, CVec<T> psi,
+                      double t, uint64_t krylov_dim = kKrylovDim,
+                      double tolerance = kEvolutionTolerance) {
+  Expects(H.nrows() == H.ncols() && H.nrows() == psi.size());
+  Expects(krylov_dim > 0);
+
+  const uint64_t n = psi.size();
+  const Cmplx<T> zero(0.0);
+  double remaining = t;
+  while (remaining != 0.0) {
+    const T beta0 = std::sqrt(std::real(dot_conj(psi.data(), psi.data(),
+                                                 0, n)));
+    if (beta0 == 0.0)
+      return psi;
+
+    std::vector<CVec<T>> basis(1, psi);
+    for (auto & v : basis[0])
+      v /= beta0;
+    std::vector<T> alpha;
+    std::vector<T> beta;
+    CVec<T> w(n);
+    for (uint64_t j = 0; j < std::min(krylov_dim, n); ++j) {
+      std::fill(w.begin(), w.end(), zero);
+      H.multiply(basis[j].data(), w.data(), 0, n);
+      alpha.push_back(std::real(dot_conj(basis[j].data(), w.data(), 0, n)));
+      for (const auto & v : basis) {
+        const Cmplx<T> proj = dot_conj(v.data(), w.data(), 0, n);
+        for (uint64_t i = 0; i < n; ++i)
+          w[i] -= proj * v[i];
+      }
+      const T b = std::sqrt(std::real(dot_conj(w.data(), w.data(), 0, n)));
+      beta.push_back(b);
+      if (b <= tolerance * beta0 || j + 1 == std::min(krylov_dim, n))
+        break;
+      basis.push_back(w);
+      for (auto & v : basis.back())
+        v /= b;
+    }
+
+    const uint64_t m = alpha.size();
+    Matrix<Cmplx<T>> tri(m, m);
+    for (uint64_t j = 0; j < m; ++j) {
+      tri(j, j) = alpha[j];
+      if (j + 1 < m)
+        tri(j + 1, j) = tri(j, j + 1) = beta[j];
+    }
+    const auto dec = eigh(tri);
+
+    double dt = remaining;
+    CVec<T> coeffs(m);
+    for (;;) {
+      for (uint64_t i = 0; i < m; ++i) {
+        coeffs[i] = zero;
+        for (uint64_t k = 0; k < m; ++k)
+          coeffs[i] += dec.V(i, k) * std::conj(dec.V(0, k))
+                       * std::polar(T(1.0), static_cast<T>(-dec.w[k] * dt));
+      }
+      if (beta.back() * std::abs(coeffs[m - 1]) <= tolerance
+          || std::abs(dt) < 1e-3 * std::abs(t))
+        break;
+      dt /= 2;
+    }
+
+    std::fill(psi.begin(), psi.end(), zero);
+    for (uint64_t j = 0; j < m; ++j)
+      for (uint64_t i = 0; i < n; ++i)
+        psi[i] += beta0 * coeffs[j] * basis[j][i];
+    remaining -= dt;
+  }
+  return psi;
+}
+
+// Second-order Trotter-Suzuki circuit for a tridiagonal H = D + H_odd +
+// H_even, where H_odd (H_even) couples levels (i - 1, i) for odd (even) i,
+// so each group is a layer of commuting rotations:
+//   e^{-iH dt} ~ D(dt/2) odd(dt/2) even(dt) odd(dt/2) D(dt/2),
+// with consecutive half diagonals merged. A coupling b = |b| e^{i phi} gives
+// applyX(i, cos(|b| dt), i e^{i phi} sin(|b| dt)) and D one applyDiagonal.
+template <typename T>
+Program<T> trotter_program(const SparseMatrix<Cmplx<T>>& H, double t,
+                           uint64_t steps, uint64_t idx_qreg = 0) {
+  Expects(H.nrows() == H.ncols() && steps > 0);
+  const uint64_t n = H.nrows();
+  const double dt = t / steps;
+
+  Instruction<T> ins{};
+  ins.idx_qreg = idx_qreg;
+  Program<T> program;
+  auto diagonal = [&](double tau) {
+    ins.op = OpCode::applyDiagonal;
+    ins.i = 0;
+    ins.phases.assign(n, 0.0);
+    for (uint64_t i = 0; i < n; ++i)
+      ins.phases[i] = -std::real(H(i, i)) * tau;
+    program.push_back(ins);
+  };
+  auto layer = [&](uint64_t first, double tau) {
+    ins.op = OpCode::applyX;
+    for (uint64_t i = first; i < n; i += 2) {
+      const Cmplx<T> b = H(i - 1, i);
+      const T abs_b = std::abs(b);
+      if (abs_b == 0.0)
+        continue;
+      const T angle = static_cast<T>(abs_b * tau);
+      ins.i = i;
+      ins.x = std::cos(angle);
+      ins.y = Cmplx<T>(0.0, std::sin(angle)) * b / abs_b;
+      program.push_back(ins);
+    }
+  };
+
+  for (uint64_t s = 0; s < steps; ++s) {
+    diagonal(s == 0 ? dt / 2 : dt);
+    layer(1, dt / 2);
+    layer(2, dt);
+    layer(1, dt / 2);
+  }
+  diagonal(dt / 2);
+  return program;
+}
+
+template <typename T>
+class TimeEvolution {
+public:
+  TimeEvolution<T>() = delete;
+  ~TimeEvolution<T>() = default;
+  TimeEvolution<T>(const TimeEvolution<T>&) = default;
+  TimeEvolution<T>(TimeEvolution<T>&&) = default;
+  TimeEvolution<T>& operator=(const TimeEvolution<T>&) = default;
+  TimeEvolution<T>& operator=(TimeEvolution<T>&&) = default;
+
+  explicit TimeEvolution<T>(
+      const CMat<T>& H, double tolerance = kEvolutionTolerance);
+  explicit TimeEvolution<T>(const SparseMatrix<Cmplx<T>>& H,
+                            double tolerance = kEvolutionTolerance);
+
+  uint64_t dim() const;
+  bool tridiagonal() const;
+  bool decomposed() const;
+
+  // Cheapest method for one propagation over t; the eigendecomposition is
+  // charged only until it has been computed.
+  EvolutionMethod select(double t) const;
+  uint64_t trotter_steps(double t) const;
+
+  void evolve(QReg<T>& reg, double t,
+              EvolutionMethod method = EvolutionMethod::automatic);
+
+private:
+  void evolve_eigen(QReg<T>& reg, double t);
+
+  SparseMatrix<Cmplx<T>> H_;
+  double tolerance_;
+  T norm_;
+  bool tridiagonal_;
+  std::shared_ptr<const EigH<T>> eig_;
+};
+
+template <typename T>
+TimeEvolution<T>::TimeEvolution(const CMat<T>& H, double tolerance)
+  : TimeEvolution<T>(SparseMatrix<Cmplx<T>>(H), tolerance) {}
+
+template <typename T>
+TimeEvolution<T>::TimeEvolution(
+    const SparseMatrix<Cmplx<T>>& H, double tolerance)
+  : H_(H), tolerance_{tolerance}, norm_{row_norm(H)}, tridiagonal_{true} {
+  Expects(H_.nrows() == H_.ncols() && H_.nrows() > 0);
+  for (uint64_t i = 0; i < H_.nrows(); ++i)
+    for (uint64_t k = H_.row_ptr()[i]; k < H_.row_ptr()[i + 1]; ++k) {
+      const uint64_t j = H_.col_idx()[k];
+      if (j + 1 < i || i + 1 < j)
+        tridiagonal_ = false;
+    }
+}
+
+template <typename T>
+uint64_t TimeEvolution<T>::dim() const { return H_.nrows(); }
+
+template <typename T>
+bool TimeEvolution<T>::tridiagonal() const { return tridiagonal_; }
+
+template <typename T>
+bool TimeEvolution<T>::decomposed() const { return eig_ != nullptr; }
+
+// The second-order error is bounded by ~ |t|^3 ||H||^3 / (12 steps^2).
+template <typename T>
+uint64_t TimeEvolution<T>::trotter_steps(double t) const {
+  const double x = std::abs(t) * norm_;
+  return std::max<uint64_t>(
+      1, static_cast<uint64_t>(std::ceil(std::sqrt(x * x * x
+                                                   / (12 * tolerance_)))));
+}
+
+template <typename T>
+EvolutionMethod TimeEvolution<T>::select(double t) const {
+  const double n = static_cast<double>(dim());
+  const double m = static_cast<double>(std::min<uint64_t>(kKrylovDim, dim()));
+
+  const double eigen = (eig_ ? 0.0 : kEighCost * n * n * n) + 2 * n * n;
+  // Lanczos converges in one step while |t| ||H|| stays below ~ m / 2
+  const double krylov_steps = std::max(1.0, std::ceil(
+      2 * std::abs(t) * norm_ / m));
+  const double krylov = krylov_steps * m * (H_.nnz() + (m + 2) * n);
+  const double trotter = tridiagonal_
+                       ? trotter_steps(t) * 12 * n
+                       : std::numeric_limits<double>::infinity();
+
+  if (trotter < eigen && trotter < krylov)
+    return EvolutionMethod::trotter;
+  return eigen <= krylov ? EvolutionMethod::eigen : EvolutionMethod::krylov;
+}
+
+template <typename T>
+void TimeEvolution<T>::evolve(QReg<T>& reg, double t, EvolutionMethod method) {
+  Expects(reg.sdim() == dim());
+  if (method == EvolutionMethod::automatic)
+    method = select(t);
+
+  switch (method) {
+  case EvolutionMethod::eigen:
+    evolve_eigen(reg, t);
+    break;
+  case EvolutionMethod::krylov:
+    reg.assign(expm_multiply(H_, CVec<T>(reg.data(), reg.data() + dim()), t,
+                             kKrylovDim, tolerance_));
+    break;
+  case EvolutionMethod::trotter:
+    Expects(tridiagonal_);
+    for (const auto & ins : trotter_program(H_, t, trotter_steps(t)))
+      execute(reg, ins);
+    break;
+  case EvolutionMethod::automatic:
+    break;
+  }
+}
+
+// psi <- V diag(e^{-i w t}) V^dagger psi
+template <typename T>
+void TimeEvolution<T>::evolve_eigen(QReg<T>& reg, double t) {
+  if (!eig_)
+    eig_ = std::make_shared<const EigH<T>>(eigh(H_.to_dense()));
+
+  const uint64_t n = dim();
+  const auto & V = eig_->V;
+  const Cmplx<T>* psi = reg.data();
+  CVec<T> coeffs(n);
+  for (uint64_t k = 0; k < n; ++k) {
+    Cmplx<T> c = 0.0;
+    for (uint64_t i = 0; i < n; ++i)
+      c += std::conj(V(i, k)) * psi[i];
+    coeffs[k] = c * std::polar(T(1.0), static_cast<T>(-eig_->w[k] * t));
+  }
+  CVec<T> res(n);
+  for (uint64_t k = 0; k < n; ++k)
+    for (uint64_t i = 0; i < n; ++i)
+      res[i] += V(i, k) * coeffs[k];
+  reg.assign(res);
+}
+
+} // namespace qsystem
+} // namespace qengine
+
+#endif // QENGINE_INCLUDE_EVOLUTION_H_
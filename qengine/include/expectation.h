@@ -0,0 +1,165 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_INCLUDE_EXPECTATION_H_
+#define QENGINE_INCLUDE_EXPECTATION_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "math_operations.h"
+#include "parallel.h"
+#include "qreg.h"
+#include "sparse_matrix.h"
+#include "types.h"
+
+#include <gsl/gsl_assert>
+
+namespace qengine {
+inline namespace qstate {
+
+// Reductions that read QReg storage in place: no conjugated copies and no
+// D x D outer products. Large registers are split across the thread pool.
+
+template <typename T>
+Cmplx<T> overlap(const QReg<T>& bra, const QReg<T>& ket) {
+  return bra.braket_product(ket);
+}
+
+template <typename T>
+T fidelity(const QReg<T>& a, const QReg<T>& b) {
+  return probability(overlap(a, b));
+}
+
+// <psi| diag(d) |psi>
+template <typename T>
+T expectation(const QReg<T>& reg, const RVec<T>& diagonal) {
+  Expects(diagonal.size() == reg.dim());
+
+  const T* a = reinterpret_cast<const T*>(reg.data());
+  const T* d = diagonal.data();
+  return parallel_sum<T>(reg.dim(), [a, d](uint64_t begin, uint64_t end) {
+    T res = 0.0;
+    for (uint64_t i = begin; i < end; ++i)
+      res += d[i] * (a[2 * i] * a[2 * i] + a[2 * i + 1] * a[2 * i + 1]);
+    return res;
+  });
+}
+
+// <psi| A |psi> for a CSR matrix, split by rows.
+template <typename T, typename U>
+Cmplx<T> expectation(const QReg<T>& reg, const SparseMatrix<U>& A) {
+  Expects(A.nrows() == reg.dim() && A.ncols() == reg.dim());
+
+  const Cmplx<T>* psi = reg.data();
+  const uint64_t* row_ptr = A.row_ptr().data();
+  const uint64_t* col_idx = A.col_idx().data();
+  const U* vals = A.vals().data();
+  return parallel_sum<Cmplx<T>>(reg.dim(),
+      [psi, row_ptr, col_idx, vals](uint64_t begin, uint64_t end) {
+    Cmplx<T> res(0.0);
+    for (uint64_t i = begin; i < end; ++i) {
+      Cmplx<T> row(0.0);
+      for (uint64_t k = row_ptr[i]; k < row_ptr[i + 1]; ++k)
+        row += vals[k] * psi[col_idx[k]];
+      res += std::conj(psi[i]) * row;
+    }
+    return res;
+  }, kParallelThreshold / 8);
+}
+
+// <psi| A |psi> for a dense column-major matrix. Summing over columns,
+// sum_j psi_j (A(:, j), psi), keeps every inner loop contiguous.
+template <typename T, typename M>
+Cmplx<T> expectation_dense(const QReg<T>& reg, const M& A) {
+  Expects(A.nrows() == reg.dim() && A.ncols() == reg.dim());
+
+  const uint64_t n = reg.dim();
+  const Cmplx<T>* psi = reg.data();
+  return parallel_sum<Cmplx<T>>(n, [&A, psi, n](uint64_t begin, uint64_t end) {
+    Cmplx<T> res(0.0);
+    for (uint64_t j = begin; j < end; ++j) {
+      Cmplx<T> col(0.0);
+      for (uint64_t i = 0; i < n; ++i)
+        col += std::conj(psi[i]) * A(i, j);
+      res += col * psi[j];
+    }
+    return res;
+  }, kParallelThreshold / std::max<uint64_t>(n, 1));
+}
+
+template <typename T>
+Cmplx<T> expectation(const QReg<T>& reg, const CMat<T>& A) {
+  return expectation_dense(reg, A);
+}
+
+template <typename T>
+Cmplx<T> expectation(const QReg<T>& reg, const RMat<T>& A) {
+  return expectation_dense(reg, A);
+}
+
+// Marginal distribution of qudit `idx_qudit` for a register holding
+// sdim^n levels, qudit 0 being the most significant digit.
+template <typename T>
+RVec<T> reduced_probabilities(
+    const QReg<T>& reg, uint64_t sdim, uint64_t idx_qudit) {
+  uint64_t nqudits = 0;
+  uint64_t dim = 1;
+  while (dim < reg.dim()) {
+    dim *= sdim;
+    ++nqudits;
+  }
+  Expects(sdim > 1 && dim == reg.dim() && idx_qudit < nqudits);
+
+  uint64_t stride = 1;
+  for (uint64_t k = idx_qudit + 1; k < nqudits; ++k)
+    stride *= sdim;
+
+  const Cmplx<T>* psi = reg.data();
+  auto accumulate = [psi, sdim, stride](T* res, uint64_t begin, uint64_t end) {
+    for (uint64_t i = begin; i < end; ++i)
+      res[(i / stride) % sdim] += probability(psi[i]);
+  };
+
+  RVec<T> res(sdim, 0.0);
+  if (reg.dim() < kParallelThreshold) {
+    accumulate(res.data(), 0, reg.dim());
+    return res;
+  }
+
+  ThreadPool& pool = ThreadPool::global();
+  std::vector<T> partial(pool.nthreads() * sdim, 0.0);
+  pool.run(reg.dim(), [&](uint64_t tid, uint64_t begin, uint64_t end) {
+    accumulate(partial.data() + tid * sdim, begin, end);
+  });
+  for (uint64_t tid = 0; tid < pool.nthreads(); ++tid)
+    for (uint64_t s = 0; s < sdim; ++s)
+      res[s] += partial[tid * sdim + s];
+  return res;
+}
+
+} // namespace qstate
+} // namespace qengine
+
+#endif // QENGINE_INCLUDE_EXPECTATION_H_
@@ -0,0 +1,140 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_INCLUDE_INSTRUCTION_H_
+#define QENGINE_INCLUDE_INSTRUCTION_H_
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "circuit.h"
+#include "qreg.h"
+#include "types.h"
+
+namespace qengine {
+inline namespace qsystem {
+
+enum class OpCode : uint8_t {
+  apply = 0,
+  applyX = 1,
+  applyZ = 2,
+  applyXconjugate = 3,
+  applyZconjugate = 4,
+  measure = 5,
+  applyDiagonal = 6,
+};
+
+// One Circuit call. `i` is the level for applyX/applyZ and the index of the
+// classical register for measure; `mat` is only set for apply and `phases`
+// only for applyDiagonal.
+template <typename T>
+struct Instruction {
+  OpCode op;
+  uint64_t idx_qreg;
+  uint64_t i;
+  Cmplx<T> x;
+  Cmplx<T> y;
+  double tau;
+  CMat<T> mat;
+  RVec<double> phases;
+};
+
+template <typename T>
+using Program = std::vector<Instruction<T>>;
+
+// A Program together with the circuit shape it runs on.
+template <typename T>
+struct CompiledCircuit {
+  uint64_t nreg;
+  uint64_t dim;
+  Program<T> program;
+};
+
+// Number of runs that ended with a given value of all cregs.
+using Histogram = std::map<std::vector<CReg>, uint64_t>;
+
+template <typename T>
+void execute(Circuit<T>& circuit, const Instruction<T>& ins) {
+  switch (ins.op) {
+  case OpCode::apply:
+    circuit.apply(ins.idx_qreg, ins.mat);
+    break;
+  case OpCode::applyX:
+    circuit.applyX(ins.idx_qreg, ins.i, ins.x, ins.y);
+    break;
+  case OpCode::applyZ:
+    circuit.applyZ(ins.idx_qreg, ins.i, ins.tau);
+    break;
+  case OpCode::applyXconjugate:
+    circuit.applyXconjugate(ins.idx_qreg, ins.i, ins.x, ins.y);
+    break;
+  case OpCode::applyZconjugate:
+    circuit.applyZconjugate(ins.idx_qreg, ins.i, ins.tau);
+    break;
+  case OpCode::measure:
+    circuit.measure(ins.idx_qreg, ins.i);
+    break;
+  case OpCode::applyDiagonal:
+    circuit.applyDiagonal(ins.idx_qreg, ins.phases);
+    break;
+  }
+}
+
+// Runs a gate directly on a register; measure needs the circuit's classical
+// registers and engine and is skipped.
+template <typename T>
+void execute(QReg<T>& reg, const Instruction<T>& ins) {
+  switch (ins.op) {
+  case OpCode::apply:
+    reg.apply(ins.mat);
+    break;
+  case OpCode::applyX:
+    reg.applyX(ins.i, ins.x, ins.y);
+    break;
+  case OpCode::applyZ:
+    reg.applyZ(ins.i, ins.tau);
+    break;
+  case OpCode::applyXconjugate:
+    reg.applyXconjugate(ins.i, ins.x, ins.y);
+    break;
+  case OpCode::applyZconjugate:
+    reg.applyZconjugate(ins.i, ins.tau);
+    break;
+  case OpCode::applyDiagonal:
+    reg.applyDiagonal(ins.phases);
+    break;
+  case OpCode::measure:
+    break;
+  }
+}
+
+template <typename T>
+void execute(Circuit<T>& circuit, const Program<T>& program) {
+  for (const auto & ins : program)
+    execute(circuit, ins);
+}
+
+} // namespace qsystem
+} // namespace qengine
+
+#endif // QENGINE_INCLUDE_INSTRUCTION_H_
@@ -0,0 +1,335 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_INCLUDE_JOB_EXECUTOR_H_
+#define QENGINE_INCLUDE_JOB_EXECUTOR_H_
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#define QENGINE_HAS_COROUTINES 1
+#endif
+#endif
+
+#include "circuit.h"
+#include "instruction.h"
+#include "types.h"
+
+#include <gsl/gsl_assert>
+
+namespace qengine {
+inline namespace qsystem {
+
+// Outcome of a job: the cregs of the last shot and the counts of all shots.
+struct JobResult {
+  std::vector<CReg> cregs;
+  Histogram histogram;
+};
+
+// Runs submitted circuits on its own workers. The queue holds at most
+// `capacity` pending jobs: submit() blocks while it is full, which pushes
+// back on producers, and try_submit() returns false instead. Shot k of a
+// job measures with an engine seeded from (seed, k). Callbacks run on the
+// worker; an exception thrown by a callback is dropped.
+template <typename T>
+class JobExecutor {
+public:
+  using Callback = std::function<void(JobResult, std::exception_ptr)>;
+
+  JobExecutor<T>() = delete;
+  ~JobExecutor<T>();
+  JobExecutor<T>(const JobExecutor<T>&) = delete;
+  JobExecutor<T>(JobExecutor<T>&&) = delete;
+  JobExecutor<T>& operator=(const JobExecutor<T>&) = delete;
+  JobExecutor<T>& operator=(JobExecutor<T>&&) = delete;
+
+  // nthreads == 0 uses all cores.
+  JobExecutor<T>(uint64_t nthreads, uint64_t capacity);
+
+  std::future<JobResult> submit(std::shared_ptr<const CompiledCircuit<T>> job,
+                                uint64_t shots = 1, uint32_t seed = 1);
+  void submit(std::shared_ptr<const CompiledCircuit<T>> job, uint64_t shots,
+              uint32_t seed, Callback callback);
+  bool try_submit(std::shared_ptr<const CompiledCircuit<T>> job,
+                  uint64_t shots, uint32_t seed,
+                  std::future<JobResult>& result);
+  bool try_submit(std::shared_ptr<const CompiledCircuit<T>> job,
+                  uint64_t shots, uint32_t seed, Callback callback);
+
+  uint64_t capacity() const;
+  uint64_t queued() const;
+  // Whether the calling thread is one of this executor's workers.
+  bool on_worker() const;
+
+  static JobResult run(const CompiledCircuit<T>& job, uint64_t shots,
+                       uint32_t seed);
+
+private:
+  struct Task {
+    std::shared_ptr<const CompiledCircuit<T>> job;
+    uint64_t shots;
+    uint32_t seed;
+    Callback callback;
+  };
+
+  bool push(Task task, bool block);
+  void work();
+  static const JobExecutor<T>*& current();
+
+  uint64_t capacity_;
+  std::deque<Task> queue_;
+  mutable std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  bool stop_ = false;
+  std::vector<std::thread> workers_;
+};
+
+template <typename T>
+JobExecutor<T>::JobExecutor(uint64_t nthreads, uint64_t capacity)
+  : capacity_{capacity} {
+  Expects(capacity_ > 0);
+  if (nthreads == 0)
+    nthreads = std::max(1u, std::thread::hardware_concurrency());
+  for (uint64_t t = 0; t < nthreads; ++t)
+    workers_.emplace_back([this] { work(); });
+}
+
+// Pending jobs are still run before the workers exit.
+template <typename T>
+JobExecutor<T>::~JobExecutor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  not_empty_.notify_all();
+  for (auto & worker : workers_)
+    worker.join();
+}
+
+template <typename T>
+std::future<JobResult> JobExecutor<T>::submit(
+    std::shared_ptr<const CompiledCircuit<T>> job, uint64_t shots,
+    uint32_t seed) {
+  auto promise = std::make_shared<std::promise<JobResult>>();
+  std::future<JobResult> res = promise->get_future();
+  submit(std::move(job), shots, seed,
+         [promise](JobResult result, std::exception_ptr error) {
+    if (error)
+      promise->set_exception(error);
+    else
+      promise->set_value(std::move(result));
+  });
+  return res;
+}
+
+template <typename T>
+void JobExecutor<T>::submit(std::shared_ptr<const CompiledCircuit<T>> job,
+                            uint64_t shots, uint32_t seed, Callback callback) {
+  Expects(job && shots > 0);
+  push({std::move(job), shots, seed, std::move(callback)}, true);
+}
+
+template <typename T>
+bool JobExecutor<T>::try_submit(std::shared_ptr<const CompiledCircuit<T>> job,
+                                uint64_t shots, uint32_t seed,
+                                std::future<JobResult>& result) {
+  Expects(job && shots > 0);
+  auto promise = std::make_shared<std::promise<JobResult>>();
+  std::future<JobResult> future = promise->get_future();
+  const bool ok = push({std::move(job), shots, seed,
+                        [promise](JobResult res, std::exception_ptr error) {
+    if (error)
+      promise->set_exception(error);
+    else
+      promise->set_value(std::move(res));
+  }}, false);
+  if (ok)
+    result = std::move(future);
+  return ok;
+}
+
+template <typename T>
+bool JobExecutor<T>::try_submit(std::shared_ptr<const CompiledCircuit<T>> job,
+                                uint64_t shots, uint32_t seed,
+                                Callback callback) {
+  Expects(job && shots > 0);
+  return push({std::move(job), shots, seed, std::move(callback)}, false);
+}
+
+template <typename T>
+uint64_t JobExecutor<T>::capacity() const { return capacity_; }
+
+template <typename T>
+uint64_t JobExecutor<T>::queued() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queue_.size();
+}
+
+template <typename T>
+bool JobExecutor<T>::on_worker() const { return current() == this; }
+
+template <typename T>
+const JobExecutor<T>*& JobExecutor<T>::current() {
+  static thread_local const JobExecutor<T>* executor = nullptr;
+  return executor;
+}
+
+template <typename T>
+JobResult JobExecutor<T>::run(const CompiledCircuit<T>& job, uint64_t shots,
+                              uint32_t seed) {
+  JobResult res;
+  for (uint64_t k = 0; k < shots; ++k) {
+    std::seed_seq seq{seed, static_cast<uint32_t>(k),
+                      static_cast<uint32_t>(k >> 32)};
+    uint32_t shot_seed = 0;
+    seq.generate(&shot_seed, &shot_seed + 1);
+
+    Circuit<T> circuit(job.nreg, job.dim, shot_seed);
+    execute(circuit, job.program);
+    res.cregs = circuit.cregs();
+    ++res.histogram[res.cregs];
+  }
+  return res;
+}
+
+template <typename T>
+bool JobExecutor<T>::push(Task task, bool block) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (block)
+      not_full_.wait(lock, [this] { return queue_.size() < capacity_; });
+    else if (queue_.size() >= capacity_)
+      return false;
+    queue_.push_back(std::move(task));
+  }
+  not_empty_.notify_one();
+  return true;
+}
+
+template <typename T>
+void JobExecutor<T>::work() {
+  current() = this;
+  for (;;) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      not_empty_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+      if (queue_.empty())
+        return;
+      task = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    not_full_.notify_one();
+
+    JobResult result;
+    std::exception_ptr error;
+    try {
+      result = run(*task.job, task.shots, task.seed);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    try {
+      task.callback(std::move(result), error);
+    } catch (...) {
+    }
+  }
+}
+
+#ifdef QENGINE_HAS_COROUTINES
+// co_await schedule(executor, job, shots, seed) suspends the coroutine until
+// the job finishes and resumes it on the worker that ran it. A coroutine
+// already on a worker does not wait for queue space, which could block
+// every worker: with the queue full it runs the job inline instead.
+template <typename T>
+class JobAwaiter {
+public:
+  JobAwaiter(JobExecutor<T>& executor,
+             std::shared_ptr<const CompiledCircuit<T>> job, uint64_t shots,
+             uint32_t seed)
+    : executor_(executor), job_{std::move(job)}, shots_{shots},
+      seed_{seed} {}
+
+  bool await_ready() const noexcept { return false; }
+
+  bool await_suspend(std::coroutine_handle<> handle) {
+    auto resume = [this, handle](JobResult result,
+                                 std::exception_ptr error) {
+      result_ = std::move(result);
+      error_ = error;
+      handle.resume();
+    };
+    if (!executor_.on_worker()) {
+      executor_.submit(job_, shots_, seed_, resume);
+      return true;
+    }
+    if (executor_.try_submit(job_, shots_, seed_, resume))
+      return true;
+    try {
+      result_ = JobExecutor<T>::run(*job_, shots_, seed_);
+    } catch (...) {
+      error_ = std::current_exception();
+    }
+    return false;
+  }
+
+  JobResult await_resume() {
+    if (error_)
+      std::rethrow_exception(error_);
+    return std::move(result_);
+  }
+
+private:
+  JobExecutor<T>& executor_;
+  std::shared_ptr<const CompiledCircuit<T>> job_;
+  uint64_t shots_;
+  uint32_t seed_;
+  JobResult result_;
+  std::exception_ptr error_;
+};
+
+template <typename T>
+JobAwaiter<T> schedule(JobExecutor<T>& executor,
+                       std::shared_ptr<const CompiledCircuit<T>> job,
+                       uint64_t shots = 1, uint32_t seed = 1) {
+  return JobAwaiter<T>(executor, std::move(job), shots, seed);
+}
+#endif
+
+} // namespace qsystem
+} // namespace qengine
+
+#endif // QENGINE_INCLUDE_JOB_EXECUTOR_H_
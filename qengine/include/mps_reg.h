@@ -0,0 +1,507 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_INCLUDE_MPS_REG_H_
+#define QENGINE_INCLUDE_MPS_REG_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "decompositions.h"
+#include "ireg.h"
+#include "math_operations.h"
+#include "qreg.h"
+#include "types.h"
+
+#include <gsl/gsl_assert>
+
+namespace qengine {
+inline namespace qstate {
+
+// Register of `size` qudits of dimension `sdim` stored as a matrix product
+// state. Site k holds a chi_k x sdim x chi_{k+1} tensor,
+// A_k(l, s, r) = tensors_[k][l + chi_k * (s + sdim * r)], so memory is
+// O(size * sdim * max_bond^2) instead of sdim^size. The basis index of the
+// dense state is sum_k s_k * sdim^(size - 1 - k): site 0 is the most
+// significant digit, as in Matrix::tensor_times.
+//
+// The tensors are kept in mixed canonical form: sites left of the
+// orthogonality centre are left isometries and sites right of it right
+// isometries. Two-site gates first move the centre onto their pair, so a
+// truncation discards weight of the whole state; the state is then
+// renormalized and discarded_weight() sums the weights discarded.
+template <typename T>
+class MPSReg : public IReg<T> {
+public:
+  MPSReg<T>();
+  virtual ~MPSReg<T>();
+  MPSReg<T>(const MPSReg<T>&);
+  MPSReg<T>(MPSReg<T>&&);
+  MPSReg<T>& operator=(const MPSReg<T>&);
+  MPSReg<T>& operator=(MPSReg<T>&&);
+
+  MPSReg<T>(uint64_t sdim, uint64_t size, uint64_t max_bond = 64,
+            T cutoff = 1e-12);
+
+  virtual uint64_t size() const override;
+
+  // sdim x sdim acts on qudit idx_qudit; sdim^2 x sdim^2 acts on qudits
+  // idx_qudit and idx_qudit + 1.
+  void apply(const CMat<T>& mat, uint64_t idx_qudit = 0);
+
+  void applyX(uint64_t idx_qudit, uint64_t i, T x, T y);
+  void applyX(uint64_t idx_qudit, uint64_t i, Cmplx<T> x, Cmplx<T> y);
+  void applyZ(uint64_t idx_qudit, uint64_t i, double tau);
+  void applyXconjugate(uint64_t idx_qudit, uint64_t i, T x, T y);
+  void applyXconjugate(uint64_t idx_qudit, uint64_t i, Cmplx<T> x, Cmplx<T> y);
+  void applyZconjugate(uint64_t idx_qudit, uint64_t i, double tau);
+
+  uint64_t sdim() const;
+  uint64_t bond_dim(uint64_t idx_bond) const;
+  uint64_t max_bond() const;
+  T discarded_weight() const;
+
+  Cmplx<T> amplitude(const std::vector<uint64_t>& digits) const;
+  T norm() const;
+  QReg<T> to_qreg() const;
+
+  std::vector<CReg> measure(std::mt19937& mte) const;
+  std::vector<std::vector<CReg>> sample(std::mt19937& mte,
+                                        uint64_t nshots) const;
+
+private:
+  Cmplx<T>& at(uint64_t k, uint64_t l, uint64_t s, uint64_t r);
+  Cmplx<T> at(uint64_t k, uint64_t l, uint64_t s, uint64_t r) const;
+  template <typename C>
+  void apply_local(uint64_t idx_qudit, uint64_t i, const Givens<C>& g);
+  void apply_one(const CMat<T>& mat, uint64_t k);
+  void apply_two(const CMat<T>& mat, uint64_t k);
+  void move_centre(uint64_t k);
+  std::vector<CVec<T>> right_environments() const;
+
+  uint64_t sdim_;
+  uint64_t size_;
+  uint64_t max_bond_;
+  T cutoff_;
+  T discarded_;
+  uint64_t centre_;
+  std::vector<uint64_t> bonds_;
+  std::vector<CVec<T>> tensors_;
+};
+
+template <typename T>
+MPSReg<T>::MPSReg() = default;
+
+template <typename T>
+MPSReg<T>::~MPSReg() = default;
+
+template <typename T>
+MPSReg<T>::MPSReg(const MPSReg<T>&) = default;
+
+template <typename T>
+MPSReg<T>::MPSReg(MPSReg<T>&&) = default;
+
+template <typename T>
+MPSReg<T>& MPSReg<T>::operator=(const MPSReg<T>&) = default;
+
+template <typename T>
+MPSReg<T>& MPSReg<T>::operator=(MPSReg<T>&&) = default;
+
+template <typename T>
+MPSReg<T>::MPSReg(uint64_t sdim, uint64_t size, uint64_t max_bond, T cutoff)
+  : sdim_{sdim}, size_{size}, max_bond_{max_bond}, cutoff_{cutoff},
+    discarded_{0.0}, centre_{0}, bonds_(size + 1, 1), tensors_(size, CVec<T>(sdim)) {
+  Expects(sdim > 0 && size > 0 && max_bond > 0);
+  for (auto & tensor : tensors_)
+    tensor[0] = 1.0;
+}
+
+template <typename T>
+uint64_t MPSReg<T>::size() const { return size_; }
+
+template <typename T>
+uint64_t MPSReg<T>::sdim() const { return sdim_; }
+
+template <typename T>
+uint64_t MPSReg<T>::bond_dim(uint64_t idx_bond) const {
+  Expects(idx_bond <= size_);
+  return bonds_[idx_bond];
+}
+
+template <typename T>
+uint64_t MPSReg<T>::max_bond() const {
+  return *std::max_element(bonds_.begin(), bonds_.end());
+}
+
+template <typename T>
+T MPSReg<T>::discarded_weight() const { return discarded_; }
+
+template <typename T>
+Cmplx<T>& MPSReg<T>::at(uint64_t k, uint64_t l, uint64_t s, uint64_t r) {
+  return tensors_[k][l + bonds_[k] * (s + sdim_ * r)];
+}
+
+template <typename T>
+Cmplx<T> MPSReg<T>::at(uint64_t k, uint64_t l, uint64_t s, uint64_t r) const {
+  return tensors_[k][l + bonds_[k] * (s + sdim_ * r)];
+}
+
+template <typename T>
+template <typename C>
+void MPSReg<T>::apply_local(uint64_t k, uint64_t i, const Givens<C>& g) {
+  for (uint64_t r = 0; r < bonds_[k + 1]; ++r)
+    for (uint64_t l = 0; l < bonds_[k]; ++l)
+      apply_givens(g, at(k, l, i - 1, r), at(k, l, i, r));
+}
+
+template <typename T>
+void MPSReg<T>::applyX(uint64_t idx_qudit, uint64_t i, T x, T y) {
+  Expects(idx_qudit < size_ && 0 < i && i < sdim_);
+  apply_local(idx_qudit, i, givens_X(x, y));
+}
+
+template <typename T>
+void MPSReg<T>::applyX(uint64_t idx_qudit, uint64_t i, Cmplx<T> x, Cmplx<T> y) {
+  Expects(idx_qudit < size_ && 0 < i && i < sdim_);
+  apply_local(idx_qudit, i, givens_X(x, y));
+}
+
+template <typename T>
+void MPSReg<T>::applyXconjugate(uint64_t idx_qudit, uint64_t i, T x, T y) {
+  Expects(idx_qudit < size_ && 0 < i && i < sdim_);
+  apply_local(idx_qudit, i, givens_Xconjugate(x, y));
+}
+
+template <typename T>
+void MPSReg<T>::applyXconjugate(
+    uint64_t idx_qudit, uint64_t i, Cmplx<T> x, Cmplx<T> y) {
+  Expects(idx_qudit < size_ && 0 < i && i < sdim_);
+  apply_local(idx_qudit, i, givens_Xconjugate(x, y));
+}
+
+template <typename T>
+void MPSReg<T>::applyZ(uint64_t idx_qudit, uint64_t i, double tau) {
+  Expects(idx_qudit < size_ && i < sdim_);
+  const Cmplx<T> phase(std::cos(tau), std::sin(tau));
+  for (uint64_t r = 0; r < bonds_[idx_qudit + 1]; ++r)
+    for (uint64_t l = 0; l < bonds_[idx_qudit]; ++l)
+      at(idx_qudit, l, i, r) *= phase;
+}
+
+template <typename T>
+void MPSReg<T>::applyZconjugate(uint64_t idx_qudit, uint64_t i, double tau) {
+  applyZ(idx_qudit, i, -tau);
+}
+
+template <typename T>
+void MPSReg<T>::apply(const CMat<T>& mat, uint64_t idx_qudit) {
+  if (mat.nrows() == sdim_) {
+    Expects(idx_qudit < size_);
+    apply_one(mat, idx_qudit);
+  } else {
+    Expects(mat.nrows() == sdim_ * sdim_ && idx_qudit + 1 < size_);
+    apply_two(mat, idx_qudit);
+  }
+}
+
+// The gate need not be unitary, so it is applied at the centre.
+template <typename T>
+void MPSReg<T>::apply_one(const CMat<T>& mat, uint64_t k) {
+  move_centre(k);
+  CVec<T> res(tensors_[k].size());
+  const uint64_t chi_l = bonds_[k];
+  for (uint64_t r = 0; r < bonds_[k + 1]; ++r)
+    for (uint64_t t = 0; t < sdim_; ++t)
+      for (uint64_t s = 0; s < sdim_; ++s) {
+        const Cmplx<T> m_st = mat(s, t);
+        for (uint64_t l = 0; l < chi_l; ++l)
+          res[l + chi_l * (s + sdim_ * r)] += m_st * at(k, l, t, r);
+      }
+  tensors_[k] = std::move(res);
+}
+
+// Moves the centre one site at a time, splitting the centre tensor with an
+// SVD: the isometric factor stays and S Vh (or U S) moves to the next site.
+// No singular value is dropped, so the state is unchanged.
+template <typename T>
+void MPSReg<T>::move_centre(uint64_t k) {
+  const uint64_t d = sdim_;
+  for (; centre_ < k; ++centre_) {
+    const uint64_t c = centre_;
+    const uint64_t chi_l = bonds_[c];
+    const uint64_t chi_m = bonds_[c + 1];
+    const uint64_t chi_r = bonds_[c + 2];
+
+    // A((l, s), m)
+    Matrix<Cmplx<T>> a(chi_l * d, chi_m);
+    for (uint64_t m = 0; m < chi_m; ++m)
+      for (uint64_t s = 0; s < d; ++s)
+        for (uint64_t l = 0; l < chi_l; ++l)
+          a(l + chi_l * s, m) = at(c, l, s, m);
+    const SVD<T> dec = svd(a);
+    const uint64_t chi = dec.S.size();
+
+    CVec<T> left(chi_l * d * chi);
+    for (uint64_t j = 0; j < chi; ++j)
+      for (uint64_t s = 0; s < d; ++s)
+        for (uint64_t l = 0; l < chi_l; ++l)
+          left[l + chi_l * (s + d * j)] = dec.U(l + chi_l * s, j);
+
+    CVec<T> right(chi * d * chi_r);
+    for (uint64_t r = 0; r < chi_r; ++r)
+      for (uint64_t s = 0; s < d; ++s)
+        for (uint64_t m = 0; m < chi_m; ++m) {
+          const Cmplx<T> b = at(c + 1, m, s, r);
+          for (uint64_t j = 0; j < chi; ++j)
+            right[j + chi * (s + d * r)] += dec.S[j] * dec.Vh(j, m) * b;
+        }
+
+    bonds_[c + 1] = chi;
+    tensors_[c] = std::move(left);
+    tensors_[c + 1] = std::move(right);
+  }
+  for (; centre_ > k; --centre_) {
+    const uint64_t c = centre_;
+    const uint64_t chi_l = bonds_[c - 1];
+    const uint64_t chi_m = bonds_[c];
+    const uint64_t chi_r = bonds_[c + 1];
+
+    // A(m, (s, r))
+    Matrix<Cmplx<T>> a(chi_m, d * chi_r);
+    for (uint64_t r = 0; r < chi_r; ++r)
+      for (uint64_t s = 0; s < d; ++s)
+        for (uint64_t m = 0; m < chi_m; ++m)
+          a(m, s + d * r) = at(c, m, s, r);
+    const SVD<T> dec = svd(a);
+    const uint64_t chi = dec.S.size();
+
+    CVec<T> right(chi * d * chi_r);
+    for (uint64_t r = 0; r < chi_r; ++r)
+      for (uint64_t s = 0; s < d; ++s)
+        for (uint64_t j = 0; j < chi; ++j)
+          right[j + chi * (s + d * r)] = dec.Vh(j, s + d * r);
+
+    CVec<T> left(chi_l * d * chi);
+    for (uint64_t j = 0; j < chi; ++j)
+      for (uint64_t m = 0; m < chi_m; ++m) {
+        const Cmplx<T> us = dec.U(m, j) * dec.S[j];
+        for (uint64_t s = 0; s < d; ++s)
+          for (uint64_t l = 0; l < chi_l; ++l)
+            left[l + chi_l * (s + d * j)] += at(c - 1, l, s, m) * us;
+      }
+
+    bonds_[c] = chi;
+    tensors_[c - 1] = std::move(left);
+    tensors_[c] = std::move(right);
+  }
+}
+
+// Contracts sites k and k + 1 at the centre, applies the gate and splits
+// the result with a truncated SVD; the singular values, rescaled to the
+// norm before truncation, are kept on site k + 1, the new centre.
+template <typename T>
+void MPSReg<T>::apply_two(const CMat<T>& mat, uint64_t k) {
+  move_centre(k);
+  const uint64_t chi_l = bonds_[k];
+  const uint64_t chi_m = bonds_[k + 1];
+  const uint64_t chi_r = bonds_[k + 2];
+  const uint64_t d = sdim_;
+
+  // theta((l, s1), (s2, r)) before the gate
+  Matrix<Cmplx<T>> theta(chi_l * d, d * chi_r);
+  for (uint64_t r = 0; r < chi_r; ++r)
+    for (uint64_t s2 = 0; s2 < d; ++s2)
+      for (uint64_t m = 0; m < chi_m; ++m) {
+        const Cmplx<T> b = at(k + 1, m, s2, r);
+        for (uint64_t s1 = 0; s1 < d; ++s1)
+          for (uint64_t l = 0; l < chi_l; ++l)
+            theta(l + chi_l * s1, s2 + d * r) += at(k, l, s1, m) * b;
+      }
+
+  Matrix<Cmplx<T>> gated(chi_l * d, d * chi_r);
+  for (uint64_t r = 0; r < chi_r; ++r)
+    for (uint64_t t1 = 0; t1 < d; ++t1)
+      for (uint64_t t2 = 0; t2 < d; ++t2)
+        for (uint64_t s1 = 0; s1 < d; ++s1)
+          for (uint64_t s2 = 0; s2 < d; ++s2) {
+            const Cmplx<T> g = mat(s1 * d + s2, t1 * d + t2);
+            if (g == Cmplx<T>(0.0))
+              continue;
+            for (uint64_t l = 0; l < chi_l; ++l)
+              gated(l + chi_l * s1, s2 + d * r) +=
+                g * theta(l + chi_l * t1, t2 + d * r);
+          }
+
+  const SVD<T> dec = svd(gated);
+  T total = 0.0;
+  for (const auto & s : dec.S)
+    total += s * s;
+  uint64_t keep = 1;
+  while (keep < dec.S.size() && keep < max_bond_
+         && dec.S[keep] * dec.S[keep] > cutoff_ * total)
+    ++keep;
+  T kept = 0.0;
+  for (uint64_t m = 0; m < keep; ++m)
+    kept += dec.S[m] * dec.S[m];
+  discarded_ += total > 0 ? (total - kept) / total : 0.0;
+  const T scale = kept > 0 ? std::sqrt(total / kept) : T(1);
+
+  bonds_[k + 1] = keep;
+  CVec<T> left(chi_l * d * keep);
+  for (uint64_t m = 0; m < keep; ++m)
+    for (uint64_t s1 = 0; s1 < d; ++s1)
+      for (uint64_t l = 0; l < chi_l; ++l)
+        left[l + chi_l * (s1 + d * m)] = dec.U(l + chi_l * s1, m);
+
+  CVec<T> right(keep * d * chi_r);
+  for (uint64_t r = 0; r < chi_r; ++r)
+    for (uint64_t s2 = 0; s2 < d; ++s2)
+      for (uint64_t m = 0; m < keep; ++m)
+        right[m + keep * (s2 + d * r)] =
+          scale * dec.S[m] * dec.Vh(m, s2 + d * r);
+
+  tensors_[k] = std::move(left);
+  tensors_[k + 1] = std::move(right);
+  centre_ = k + 1;
+}
+
+template <typename T>
+Cmplx<T> MPSReg<T>::amplitude(const std::vector<uint64_t>& digits) const {
+  Expects(digits.size() == size_);
+
+  CVec<T> v(1, 1.0);
+  for (uint64_t k = 0; k < size_; ++k) {
+    CVec<T> next(bonds_[k + 1]);
+    for (uint64_t r = 0; r < bonds_[k + 1]; ++r)
+      for (uint64_t l = 0; l < bonds_[k]; ++l)
+        next[r] += v[l] * at(k, l, digits[k], r);
+    v = std::move(next);
+  }
+  return v[0];
+}
+
+// E_k(l, l') = sum over digits of sites k.. of A(l, ...) conj(A(l', ...)),
+// stored column-major chi_k x chi_k; E_size = 1.
+template <typename T>
+std::vector<CVec<T>> MPSReg<T>::right_environments() const {
+  std::vector<CVec<T>> env(size_ + 1);
+  env[size_] = CVec<T>(1, 1.0);
+  for (uint64_t k = size_; k-- > 0;) {
+    const uint64_t chi_l = bonds_[k];
+    const uint64_t chi_r = bonds_[k + 1];
+    env[k] = CVec<T>(chi_l * chi_l);
+    for (uint64_t s = 0; s < sdim_; ++s)
+      for (uint64_t r = 0; r < chi_r; ++r)
+        for (uint64_t rp = 0; rp < chi_r; ++rp) {
+          const Cmplx<T> e = env[k + 1][r + chi_r * rp];
+          if (e == Cmplx<T>(0.0))
+            continue;
+          for (uint64_t lp = 0; lp < chi_l; ++lp) {
+            const Cmplx<T> a_conj = std::conj(at(k, lp, s, rp)) * e;
+            for (uint64_t l = 0; l < chi_l; ++l)
+              env[k][l + chi_l * lp] += at(k, l, s, r) * a_conj;
+          }
+        }
+  }
+  return env;
+}
+
+template <typename T>
+T MPSReg<T>::norm() const {
+  return std::sqrt(right_environments()[0][0].real());
+}
+
+template <typename T>
+QReg<T> MPSReg<T>::to_qreg() const {
+  uint64_t dim = 1;
+  for (uint64_t k = 0; k < size_; ++k)
+    dim *= sdim_;
+
+  CVec<T> amplitudes(dim);
+  std::vector<uint64_t> digits(size_);
+  for (uint64_t idx = 0; idx < dim; ++idx) {
+    uint64_t rest = idx;
+    for (uint64_t k = size_; k-- > 0;) {
+      digits[k] = rest % sdim_;
+      rest /= sdim_;
+    }
+    amplitudes[idx] = amplitude(digits);
+  }
+  return QReg<T>(dim, 1, amplitudes.data());
+}
+
+template <typename T>
+std::vector<CReg> MPSReg<T>::measure(std::mt19937& mte) const {
+  return sample(mte, 1)[0];
+}
+
+// Draws digits site by site from p(s_k | s_0 .. s_{k-1}), using the right
+// environments computed once for all shots.
+template <typename T>
+std::vector<std::vector<CReg>> MPSReg<T>::sample(
+    std::mt19937& mte, uint64_t nshots) const {
+  const std::vector<CVec<T>> env = right_environments();
+  std::vector<std::vector<CReg>> shots(nshots, std::vector<CReg>(size_));
+  std::uniform_real_distribution<T> uniform;
+
+  RVec<T> probs(sdim_);
+  std::vector<CVec<T>> candidates(sdim_);
+  for (auto & shot : shots) {
+    CVec<T> v(1, 1.0);
+    for (uint64_t k = 0; k < size_; ++k) {
+      const uint64_t chi_l = bonds_[k];
+      const uint64_t chi_r = bonds_[k + 1];
+      T total = 0.0;
+      for (uint64_t s = 0; s < sdim_; ++s) {
+        candidates[s].assign(chi_r, 0.0);
+        for (uint64_t r = 0; r < chi_r; ++r)
+          for (uint64_t l = 0; l < chi_l; ++l)
+            candidates[s][r] += v[l] * at(k, l, s, r);
+        Cmplx<T> p = 0.0;
+        for (uint64_t rp = 0; rp < chi_r; ++rp)
+          for (uint64_t r = 0; r < chi_r; ++r)
+            p += candidates[s][r] * env[k + 1][r + chi_r * rp]
+               * std::conj(candidates[s][rp]);
+        probs[s] = std::max<T>(p.real(), 0.0);
+        total += probs[s];
+      }
+
+      T u = uniform(mte) * total;
+      uint64_t s = 0;
+      while (s + 1 < sdim_ && u >= probs[s]) {
+        u -= probs[s];
+        ++s;
+      }
+      shot[k] = static_cast<CReg>(s);
+      v = candidates[s];
+    }
+  }
+  return shots;
+}
+
+} // namespace qstate
+} // namespace qengine
+
+#endif // QENGINE_INCLUDE_MPS_REG_H_
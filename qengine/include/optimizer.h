@@ -0,0 +1,291 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_INCLUDE_OPTIMIZER_H_
+#define QENGINE_INCLUDE_OPTIMIZER_H_
+
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "instruction.h"
+#include "qreg.h"
+#include "types.h"
+
+#include <gsl/gsl_assert>
+
+namespace qengine {
+inline namespace qsystem {
+
+// Levels per block when ordering commuting rotations for cache reuse.
+constexpr uint64_t kLocalityBlock = 1024;
+// Merged phases closer than this to a multiple of 2 pi are dropped.
+constexpr double kPhaseTolerance = 1e-12;
+
+struct OptimizationReport {
+  uint64_t gates_before = 0;
+  uint64_t gates_after = 0;
+  uint64_t diagonal_before = 0;
+  uint64_t diagonal_after = 0;
+  uint64_t rotations_cancelled = 0;
+
+  uint64_t reduction() const { return gates_before - gates_after; }
+};
+
+// Peephole optimizer over a recorded Program, fed one instruction at a time.
+// Per register it keeps the rotations not emitted yet and a diagonal (one
+// phase per level) accumulated behind them:
+//  - applyZ, applyZconjugate and applyDiagonal are merged into that phase
+//    vector, so everything diagonal between two non-commuting gates becomes
+//    one applyZ or applyDiagonal;
+//  - a rotation on levels (i - 1, i) commutes with the diagonal when both
+//    phases there vanish and is moved in front of it, otherwise the register
+//    is flushed first;
+//  - applyX directly followed by applyXconjugate with the same operands on
+//    the same levels (or the reverse) cancels;
+//  - apply and measure flush their register.
+// A flush emits the rotations grouped by kLocalityBlock level ranges as far
+// as their dependencies allow, then the phase vector. Registers are
+// independent, so their instructions may be interleaved differently than in
+// the input; measurements keep their relative order.
+template <typename T>
+class ProgramOptimizer {
+public:
+  ProgramOptimizer<T>() = default;
+  ~ProgramOptimizer<T>() = default;
+  ProgramOptimizer<T>(const ProgramOptimizer<T>&) = default;
+  ProgramOptimizer<T>(ProgramOptimizer<T>&&) = default;
+  ProgramOptimizer<T>& operator=(const ProgramOptimizer<T>&) = default;
+  ProgramOptimizer<T>& operator=(ProgramOptimizer<T>&&) = default;
+
+  void push(const Instruction<T>& ins);
+  Program<T> finish();
+
+  const OptimizationReport& report() const { return report_; }
+
+private:
+  struct Lane {
+    Program<T> rotations;
+    std::vector<bool> live;
+    // indices of the live rotations touching a level, in program order
+    std::map<uint64_t, std::vector<uint64_t>> users;
+    std::map<uint64_t, double> phases;
+  };
+
+  static bool nonzero(double tau);
+  static bool inverse(const Instruction<T>& a, const Instruction<T>& b);
+  double phase(const Lane& lane, uint64_t level) const;
+  void push_rotation(uint64_t idx_qreg, Lane& lane, const Instruction<T>& ins);
+  void flush(uint64_t idx_qreg, Lane& lane);
+  void emit_rotations(const Lane& lane);
+  void emit_phases(uint64_t idx_qreg, const Lane& lane);
+
+  std::map<uint64_t, Lane> lanes_;
+  Program<T> out_;
+  OptimizationReport report_;
+};
+
+template <typename T>
+void ProgramOptimizer<T>::push(const Instruction<T>& ins) {
+  ++report_.gates_before;
+  Lane& lane = lanes_[ins.idx_qreg];
+  switch (ins.op) {
+  case OpCode::applyZ:
+    lane.phases[ins.i] += ins.tau;
+    ++report_.diagonal_before;
+    break;
+  case OpCode::applyZconjugate:
+    lane.phases[ins.i] -= ins.tau;
+    ++report_.diagonal_before;
+    break;
+  case OpCode::applyDiagonal:
+    for (uint64_t l = 0; l < ins.phases.size(); ++l)
+      if (ins.phases[l] != 0.0)
+        lane.phases[l] += ins.phases[l];
+    ++report_.diagonal_before;
+    break;
+  case OpCode::applyX:
+  case OpCode::applyXconjugate:
+    push_rotation(ins.idx_qreg, lane, ins);
+    break;
+  case OpCode::apply:
+  case OpCode::measure:
+    flush(ins.idx_qreg, lane);
+    out_.push_back(ins);
+    break;
+  }
+}
+
+template <typename T>
+Program<T> ProgramOptimizer<T>::finish() {
+  for (auto & lane : lanes_)
+    flush(lane.first, lane.second);
+  lanes_.clear();
+  report_.gates_after = out_.size();
+
+  Program<T> res;
+  res.swap(out_);
+  return res;
+}
+
+template <typename T>
+bool ProgramOptimizer<T>::nonzero(double tau) {
+  return std::abs(std::remainder(tau, 2 * M_PI)) > kPhaseTolerance;
+}
+
+template <typename T>
+bool ProgramOptimizer<T>::inverse(
+    const Instruction<T>& a, const Instruction<T>& b) {
+  return a.op != b.op && a.i == b.i && a.x == b.x && a.y == b.y;
+}
+
+template <typename T>
+double ProgramOptimizer<T>::phase(const Lane& lane, uint64_t level) const {
+  const auto it = lane.phases.find(level);
+  return it == lane.phases.end() ? 0.0 : it->second;
+}
+
+template <typename T>
+void ProgramOptimizer<T>::push_rotation(
+    uint64_t idx_qreg, Lane& lane, const Instruction<T>& ins) {
+  Expects(ins.i > 0);
+  const uint64_t lo = ins.i - 1;
+  const uint64_t hi = ins.i;
+  if (nonzero(phase(lane, lo)) || nonzero(phase(lane, hi)))
+    flush(idx_qreg, lane);
+
+  auto & users_lo = lane.users[lo];
+  auto & users_hi = lane.users[hi];
+  if (!users_lo.empty() && !users_hi.empty()
+      && users_lo.back() == users_hi.back()
+      && inverse(lane.rotations[users_lo.back()], ins)) {
+    lane.live[users_lo.back()] = false;
+    users_lo.pop_back();
+    users_hi.pop_back();
+    report_.rotations_cancelled += 2;
+    return;
+  }
+
+  users_lo.push_back(lane.rotations.size());
+  users_hi.push_back(lane.rotations.size());
+  lane.rotations.push_back(ins);
+  lane.live.push_back(true);
+}
+
+template <typename T>
+void ProgramOptimizer<T>::flush(uint64_t idx_qreg, Lane& lane) {
+  emit_rotations(lane);
+  emit_phases(idx_qreg, lane);
+  lane = Lane();
+}
+
+// List scheduling of the rotation dependency graph (consecutive users of a
+// level), staying in the current level block while it has ready gates.
+template <typename T>
+void ProgramOptimizer<T>::emit_rotations(const Lane& lane) {
+  const uint64_t n = lane.rotations.size();
+  std::vector<uint64_t> npred(n, 0);
+  std::vector<std::vector<uint64_t>> succ(n);
+  std::map<uint64_t, uint64_t> last;
+  std::map<uint64_t, std::set<uint64_t>> ready;
+  auto block = [&lane](uint64_t k) {
+    return lane.rotations[k].i / kLocalityBlock;
+  };
+
+  for (uint64_t k = 0; k < n; ++k) {
+    if (!lane.live[k])
+      continue;
+    const uint64_t i = lane.rotations[k].i;
+    for (uint64_t l = i - 1; l <= i; ++l) {
+      const auto it = last.find(l);
+      if (it != last.end()) {
+        succ[it->second].push_back(k);
+        ++npred[k];
+      }
+      last[l] = k;
+    }
+    if (npred[k] == 0)
+      ready[block(k)].insert(k);
+  }
+
+  uint64_t current = ready.empty() ? 0 : ready.begin()->first;
+  while (!ready.empty()) {
+    auto it = ready.find(current);
+    if (it == ready.end())
+      it = ready.begin();
+    current = it->first;
+    const uint64_t k = *it->second.begin();
+    it->second.erase(it->second.begin());
+    if (it->second.empty())
+      ready.erase(it);
+
+    out_.push_back(lane.rotations[k]);
+    for (const auto & s : succ[k])
+      if (--npred[s] == 0)
+        ready[block(s)].insert(s);
+  }
+}
+
+template <typename T>
+void ProgramOptimizer<T>::emit_phases(uint64_t idx_qreg, const Lane& lane) {
+  std::vector<std::pair<uint64_t, double>> levels;
+  for (const auto & p : lane.phases)
+    if (nonzero(p.second))
+      levels.push_back(p);
+  if (levels.empty())
+    return;
+
+  Instruction<T> ins{};
+  ins.idx_qreg = idx_qreg;
+  if (levels.size() == 1) {
+    ins.op = OpCode::applyZ;
+    ins.i = levels[0].first;
+    ins.tau = levels[0].second;
+  } else {
+    ins.op = OpCode::applyDiagonal;
+    ins.phases.assign(levels.back().first + 1, 0.0);
+    for (const auto & p : levels)
+      ins.phases[p.first] = p.second;
+  }
+  out_.push_back(ins);
+  ++report_.diagonal_after;
+}
+
+template <typename T>
+Program<T> optimize(const Program<T>& program,
+                    OptimizationReport* report = nullptr) {
+  ProgramOptimizer<T> optimizer;
+  for (const auto & ins : program)
+    optimizer.push(ins);
+  Program<T> res = optimizer.finish();
+  if (report)
+    *report = optimizer.report();
+  return res;
+}
+
+} // namespace qsystem
+} // namespace qengine
+
+#endif // QENGINE_INCLUDE_OPTIMIZER_H_
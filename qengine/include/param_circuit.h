@@ -0,0 +1,291 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_INCLUDE_PARAM_CIRCUIT_H_
+#define QENGINE_INCLUDE_PARAM_CIRCUIT_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "expectation.h"
+#include "instruction.h"
+#include "qreg.h"
+#include "types.h"
+
+#include <gsl/gsl_assert>
+
+namespace qengine {
+inline namespace qsystem {
+
+// Circuit whose rotations take their angles from a parameter vector:
+// applyXparam rotates levels (i - 1, i) by theta (x = cos, y = sin) and
+// applyZparam uses theta as tau. Fixed gates are appended as Instructions.
+// Gradients of sum_r <psi_r| O_r |psi_r> for diagonal O_r come from the
+// adjoint method: one forward run, then one backward sweep that undoes each
+// gate on both |psi> and |lambda> = O|psi> with the conjugate gates.
+template <typename T>
+class ParamCircuit {
+public:
+  ParamCircuit<T>() = delete;
+  ~ParamCircuit<T>();
+  ParamCircuit<T>(const ParamCircuit<T>&);
+  ParamCircuit<T>(ParamCircuit<T>&&);
+  ParamCircuit<T>& operator=(const ParamCircuit<T>&);
+  ParamCircuit<T>& operator=(ParamCircuit<T>&&);
+
+  ParamCircuit<T>(uint64_t nreg, uint64_t dim);
+
+  uint64_t nreg() const;
+  uint64_t dim() const;
+  uint64_t nparams() const;
+  uint64_t ngates() const;
+
+  void append(const Instruction<T>& ins);
+  void applyXparam(uint64_t idx_qreg, uint64_t i, uint64_t param);
+  void applyZparam(uint64_t idx_qreg, uint64_t i, uint64_t param);
+
+  // The gate list with every parameter bound to `params`.
+  Program<T> bind(const std::vector<double>& params) const;
+
+  std::vector<QReg<T>> run(const std::vector<double>& params) const;
+  T expectation(const std::vector<double>& params,
+                const std::vector<RVec<T>>& observables) const;
+  std::vector<double> gradient(const std::vector<double>& params,
+                               const std::vector<RVec<T>>& observables,
+                               T* value = nullptr) const;
+
+private:
+  static constexpr uint64_t kFixed = ~uint64_t{0};
+
+  static void unapply(QReg<T>& reg, const Instruction<T>& ins);
+  static Cmplx<T> derivative(const QReg<T>& lambda, const QReg<T>& psi,
+                             const Instruction<T>& ins);
+
+  uint64_t nreg_;
+  uint64_t dim_;
+  uint64_t nparams_;
+  Program<T> gates_;
+  std::vector<uint64_t> params_;
+};
+
+template <typename T>
+constexpr uint64_t ParamCircuit<T>::kFixed;
+
+template <typename T>
+ParamCircuit<T>::~ParamCircuit() = default;
+
+template <typename T>
+ParamCircuit<T>::ParamCircuit(const ParamCircuit<T>&) = default;
+
+template <typename T>
+ParamCircuit<T>::ParamCircuit(ParamCircuit<T>&&) = default;
+
+template <typename T>
+ParamCircuit<T>& ParamCircuit<T>::operator=(const ParamCircuit<T>&) = default;
+
+template <typename T>
+ParamCircuit<T>& ParamCircuit<T>::operator=(ParamCircuit<T>&&) = default;
+
+template <typename T>
+ParamCircuit<T>::ParamCircuit(uint64_t nreg, uint64_t dim)
+  : nreg_{nreg}, dim_{dim}, nparams_{0} {}
+
+template <typename T>
+uint64_t ParamCircuit<T>::nreg() const { return nreg_; }
+
+template <typename T>
+uint64_t ParamCircuit<T>::dim() const { return dim_; }
+
+template <typename T>
+uint64_t ParamCircuit<T>::nparams() const { return nparams_; }
+
+template <typename T>
+uint64_t ParamCircuit<T>::ngates() const { return gates_.size(); }
+
+template <typename T>
+void ParamCircuit<T>::append(const Instruction<T>& ins) {
+  Expects(ins.idx_qreg < nreg_ && ins.op != OpCode::measure);
+  gates_.push_back(ins);
+  params_.push_back(kFixed);
+}
+
+template <typename T>
+void ParamCircuit<T>::applyXparam(
+    uint64_t idx_qreg, uint64_t i, uint64_t param) {
+  Expects(idx_qreg < nreg_ && 0 < i && i < dim_);
+  Instruction<T> ins{};
+  ins.op = OpCode::applyX;
+  ins.idx_qreg = idx_qreg;
+  ins.i = i;
+  gates_.push_back(ins);
+  params_.push_back(param);
+  nparams_ = std::max(nparams_, param + 1);
+}
+
+template <typename T>
+void ParamCircuit<T>::applyZparam(
+    uint64_t idx_qreg, uint64_t i, uint64_t param) {
+  Expects(idx_qreg < nreg_ && i < dim_);
+  Instruction<T> ins{};
+  ins.op = OpCode::applyZ;
+  ins.idx_qreg = idx_qreg;
+  ins.i = i;
+  gates_.push_back(ins);
+  params_.push_back(param);
+  nparams_ = std::max(nparams_, param + 1);
+}
+
+template <typename T>
+Program<T> ParamCircuit<T>::bind(const std::vector<double>& params) const {
+  Expects(params.size() >= nparams_);
+
+  Program<T> res(gates_);
+  for (uint64_t k = 0; k < res.size(); ++k) {
+    if (params_[k] == kFixed)
+      continue;
+    const double theta = params[params_[k]];
+    if (res[k].op == OpCode::applyX) {
+      res[k].x = std::cos(theta);
+      res[k].y = std::sin(theta);
+    } else {
+      res[k].tau = theta;
+    }
+  }
+  return res;
+}
+
+template <typename T>
+std::vector<QReg<T>> ParamCircuit<T>::run(
+    const std::vector<double>& params) const {
+  std::vector<QReg<T>> res(nreg_, QReg<T>(dim_));
+  for (const auto & ins : bind(params))
+    execute(res[ins.idx_qreg], ins);
+  return res;
+}
+
+template <typename T>
+T ParamCircuit<T>::expectation(const std::vector<double>& params,
+                               const std::vector<RVec<T>>& observables) const {
+  Expects(observables.size() == nreg_);
+
+  const auto qregs = run(params);
+  T res = 0.0;
+  for (uint64_t r = 0; r < nreg_; ++r)
+    res += qengine::expectation(qregs[r], observables[r]);
+  return res;
+}
+
+template <typename T>
+std::vector<double> ParamCircuit<T>::gradient(
+    const std::vector<double>& params,
+    const std::vector<RVec<T>>& observables, T* value) const {
+  Expects(observables.size() == nreg_);
+
+  const Program<T> program = bind(params);
+  std::vector<QReg<T>> psi(nreg_, QReg<T>(dim_));
+  for (const auto & ins : program)
+    execute(psi[ins.idx_qreg], ins);
+
+  std::vector<QReg<T>> lambda;
+  lambda.reserve(nreg_);
+  T cost = 0.0;
+  for (uint64_t r = 0; r < nreg_; ++r) {
+    Expects(observables[r].size() == dim_);
+    cost += qengine::expectation(psi[r], observables[r]);
+    CVec<T> o_psi(psi[r].data(), psi[r].data() + dim_);
+    for (uint64_t i = 0; i < dim_; ++i)
+      o_psi[i] *= observables[r][i];
+    lambda.emplace_back(dim_, 1, o_psi.data());
+  }
+  if (value != nullptr)
+    *value = cost;
+
+  // dC/dtheta_k = 2 Re <lambda_k| dU_k |psi_{k-1}>, where psi_{k-1} is
+  // reached by undoing gate k on psi and lambda_k is lambda before undoing.
+  std::vector<double> res(nparams_, 0.0);
+  for (uint64_t k = program.size(); k-- > 0;) {
+    const Instruction<T>& ins = program[k];
+    unapply(psi[ins.idx_qreg], ins);
+    if (params_[k] != kFixed) {
+      const Cmplx<T> d =
+          derivative(lambda[ins.idx_qreg], psi[ins.idx_qreg], ins);
+      res[params_[k]] += 2 * std::real(d);
+    }
+    unapply(lambda[ins.idx_qreg], ins);
+  }
+  return res;
+}
+
+template <typename T>
+void ParamCircuit<T>::unapply(QReg<T>& reg, const Instruction<T>& ins) {
+  switch (ins.op) {
+  case OpCode::apply:
+    reg.apply(CMat<T>(ins.mat.nrows(), ins.mat.dagger().vals()));
+    break;
+  case OpCode::applyX:
+    reg.applyXconjugate(ins.i, ins.x, ins.y);
+    break;
+  case OpCode::applyZ:
+    reg.applyZconjugate(ins.i, ins.tau);
+    break;
+  case OpCode::applyXconjugate:
+    reg.applyX(ins.i, ins.x, ins.y);
+    break;
+  case OpCode::applyZconjugate:
+    reg.applyZ(ins.i, ins.tau);
+    break;
+  case OpCode::applyDiagonal: {
+    RVec<double> tau(ins.phases);
+    for (auto & t : tau)
+      t = -t;
+    reg.applyDiagonal(tau);
+    break;
+  }
+  case OpCode::measure:
+    break;
+  }
+}
+
+// <lambda| dU/dtheta |psi> touches only the levels the gate acts on. For
+// the rotation, dG/dtheta = [[-s, -c], [c, -s]]; for the phase, i e^{i tau}.
+template <typename T>
+Cmplx<T> ParamCircuit<T>::derivative(
+    const QReg<T>& lambda, const QReg<T>& psi, const Instruction<T>& ins) {
+  const Cmplx<T>* l = lambda.data();
+  const Cmplx<T>* p = psi.data();
+  const uint64_t i = ins.i;
+  if (ins.op == OpCode::applyX) {
+    const T c = std::real(ins.x);
+    const T s = std::real(ins.y);
+    return std::conj(l[i - 1]) * (-s * p[i - 1] - c * p[i])
+           + std::conj(l[i]) * (c * p[i - 1] - s * p[i]);
+  }
+  const Cmplx<T> phase(std::cos(ins.tau), std::sin(ins.tau));
+  return std::conj(l[i]) * Cmplx<T>(0.0, 1.0) * phase * p[i];
+}
+
+} // namespace qsystem
+} // namespace qengine
+
+#endif // QENGINE_INCLUDE_PARAM_CIRCUIT_H_
@@ -0,0 +1,292 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_INCLUDE_PHASE_REG_H_
+#define QENGINE_INCLUDE_PHASE_REG_H_
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ireg.h"
+#include "parallel.h"
+#include "qreg.h"
+#include "types.h"
+
+#include <gsl/gsl_assert>
+
+namespace qengine {
+inline namespace qstate {
+
+// Register whose amplitudes are r_i e^{i phi_i} with the magnitude profile
+// r fixed at construction, e.g. uniform after F0 in the hash circuits. Only
+// phi is stored per level and r is shared between copies, so the state
+// takes half the memory of a QReg and diagonal gates are real additions.
+// The first non-diagonal gate expands it into a QReg, which then receives
+// every later gate.
+template <typename T>
+class PhaseOnlyReg : public IReg<T> {
+public:
+  PhaseOnlyReg<T>() = delete;
+  virtual ~PhaseOnlyReg<T>() = default;
+  PhaseOnlyReg<T>(const PhaseOnlyReg<T>&) = default;
+  PhaseOnlyReg<T>(PhaseOnlyReg<T>&&) = default;
+  PhaseOnlyReg<T>& operator=(const PhaseOnlyReg<T>&) = default;
+  PhaseOnlyReg<T>& operator=(PhaseOnlyReg<T>&&) = default;
+
+  // r_i = 1 / sqrt(sdim), the state F0 |0>.
+  explicit PhaseOnlyReg<T>(uint64_t sdim);
+  explicit PhaseOnlyReg<T>(const RVec<T>& magnitudes);
+
+  virtual uint64_t size() const override;
+
+  void applyZ(uint64_t i, double tau);
+  void applyZconjugate(uint64_t i, double tau);
+  void applyDiagonal(const RVec<double>& tau);
+  void applyPhaseLinear(double c, double offset = 0.0);
+  void applyPhaseLinearConjugate(double c, double offset = 0.0);
+  void applyPhasePolynomial(const RVec<double>& coeffs);
+  void applyPhasePolynomialConjugate(const RVec<double>& coeffs);
+
+  void applyX(uint64_t i, T x, T y);
+  void applyX(uint64_t i, Cmplx<T> x, Cmplx<T> y);
+  void applyXconjugate(uint64_t i, T x, T y);
+  void applyXconjugate(uint64_t i, Cmplx<T> x, Cmplx<T> y);
+  void apply_givens_ladder(const RVec<T>& x, const RVec<T>& y);
+  void apply_givens_ladder_conjugate(const RVec<T>& x, const RVec<T>& y);
+
+  bool expanded() const;
+  uint64_t sdim() const;
+  const RVec<T>& magnitudes() const;
+  // Empty once expanded.
+  const RVec<T>& phases() const;
+
+  Cmplx<T> amplitude(uint64_t i) const;
+  RVec<T> probabilities() const;
+  Cmplx<T> braket_product(const PhaseOnlyReg<T>& ket) const;
+  QReg<T> to_qreg() const;
+
+private:
+  // phi_i += sign * sum_k coeffs[k] i^k, reduced mod 2 pi so that T = float
+  // keeps its precision over long phase sequences.
+  void add_polynomial(const RVec<double>& coeffs, double sign);
+  void add_phase(uint64_t i, double tau);
+  QReg<T>& expand();
+
+  std::shared_ptr<const RVec<T>> magnitudes_;
+  RVec<T> phases_;
+  bool expanded_;
+  QReg<T> qreg_;
+};
+
+template <typename T>
+PhaseOnlyReg<T>::PhaseOnlyReg(uint64_t sdim)
+  : PhaseOnlyReg<T>(RVec<T>(sdim, static_cast<T>(1.0 / std::sqrt(sdim)))) {}
+
+template <typename T>
+PhaseOnlyReg<T>::PhaseOnlyReg(const RVec<T>& magnitudes)
+  : magnitudes_(std::make_shared<const RVec<T>>(magnitudes)),
+    phases_(magnitudes.size()), expanded_{false} {
+  Expects(!magnitudes.empty());
+}
+
+template <typename T>
+uint64_t PhaseOnlyReg<T>::size() const { return 1; }
+
+template <typename T>
+bool PhaseOnlyReg<T>::expanded() const { return expanded_; }
+
+template <typename T>
+uint64_t PhaseOnlyReg<T>::sdim() const { return magnitudes_->size(); }
+
+template <typename T>
+const RVec<T>& PhaseOnlyReg<T>::magnitudes() const { return *magnitudes_; }
+
+template <typename T>
+const RVec<T>& PhaseOnlyReg<T>::phases() const { return phases_; }
+
+template <typename T>
+void PhaseOnlyReg<T>::add_phase(uint64_t i, double tau) {
+  phases_[i] = static_cast<T>(std::remainder(phases_[i] + tau, 2 * M_PI));
+}
+
+template <typename T>
+void PhaseOnlyReg<T>::applyZ(uint64_t i, double tau) {
+  Expects(i < sdim());
+  if (expanded_)
+    return qreg_.applyZ(i, tau);
+  add_phase(i, tau);
+}
+
+template <typename T>
+void PhaseOnlyReg<T>::applyZconjugate(uint64_t i, double tau) {
+  applyZ(i, -tau);
+}
+
+template <typename T>
+void PhaseOnlyReg<T>::applyDiagonal(const RVec<double>& tau) {
+  Expects(tau.size() <= sdim());
+  if (expanded_)
+    return qreg_.applyDiagonal(tau);
+  for (uint64_t i = 0; i < tau.size(); ++i)
+    add_phase(i, tau[i]);
+}
+
+template <typename T>
+void PhaseOnlyReg<T>::applyPhaseLinear(double c, double offset) {
+  applyPhasePolynomial({offset, c});
+}
+
+template <typename T>
+void PhaseOnlyReg<T>::applyPhaseLinearConjugate(double c, double offset) {
+  applyPhasePolynomialConjugate({offset, c});
+}
+
+template <typename T>
+void PhaseOnlyReg<T>::applyPhasePolynomial(const RVec<double>& coeffs) {
+  Expects(!coeffs.empty());
+  if (expanded_)
+    return qreg_.applyPhasePolynomial(coeffs);
+  add_polynomial(coeffs, 1.0);
+}
+
+template <typename T>
+void PhaseOnlyReg<T>::applyPhasePolynomialConjugate(
+    const RVec<double>& coeffs) {
+  Expects(!coeffs.empty());
+  if (expanded_)
+    return qreg_.applyPhasePolynomialConjugate(coeffs);
+  add_polynomial(coeffs, -1.0);
+}
+
+template <typename T>
+void PhaseOnlyReg<T>::add_polynomial(const RVec<double>& coeffs, double sign) {
+  T* phi = phases_.data();
+  parallel_for(phases_.size(), [phi, &coeffs, sign](uint64_t begin,
+                                                    uint64_t end) {
+    for (uint64_t i = begin; i < end; ++i) {
+      double tau = 0.0;
+      for (auto k = coeffs.size(); k-- > 0;)
+        tau = tau * i + coeffs[k];
+      phi[i] = static_cast<T>(std::remainder(phi[i] + sign * tau, 2 * M_PI));
+    }
+  });
+}
+
+template <typename T>
+QReg<T>& PhaseOnlyReg<T>::expand() {
+  if (!expanded_) {
+    qreg_ = to_qreg();
+    phases_ = RVec<T>();
+    expanded_ = true;
+  }
+  return qreg_;
+}
+
+template <typename T>
+void PhaseOnlyReg<T>::applyX(uint64_t i, T x, T y) {
+  expand().applyX(i, x, y);
+}
+
+template <typename T>
+void PhaseOnlyReg<T>::applyX(uint64_t i, Cmplx<T> x, Cmplx<T> y) {
+  expand().applyX(i, x, y);
+}
+
+template <typename T>
+void PhaseOnlyReg<T>::applyXconjugate(uint64_t i, T x, T y) {
+  expand().applyXconjugate(i, x, y);
+}
+
+template <typename T>
+void PhaseOnlyReg<T>::applyXconjugate(uint64_t i, Cmplx<T> x, Cmplx<T> y) {
+  expand().applyXconjugate(i, x, y);
+}
+
+template <typename T>
+void PhaseOnlyReg<T>::apply_givens_ladder(
+    const RVec<T>& x, const RVec<T>& y) {
+  expand().apply_givens_ladder(x, y);
+}
+
+template <typename T>
+void PhaseOnlyReg<T>::apply_givens_ladder_conjugate(
+    const RVec<T>& x, const RVec<T>& y) {
+  expand().apply_givens_ladder_conjugate(x, y);
+}
+
+template <typename T>
+Cmplx<T> PhaseOnlyReg<T>::amplitude(uint64_t i) const {
+  Expects(i < sdim());
+  if (expanded_)
+    return qreg_.data()[i];
+  return std::polar((*magnitudes_)[i], phases_[i]);
+}
+
+template <typename T>
+RVec<T> PhaseOnlyReg<T>::probabilities() const {
+  if (expanded_)
+    return qreg_.probabilities();
+  RVec<T> res(sdim());
+  for (uint64_t i = 0; i < res.size(); ++i)
+    res[i] = (*magnitudes_)[i] * (*magnitudes_)[i];
+  return res;
+}
+
+// sum_i r_i r'_i e^{i (phi'_i - phi_i)} without forming either state.
+template <typename T>
+Cmplx<T> PhaseOnlyReg<T>::braket_product(const PhaseOnlyReg<T>& ket) const {
+  Expects(ket.sdim() == sdim());
+  if (expanded_ || ket.expanded_)
+    return to_qreg().braket_product(ket.to_qreg());
+
+  const T* r = magnitudes_->data();
+  const T* s = ket.magnitudes_->data();
+  const T* phi = phases_.data();
+  const T* psi = ket.phases_.data();
+  return parallel_sum<Cmplx<T>>(sdim(),
+                                [r, s, phi, psi](uint64_t begin,
+                                                 uint64_t end) {
+    Cmplx<T> sum = 0.0;
+    for (uint64_t i = begin; i < end; ++i)
+      sum += std::polar(r[i] * s[i], psi[i] - phi[i]);
+    return sum;
+  });
+}
+
+template <typename T>
+QReg<T> PhaseOnlyReg<T>::to_qreg() const {
+  if (expanded_)
+    return qreg_;
+  CVec<T> amplitudes(sdim());
+  for (uint64_t i = 0; i < amplitudes.size(); ++i)
+    amplitudes[i] = std::polar((*magnitudes_)[i], phases_[i]);
+  QReg<T> res(sdim());
+  res.assign(amplitudes);
+  return res;
+}
+
+} // namespace qstate
+} // namespace qengine
+
+#endif // QENGINE_INCLUDE_PHASE_REG_H_
@@ -27,10 +27,17 @@
 #define M_PI 3.14159265358979323846
 #endif
 
+#include <algorithm>
 #include <cmath>
+#include <istream>
+#include <ostream>
+#include <random>
+#include <vector>
 
+#include "fenwick_tree.h"
 #include "ireg.h"
 #include "math_operations.h"
+#include "parallel.h"
 #include "types.h"
 
 #include <gsl/gsl_assert>
@@ -38,6 +45,10 @@
 namespace qengine {
 inline namespace qstate {
 
+// Levels between exact cos/sin evaluations in the phase recurrence; the
+// rounding error of the running products grows linearly with it.
+constexpr uint64_t kPhaseResync = 64;
+
 template <typename T>
 class QReg : public IReg<T> {
 public:
@@ -49,6 +60,7 @@ public:
   QReg<T>& operator=(QReg<T>&&);
 
   QReg<T>(uint64_t sdim, uint64_t size = 1);
+  QReg<T>(uint64_t sdim, uint64_t size, const Cmplx<T>* amplitudes);
 
   virtual uint64_t size() const override;
 
@@ -62,19 +74,77 @@ public:
   void applyXconjugate(uint64_t i, Cmplx<T> x, Cmplx<T> y);
   void applyZconjugate(uint64_t i, double tau);
 
+  // applyZ(i, tau[i]) for every i < tau.size() in one pass.
+  void applyDiagonal(const RVec<double>& tau);
+  // a_i *= d[i] for i < d.size().
+  void applyDiagonal(const CVec<T>& d);
+  // a'_{perm[j]} = d[j] a_j on the first sdim levels.
+  void applyPermutation(const std::vector<uint64_t>& perm, const CVec<T>& d);
+  // Matrix with kl sub- and ku superdiagonals in LAPACK band storage:
+  // element (i, j) at band[ku + i - j + j * (kl + ku + 1)].
+  void applyBanded(uint64_t kl, uint64_t ku, const CVec<T>& band);
+
+  // applyX(i, x[i - 1], y[i - 1]) for i = 1 .. sdim - 1 in one streaming
+  // pass; the _conjugate variant undoes it (applyXconjugate from the top).
+  void apply_givens_ladder(const RVec<T>& x, const RVec<T>& y);
+  void apply_givens_ladder(const CVec<T>& x, const CVec<T>& y);
+  void apply_givens_ladder_conjugate(const RVec<T>& x, const RVec<T>& y);
+  void apply_givens_ladder_conjugate(const CVec<T>& x, const CVec<T>& y);
+  void prepare_state(const CVec<T>& amplitudes);
+  // Overwrites the leading amplitudes as given, without normalizing.
+  void assign(const CVec<T>& amplitudes);
+
+  // applyZ(i, tau_i) on every level with tau_i = offset + c * i, or
+  // tau_i = sum_k coeffs[k] * i^k; the phases come from a rotation
+  // recurrence over forward differences, resynced every kPhaseResync levels.
+  // The fused form applies forward and then the conjugate of inverse.
+  void applyPhaseLinear(double c, double offset = 0.0);
+  void applyPhaseLinearConjugate(double c, double offset = 0.0);
+  void applyPhasePolynomial(const RVec<double>& coeffs);
+  void applyPhasePolynomialConjugate(const RVec<double>& coeffs);
+  void applyPhasePolynomial(
+      const RVec<double>& forward, const RVec<double>& inverse);
+
+  void reset(uint64_t i = 0);
+  void scale(uint64_t i, T factor);
+  void normalize();
+
   uint64_t dim() const;
   uint64_t sdim() const;
+  const Cmplx<T>* data() const;
 
   RVec<T> probabilities() const;
 
+  // Keeps |a_i|^2 in a Fenwick tree updated by every gate, so sample() runs
+  // in O(log D) instead of scanning the register.
+  void track_probabilities(bool enable = true);
+  bool tracks_probabilities() const;
+  CReg sample(std::mt19937& mte) const;
+
   QReg<T> conjugate() const;
   Cmplx<T> braket_product(const QReg<T>& ket) const;
   CMat<T> ketbra_product(const QReg<T>& ket) const;
 
+  void write_amplitudes(std::ostream& out) const;
+  void read_amplitudes(std::istream& in);
+
 private:
-  uint64_t sdim_;
-  uint64_t size_;
-  CVec<T> amplitudes_;
+  template <typename C>
+  void givens_ladder(const std::vector<C>& x, const std::vector<C>& y);
+  template <typename C>
+  void givens_ladder_conjugate(
+      const std::vector<C>& x, const std::vector<C>& y);
+
+  RVec<T> compute_probabilities() const;
+  void update_probability(uint64_t i);
+  void rebuild_probabilities();
+
+  uint64_t sdim_ = 0;
+  uint64_t size_ = 0;
+  NumaVec<Cmplx<T>> amplitudes_;
+  bool track_ = false;
+  uint64_t updates_ = 0;
+  FenwickTree<T> probs_;
 };
 
 template <typename T>
@@ -84,13 +154,22 @@ template <typename T>
 QReg<T>::~QReg() = default;
 
 template <typename T>
-QReg<T>::QReg(const QReg<T>&) = default;
+QReg<T>::QReg(const QReg<T>& other)
+  : QReg<T>(other.sdim_, other.size_, other.amplitudes_.data()) {
+  track_ = other.track_;
+  updates_ = other.updates_;
+  probs_ = other.probs_;
+}
 
 template <typename T>
 QReg<T>::QReg(QReg<T>&&) = default;
 
 template <typename T>
-QReg<T>& QReg<T>::operator=(const QReg<T>&) = default;
+QReg<T>& QReg<T>::operator=(const QReg<T>& other) {
+  if (this != &other)
+    *this = QReg<T>(other);
+  return *this;
+}
 
 template <typename T>
 QReg<T>& QReg<T>::operator=(QReg<T>&&) = default;
@@ -98,126 +177,417 @@ QReg<T>& QReg<T>::operator=(QReg<T>&&) = default;
 template <typename T>
 QReg<T>::QReg(uint64_t sdim, uint64_t size)
   : sdim_{sdim}, size_{size}, amplitudes_(sdim * size) {
+  Cmplx<T>* a = amplitudes_.data();
+  parallel_for(amplitudes_.size(), [a](uint64_t begin, uint64_t end) {
+    std::fill(a + begin, a + end, Cmplx<T>(0.0));
+  });
   amplitudes_[0] = 1.0;
 }
 
+template <typename T>
+QReg<T>::QReg(uint64_t sdim, uint64_t size, const Cmplx<T>* amplitudes)
+  : sdim_{sdim}, size_{size}, amplitudes_(sdim * size) {
+  Cmplx<T>* a = amplitudes_.data();
+  const Cmplx<T>* src = amplitudes;
+  parallel_for(amplitudes_.size(), [a, src](uint64_t begin, uint64_t end) {
+    std::copy(src + begin, src + end, a + begin);
+  });
+}
+
 template <typename T>
 uint64_t QReg<T>::size() const { return size_; }
 
 template <typename T>
 RVec<T> QReg<T>::probabilities() const {
-  RVec<T> res;
-  res.reserve(amplitudes_.size());
-  for(auto const & a : amplitudes_)
-    res.push_back(probability(a));
+  return track_ ? probs_.values() : compute_probabilities();
+}
+
+template <typename T>
+RVec<T> QReg<T>::compute_probabilities() const {
+  RVec<T> res(amplitudes_.size());
+  const Cmplx<T>* a = amplitudes_.data();
+  T* p = res.data();
+  parallel_for(res.size(), [a, p](uint64_t begin, uint64_t end) {
+    for (uint64_t i = begin; i < end; ++i)
+      p[i] = probability(a[i]);
+  });
   return res;
 }
 
+template <typename T>
+void QReg<T>::track_probabilities(bool enable) {
+  track_ = enable;
+  if (track_)
+    rebuild_probabilities();
+  else
+    probs_ = FenwickTree<T>();
+}
+
+template <typename T>
+bool QReg<T>::tracks_probabilities() const { return track_; }
+
+template <typename T>
+CReg QReg<T>::sample(std::mt19937& mte) const {
+  if (!track_) {
+    const RVec<T> probs(probabilities());
+    std::discrete_distribution<CReg> distrib(probs.begin(), probs.end());
+    return distrib(mte);
+  }
+  const T total = probs_.total();
+  Expects(total > 0.0);
+  std::uniform_real_distribution<T> uniform(0.0, total);
+  return static_cast<CReg>(probs_.find(uniform(mte)));
+}
+
+// Incremental updates accumulate rounding in the partial sums; a rebuild
+// every D updates keeps the amortized cost O(1) per gate.
+template <typename T>
+void QReg<T>::update_probability(uint64_t i) {
+  if (!track_)
+    return;
+  if (++updates_ >= amplitudes_.size())
+    rebuild_probabilities();
+  else
+    probs_.set(i, probability(amplitudes_[i]));
+}
+
+template <typename T>
+void QReg<T>::rebuild_probabilities() {
+  if (!track_)
+    return;
+  probs_.assign(compute_probabilities());
+  updates_ = 0;
+}
+
 template <typename T>
 uint64_t QReg<T>::dim() const { return amplitudes_.size(); }
 
 template <typename T>
 uint64_t QReg<T>::sdim() const { return sdim_; }
 
+template <typename T>
+const Cmplx<T>* QReg<T>::data() const { return amplitudes_.data(); }
+
+template <typename T>
+void axpy_column(Cmplx<T> alpha, const Cmplx<T>* column, Cmplx<T>* y,
+                 uint64_t n) {
+  kernels<T>().axpy(alpha, column, y, n);
+}
+
+template <typename T>
+void axpy_column(Cmplx<T> alpha, const T* column, Cmplx<T>* y, uint64_t n) {
+  kernels<T>().axpy_real(alpha, column, y, n);
+}
+
+// Rows are split across the pool so each worker writes (and first-touches)
+// the same slice of the result that it owns in the register.
+template <typename T, typename M>
+NumaVec<Cmplx<T>> gemv(const M& mat, const NumaVec<Cmplx<T>>& x) {
+  Expects(mat.ncols() == x.size());
+
+  NumaVec<Cmplx<T>> res(mat.nrows());
+  Cmplx<T>* y = res.data();
+  const Cmplx<T>* v = x.data();
+  const auto* a = mat.data();
+  const uint64_t nrows = mat.nrows();
+  const uint64_t ncols = mat.ncols();
+  parallel_for(nrows, [y, v, a, nrows, ncols](uint64_t begin, uint64_t end) {
+    std::fill(y + begin, y + end, Cmplx<T>(0.0));
+    for (uint64_t j = 0; j < ncols; ++j)
+      axpy_column<T>(v[j], a + begin + j * nrows, y + begin, end - begin);
+  }, kParallelThreshold / std::max<uint64_t>(ncols, 1));
+  return res;
+}
+
 template <typename T>
 void QReg<T>::apply(const RMat<T> mat, uint64_t idx_qudit) {
-  amplitudes_ = mat * amplitudes_;
+  amplitudes_ = gemv<T>(mat, amplitudes_);
+  rebuild_probabilities();
 }
 
 template <typename T>
 void QReg<T>::apply(const CMat<T> mat, uint64_t idx_qudit) {
-  amplitudes_ = mat * amplitudes_;
+  amplitudes_ = gemv<T>(mat, amplitudes_);
+  rebuild_probabilities();
 }
 
 template <typename T>
 void QReg<T>::applyX(uint64_t i, T x, T y) {
   Expects(0 < i && i < sdim_);
+  apply_givens(givens_X(x, y), amplitudes_[i - 1], amplitudes_[i]);
+  update_probability(i - 1);
+  update_probability(i);
+}
 
-  T x_11 = x;
-  T x_12 = -y;
-  T x_21 = y;
-  T x_22 = x;
-
-  T devisor = std::sqrt(x * x + y * y);
+template <typename T>
+void QReg<T>::applyX(uint64_t i, Cmplx<T> x, Cmplx<T> y) {
+  Expects(0 < i && i < sdim_);
+  apply_givens(givens_X(x, y), amplitudes_[i - 1], amplitudes_[i]);
+  update_probability(i - 1);
+  update_probability(i);
+}
 
-  Cmplx<T> amplitudes_i_1 = amplitudes_[i - 1];
-  Cmplx<T> amplitudes_i = amplitudes_[i];
+template <typename T>
+void QReg<T>::applyZ(uint64_t i, double tau) {
+  Expects(0 <= i && i < sdim_);
+  amplitudes_[i] *= Cmplx<T>(std::cos(tau), std::sin(tau));
+}
 
-  amplitudes_[i - 1] = (x_11 * amplitudes_i_1 + x_12 * amplitudes_i) / devisor;
-  amplitudes_[i] = (x_21 * amplitudes_i_1 + x_22 * amplitudes_i) / devisor;
+template <typename T>
+void QReg<T>::applyXconjugate(uint64_t i, T x, T y) {
+  Expects(0 < i && i < sdim_);
+  apply_givens(givens_Xconjugate(x, y), amplitudes_[i - 1], amplitudes_[i]);
+  update_probability(i - 1);
+  update_probability(i);
 }
 
 template <typename T>
-void QReg<T>::applyX(uint64_t i, Cmplx<T> x, Cmplx<T> y) {
+void QReg<T>::applyXconjugate(uint64_t i, Cmplx<T> x, Cmplx<T> y) {
   Expects(0 < i && i < sdim_);
+  apply_givens(givens_Xconjugate(x, y), amplitudes_[i - 1], amplitudes_[i]);
+  update_probability(i - 1);
+  update_probability(i);
+}
+
+template <typename T>
+void QReg<T>::applyZconjugate(uint64_t i, double tau) {
+  Expects(0 <= i && i < sdim_);
+  amplitudes_[i] *= Cmplx<T>(std::cos(tau), -std::sin(tau));
+}
 
-  Cmplx<T> x_11 = x;
-  Cmplx<T> x_12 = -y;
-  Cmplx<T> x_21 = std::conj(y);
-  Cmplx<T> x_22 = std::conj(x);
+template <typename T>
+void QReg<T>::applyDiagonal(const RVec<double>& tau) {
+  Expects(tau.size() <= sdim_);
+  for (uint64_t i = 0; i < tau.size(); ++i)
+    amplitudes_[i] *= Cmplx<T>(std::cos(tau[i]), std::sin(tau[i]));
+}
 
-  T devisor = std::sqrt(std::abs(x) * std::abs(x) + std::abs(y) * std::abs(y));
+template <typename T>
+void QReg<T>::applyDiagonal(const CVec<T>& d) {
+  Expects(d.size() <= sdim_);
+  for (uint64_t i = 0; i < d.size(); ++i)
+    amplitudes_[i] *= d[i];
+  rebuild_probabilities();
+}
 
-  Cmplx<T> amplitudes_i_1 = amplitudes_[i - 1];
-  Cmplx<T> amplitudes_i = amplitudes_[i];
+template <typename T>
+void QReg<T>::applyPermutation(
+    const std::vector<uint64_t>& perm, const CVec<T>& d) {
+  Expects(perm.size() == sdim_ && d.size() == sdim_);
+
+  CVec<T> res(sdim_);
+  for (uint64_t j = 0; j < sdim_; ++j)
+    res[perm[j]] = d[j] * amplitudes_[j];
+  std::copy(res.begin(), res.end(), amplitudes_.begin());
+  rebuild_probabilities();
+}
 
-  amplitudes_[i - 1] = (x_11 * amplitudes_i_1 + x_12 * amplitudes_i) / devisor;
-  amplitudes_[i] = (x_21 * amplitudes_i_1 + x_22 * amplitudes_i) / devisor;
+template <typename T>
+void QReg<T>::applyBanded(uint64_t kl, uint64_t ku, const CVec<T>& band) {
+  const uint64_t ldb = kl + ku + 1;
+  Expects(band.size() == ldb * sdim_);
+
+  CVec<T> res(sdim_);
+  for (uint64_t j = 0; j < sdim_; ++j) {
+    const Cmplx<T> a_j = amplitudes_[j];
+    const uint64_t first = j > ku ? j - ku : 0;
+    const uint64_t last = std::min(j + kl + 1, sdim_);
+    const Cmplx<T>* col = band.data() + ku + j * ldb - j;
+    for (uint64_t i = first; i < last; ++i)
+      res[i] += col[i] * a_j;
+  }
+  std::copy(res.begin(), res.end(), amplitudes_.begin());
+  rebuild_probabilities();
 }
 
 template <typename T>
-void QReg<T>::applyZ(uint64_t i, double tau) {
-  Expects(0 <= i && i < sdim_);
-  amplitudes_[i] *= Cmplx<T>(std::cos(tau), std::sin(tau));
+template <typename C>
+void QReg<T>::givens_ladder(const std::vector<C>& x, const std::vector<C>& y) {
+  Expects(x.size() + 1 == sdim_ && y.size() + 1 == sdim_);
+
+  // level i - 1 is final once rotation i is applied, so only the running
+  // lower amplitude is carried between neighbours
+  Cmplx<T>* a = amplitudes_.data();
+  Cmplx<T> carry = a[0];
+  for (uint64_t i = 1; i < sdim_; ++i) {
+    const auto g = givens_X(x[i - 1], y[i - 1]);
+    const Cmplx<T> next = a[i];
+    a[i - 1] = g.x_11 * carry + g.x_12 * next;
+    carry = g.x_21 * carry + g.x_22 * next;
+  }
+  a[sdim_ - 1] = carry;
+  rebuild_probabilities();
 }
 
 template <typename T>
-void QReg<T>::applyXconjugate(uint64_t i, T x, T y) {
-  Expects(0 < i && i < sdim_);
+template <typename C>
+void QReg<T>::givens_ladder_conjugate(
+    const std::vector<C>& x, const std::vector<C>& y) {
+  Expects(x.size() + 1 == sdim_ && y.size() + 1 == sdim_);
+
+  Cmplx<T>* a = amplitudes_.data();
+  Cmplx<T> carry = a[sdim_ - 1];
+  for (uint64_t i = sdim_ - 1; i > 0; --i) {
+    const auto g = givens_Xconjugate(x[i - 1], y[i - 1]);
+    const Cmplx<T> prev = a[i - 1];
+    a[i] = g.x_21 * prev + g.x_22 * carry;
+    carry = g.x_11 * prev + g.x_12 * carry;
+  }
+  a[0] = carry;
+  rebuild_probabilities();
+}
 
-  Cmplx<T> x_11 = x;
-  Cmplx<T> x_12 = y;
-  Cmplx<T> x_21 = -y;
-  Cmplx<T> x_22 = x;
+template <typename T>
+void QReg<T>::apply_givens_ladder(const RVec<T>& x, const RVec<T>& y) {
+  givens_ladder(x, y);
+}
 
-  T devisor = std::sqrt(x * x + y * y);
+template <typename T>
+void QReg<T>::apply_givens_ladder(const CVec<T>& x, const CVec<T>& y) {
+  givens_ladder(x, y);
+}
+
+template <typename T>
+void QReg<T>::apply_givens_ladder_conjugate(
+    const RVec<T>& x, const RVec<T>& y) {
+  givens_ladder_conjugate(x, y);
+}
 
-  Cmplx<T> amplitudes_i_1 = amplitudes_[i - 1];
-  Cmplx<T> amplitudes_i = amplitudes_[i];
+template <typename T>
+void QReg<T>::apply_givens_ladder_conjugate(
+    const CVec<T>& x, const CVec<T>& y) {
+  givens_ladder_conjugate(x, y);
+}
 
-  amplitudes_[i - 1] = (x_11 * amplitudes_i_1 + x_12 * amplitudes_i) / devisor;
-  amplitudes_[i] = (x_21 * amplitudes_i_1 + x_22 * amplitudes_i) / devisor;
+template <typename T>
+void QReg<T>::applyPhaseLinear(double c, double offset) {
+  applyPhasePolynomial({offset, c});
 }
 
 template <typename T>
-void QReg<T>::applyXconjugate(uint64_t i, Cmplx<T> x, Cmplx<T> y) {
-  Expects(0 < i && i < sdim_);
+void QReg<T>::applyPhaseLinearConjugate(double c, double offset) {
+  applyPhasePolynomial({-offset, -c});
+}
 
-  Cmplx<T> x_11 = std::conj(x);
-  Cmplx<T> x_12 = y;
-  Cmplx<T> x_21 = -std::conj(y);
-  Cmplx<T> x_22 = x;
+template <typename T>
+void QReg<T>::applyPhasePolynomialConjugate(const RVec<double>& coeffs) {
+  applyPhasePolynomial({}, coeffs);
+}
+
+template <typename T>
+void QReg<T>::applyPhasePolynomial(
+    const RVec<double>& forward, const RVec<double>& inverse) {
+  RVec<double> coeffs(std::max(forward.size(), inverse.size()));
+  for (uint64_t k = 0; k < forward.size(); ++k)
+    coeffs[k] += forward[k];
+  for (uint64_t k = 0; k < inverse.size(); ++k)
+    coeffs[k] -= inverse[k];
+  applyPhasePolynomial(coeffs);
+}
 
-  T devisor = std::sqrt(std::abs(x) * std::abs(x) + std::abs(y) * std::abs(y));
+template <typename T>
+void QReg<T>::applyPhasePolynomial(const RVec<double>& coeffs) {
+  Expects(!coeffs.empty());
+
+  const uint64_t order = coeffs.size();
+  RVec<double> shifted(order);
+  RVec<double> tau(order);
+  CVec<double> step(order);
+  Cmplx<T>* a = amplitudes_.data();
+  for (uint64_t start = 0; start < sdim_; start += kPhaseResync) {
+    // Taylor shift to the block start, so the differences below are taken
+    // between small values instead of cancelling the large tau_start
+    const double x0 = static_cast<double>(start);
+    shifted = coeffs;
+    for (uint64_t s = 0; s + 1 < order; ++s)
+      for (uint64_t k = order - 1; k-- > s;)
+        shifted[k] += x0 * shifted[k + 1];
+
+    // tau_{start + k} - tau_start for k = 0 .. degree, turned in place into
+    // the forward differences tau[d] = delta^d tau_start
+    for (uint64_t k = 0; k < order; ++k) {
+      const double x = static_cast<double>(k);
+      tau[k] = 0.0;
+      for (uint64_t p = order - 1; p > 0; --p)
+        tau[k] = (tau[k] + shifted[p]) * x;
+    }
+    for (uint64_t d = 1; d < order; ++d)
+      for (uint64_t k = order - 1; k >= d; --k)
+        tau[k] -= tau[k - 1];
+    tau[0] = shifted[0];
+    for (uint64_t d = 0; d < order; ++d)
+      step[d] = std::polar(1.0, tau[d]);
+
+    const uint64_t end = std::min(start + kPhaseResync, sdim_);
+    for (uint64_t i = start; i < end; ++i) {
+      a[i] *= Cmplx<T>(step[0]);
+      for (uint64_t d = 0; d + 1 < order; ++d)
+        step[d] *= step[d + 1];
+    }
+  }
+}
 
-  Cmplx<T> amplitudes_i_1 = amplitudes_[i - 1];
-  Cmplx<T> amplitudes_i = amplitudes_[i];
+// Closed form of a ladder applied to |0>: the register is set to the
+// normalized profile directly instead of rotating level by level.
+template <typename T>
+void QReg<T>::prepare_state(const CVec<T>& amplitudes) {
+  Expects(0 < amplitudes.size() && amplitudes.size() <= amplitudes_.size());
 
-  amplitudes_[i - 1] = (x_11 * amplitudes_i_1 + x_12 * amplitudes_i) / devisor;
-  amplitudes_[i] = (x_21 * amplitudes_i_1 + x_22 * amplitudes_i) / devisor;
+  Cmplx<T>* a = amplitudes_.data();
+  std::copy(amplitudes.begin(), amplitudes.end(), a);
+  std::fill(a + amplitudes.size(), a + amplitudes_.size(), Cmplx<T>(0.0));
+  normalize();
 }
 
 template <typename T>
-void QReg<T>::applyZconjugate(uint64_t i, double tau) {
-  Expects(0 <= i && i < sdim_);
-  amplitudes_[i] *= Cmplx<T>(std::cos(tau), -std::sin(tau));
+void QReg<T>::assign(const CVec<T>& amplitudes) {
+  Expects(amplitudes.size() <= amplitudes_.size());
+  std::copy(amplitudes.begin(), amplitudes.end(), amplitudes_.begin());
+  rebuild_probabilities();
+}
+
+template <typename T>
+void QReg<T>::reset(uint64_t i) {
+  Expects(i < amplitudes_.size());
+  Cmplx<T>* a = amplitudes_.data();
+  parallel_for(amplitudes_.size(), [a](uint64_t begin, uint64_t end) {
+    std::fill(a + begin, a + end, Cmplx<T>(0.0));
+  });
+  amplitudes_[i] = 1.0;
+  rebuild_probabilities();
+}
+
+template <typename T>
+void QReg<T>::scale(uint64_t i, T factor) {
+  Expects(i < amplitudes_.size());
+  amplitudes_[i] *= factor;
+  update_probability(i);
+}
+
+template <typename T>
+void QReg<T>::normalize() {
+  Cmplx<T>* a = amplitudes_.data();
+  const T norm = parallel_sum<T>(amplitudes_.size(),
+                                 [a](uint64_t begin, uint64_t end) {
+    return kernels<T>().norm2(a + begin, end - begin);
+  });
+  Expects(norm > 0.0);
+
+  const T factor = 1 / std::sqrt(norm);
+  parallel_for(amplitudes_.size(), [a, factor](uint64_t begin, uint64_t end) {
+    kernels<T>().scale(factor, a + begin, end - begin);
+  });
+  rebuild_probabilities();
 }
 
 template <typename T>
 QReg<T> QReg<T>::conjugate() const {
   QReg<T> res(*this);
-  for (auto & res_a : res.amplitudes_)
-    res_a = std::conj(res_a);
+  Cmplx<T>* a = res.amplitudes_.data();
+  parallel_for(res.amplitudes_.size(), [a](uint64_t begin, uint64_t end) {
+    for (uint64_t i = begin; i < end; ++i)
+      a[i] = std::conj(a[i]);
+  });
   return res;
 }
 
@@ -225,17 +595,39 @@ template <typename T>
 Cmplx<T> QReg<T>::braket_product(const QReg<T>& ket) const {
   Expects(ket.amplitudes_.size() == amplitudes_.size());
 
-  Cmplx<T> res(0.0);
-  for(uint64_t i = 0; i < amplitudes_.size(); ++i)
-    res += amplitudes_[i] * ket.amplitudes_[i];
-  return res;
+  const Cmplx<T>* a = amplitudes_.data();
+  const Cmplx<T>* b = ket.amplitudes_.data();
+  return parallel_sum<Cmplx<T>>(amplitudes_.size(),
+                                [a, b](uint64_t begin, uint64_t end) {
+    return dot_conj(a, b, begin, end);
+  });
 }
 
 template <typename T>
 CMat<T> QReg<T>::ketbra_product(const QReg<T>& bra) const {
-  return ketbra_tensor_product(amplitudes_, bra.amplitudes_);
+  return ketbra_tensor_product(
+      CVec<T>(amplitudes_.begin(), amplitudes_.end()),
+      CVec<T>(bra.amplitudes_.begin(), bra.amplitudes_.end()));
+}
+
+template <typename T>
+void QReg<T>::write_amplitudes(std::ostream& out) const {
+  out.write(reinterpret_cast<const char*>(amplitudes_.data()),
+            amplitudes_.size() * sizeof(Cmplx<T>));
 }
 
+template <typename T>
+void QReg<T>::read_amplitudes(std::istream& in) {
+  in.read(reinterpret_cast<char*>(amplitudes_.data()),
+          amplitudes_.size() * sizeof(Cmplx<T>));
+  rebuild_probabilities();
+}
+
+#ifdef QENGINE_EXTERN_TEMPLATES
+extern template class QReg<float>;
+extern template class QReg<double>;
+#endif
+
 } // namespace qstate
 } // namespace qengine
 
@@ -0,0 +1,379 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_INCLUDE_SWEEP_H_
+#define QENGINE_INCLUDE_SWEEP_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <istream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "circuit.h"
+#include "instruction.h"
+#include "types.h"
+#include "work_stealing_pool.h"
+
+#include <gsl/gsl_assert>
+
+namespace qengine {
+inline namespace qsystem {
+
+// One configuration of a sweep: a value for every axis of the grid.
+class ParamPoint {
+public:
+  ParamPoint(uint64_t index,
+             std::shared_ptr<const std::vector<std::string>> names,
+             std::vector<double> values)
+    : index_{index}, names_{std::move(names)}, values_{std::move(values)} {}
+
+  uint64_t index() const { return index_; }
+  const std::vector<std::string>& names() const { return *names_; }
+  const std::vector<double>& values() const { return values_; }
+
+  double operator[](const std::string& name) const {
+    const auto it = std::find(names_->begin(), names_->end(), name);
+    Expects(it != names_->end());
+    return values_[it - names_->begin()];
+  }
+
+private:
+  uint64_t index_;
+  std::shared_ptr<const std::vector<std::string>> names_;
+  std::vector<double> values_;
+};
+
+// Cartesian product of named axes; the last axis varies fastest. Points are
+// generated on demand, so a grid never holds more than its axes.
+class ParamGrid {
+public:
+  ParamGrid() : names_(std::make_shared<std::vector<std::string>>()) {}
+
+  ParamGrid& add_axis(const std::string& name, std::vector<double> values) {
+    Expects(!values.empty());
+    names_->push_back(name);
+    axes_.push_back(std::move(values));
+    return *this;
+  }
+
+  const std::vector<std::string>& names() const { return *names_; }
+
+  uint64_t size() const {
+    uint64_t res = 1;
+    for (const auto & axis : axes_)
+      res *= axis.size();
+    return res;
+  }
+
+  ParamPoint point(uint64_t index) const {
+    Expects(index < size());
+    std::vector<double> values(axes_.size());
+    uint64_t rest = index;
+    for (uint64_t k = axes_.size(); k-- > 0;) {
+      values[k] = axes_[k][rest % axes_[k].size()];
+      rest /= axes_[k].size();
+    }
+    return ParamPoint(index, names_, std::move(values));
+  }
+
+private:
+  std::shared_ptr<std::vector<std::string>> names_;
+  std::vector<std::vector<double>> axes_;
+};
+
+// How to turn a point into a run. Points with equal `structure` keys share
+// the program built once by `compile`; `bind` then only rewrites the
+// parameter-dependent operands of a copy (leave it empty when the program
+// depends on the key alone). `observe` maps the finished circuit to the
+// values recorded for the point; by default the classical registers.
+template <typename T>
+struct SweepTemplate {
+  std::function<uint64_t(const ParamPoint&)> structure;
+  std::function<CompiledCircuit<T>(const ParamPoint&)> compile;
+  std::function<void(const ParamPoint&, Program<T>&)> bind;
+  std::function<std::vector<double>(const ParamPoint&, const Circuit<T>&)>
+      observe;
+};
+
+struct SweepRecord {
+  uint64_t index;
+  std::vector<double> params;
+  std::vector<double> values;
+};
+
+// Receives records as they complete, in no particular order; the executor
+// serializes the calls.
+class SweepSink {
+public:
+  virtual ~SweepSink() = default;
+  virtual void write(const SweepRecord& record) = 0;
+};
+
+class CsvSink : public SweepSink {
+public:
+  CsvSink(std::ostream& out, std::vector<std::string> param_names,
+          std::vector<std::string> value_names = {})
+    : out_(out), param_names_{std::move(param_names)},
+      value_names_{std::move(value_names)} {}
+
+  void write(const SweepRecord& record) override {
+    if (!header_) {
+      out_ << "index";
+      for (const auto & name : param_names_)
+        out_ << ',' << name;
+      for (uint64_t k = 0; k < record.values.size(); ++k)
+        out_ << ','
+             << (k < value_names_.size() ? value_names_[k]
+                                         : "v" + std::to_string(k));
+      out_ << '\n';
+      header_ = true;
+    }
+
+    const auto precision = out_.precision(
+        std::numeric_limits<double>::max_digits10);
+    out_ << record.index;
+    for (const auto & p : record.params)
+      out_ << ',' << p;
+    for (const auto & v : record.values)
+      out_ << ',' << v;
+    out_ << '\n';
+    out_.precision(precision);
+  }
+
+private:
+  std::ostream& out_;
+  std::vector<std::string> param_names_;
+  std::vector<std::string> value_names_;
+  bool header_ = false;
+};
+
+// "QENGSWEP", uint32 version, uint32 nparams, then per record uint64 index,
+// uint32 nvalues, nparams + nvalues doubles.
+constexpr char kSweepMagic[8] = {'Q', 'E', 'N', 'G', 'S', 'W', 'E', 'P'};
+constexpr uint32_t kSweepVersion = 1;
+
+class BinarySink : public SweepSink {
+public:
+  BinarySink(std::ostream& out, uint32_t nparams)
+    : out_(out), nparams_{nparams} {
+    out_.write(kSweepMagic, sizeof(kSweepMagic));
+    out_.write(reinterpret_cast<const char*>(&kSweepVersion),
+               sizeof(kSweepVersion));
+    out_.write(reinterpret_cast<const char*>(&nparams_), sizeof(nparams_));
+  }
+
+  void write(const SweepRecord& record) override {
+    Expects(record.params.size() == nparams_);
+    const uint32_t nvalues = static_cast<uint32_t>(record.values.size());
+    out_.write(reinterpret_cast<const char*>(&record.index),
+               sizeof(record.index));
+    out_.write(reinterpret_cast<const char*>(&nvalues), sizeof(nvalues));
+    out_.write(reinterpret_cast<const char*>(record.params.data()),
+               nparams_ * sizeof(double));
+    out_.write(reinterpret_cast<const char*>(record.values.data()),
+               nvalues * sizeof(double));
+  }
+
+private:
+  std::ostream& out_;
+  uint32_t nparams_;
+};
+
+inline std::vector<SweepRecord> read_sweep_records(std::istream& in) {
+  char magic[sizeof(kSweepMagic)];
+  uint32_t version = 0;
+  uint32_t nparams = 0;
+  in.read(magic, sizeof(magic));
+  in.read(reinterpret_cast<char*>(&version), sizeof(version));
+  in.read(reinterpret_cast<char*>(&nparams), sizeof(nparams));
+  if (!in || !std::equal(magic, magic + sizeof(magic), kSweepMagic)
+      || version != kSweepVersion)
+    throw std::runtime_error("qengine: not a sweep result stream");
+
+  std::vector<SweepRecord> res;
+  SweepRecord record;
+  uint32_t nvalues = 0;
+  while (in.read(reinterpret_cast<char*>(&record.index),
+                 sizeof(record.index))) {
+    in.read(reinterpret_cast<char*>(&nvalues), sizeof(nvalues));
+    record.params.resize(nparams);
+    record.values.resize(nvalues);
+    in.read(reinterpret_cast<char*>(record.params.data()),
+            nparams * sizeof(double));
+    in.read(reinterpret_cast<char*>(record.values.data()),
+            nvalues * sizeof(double));
+    if (!in)
+      throw std::runtime_error("qengine: truncated sweep result stream");
+    res.push_back(record);
+  }
+  return res;
+}
+
+// Runs every point of a grid on a work-stealing pool. Each task takes a
+// contiguous chunk of points, so consecutive points with the same structure
+// reuse one program buffer; only the compiled programs are cached, and each
+// circuit is dropped as soon as its record is written.
+template <typename T>
+class SweepExecutor {
+public:
+  SweepExecutor<T>() = delete;
+  ~SweepExecutor<T>() = default;
+  SweepExecutor<T>(const SweepExecutor<T>&) = delete;
+  SweepExecutor<T>(SweepExecutor<T>&&) = delete;
+  SweepExecutor<T>& operator=(const SweepExecutor<T>&) = delete;
+  SweepExecutor<T>& operator=(SweepExecutor<T>&&) = delete;
+
+  explicit SweepExecutor<T>(SweepTemplate<T> tmpl, uint64_t nthreads = 0);
+
+  // Point k measures with an engine seeded from (seed, k), so results do
+  // not depend on scheduling.
+  void run(const ParamGrid& grid, SweepSink& sink, uint32_t seed = 1);
+
+  uint64_t ncompiled() const;
+
+private:
+  using Compiled = std::shared_ptr<const CompiledCircuit<T>>;
+
+  Compiled compiled(uint64_t key, const ParamPoint& point);
+  void run_chunk(const ParamGrid& grid, uint64_t begin, uint64_t end,
+                 SweepSink& sink, uint32_t seed);
+
+  SweepTemplate<T> tmpl_;
+  WorkStealingPool pool_;
+  mutable std::mutex cache_mutex_;
+  std::map<uint64_t, std::shared_future<Compiled>> cache_;
+  std::mutex sink_mutex_;
+};
+
+template <typename T>
+SweepExecutor<T>::SweepExecutor(SweepTemplate<T> tmpl, uint64_t nthreads)
+  : tmpl_{std::move(tmpl)}, pool_(nthreads) {
+  Expects(tmpl_.structure && tmpl_.compile);
+}
+
+template <typename T>
+void SweepExecutor<T>::run(
+    const ParamGrid& grid, SweepSink& sink, uint32_t seed) {
+  const uint64_t npoints = grid.size();
+  const uint64_t chunk =
+      std::max<uint64_t>(1, npoints / (8 * pool_.nthreads()));
+  for (uint64_t begin = 0; begin < npoints; begin += chunk) {
+    const uint64_t end = std::min(npoints, begin + chunk);
+    pool_.submit([this, &grid, &sink, begin, end, seed] {
+      run_chunk(grid, begin, end, sink, seed);
+    });
+  }
+  pool_.wait();
+}
+
+template <typename T>
+uint64_t SweepExecutor<T>::ncompiled() const {
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+  return cache_.size();
+}
+
+template <typename T>
+typename SweepExecutor<T>::Compiled SweepExecutor<T>::compiled(
+    uint64_t key, const ParamPoint& point) {
+  std::promise<Compiled> promise;
+  std::shared_future<Compiled> future;
+  bool owner = false;
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    auto it = cache_.find(key);
+    if (it == cache_.end()) {
+      future = promise.get_future().share();
+      cache_.emplace(key, future);
+      owner = true;
+    } else {
+      future = it->second;
+    }
+  }
+
+  if (owner) {
+    try {
+      promise.set_value(
+          std::make_shared<const CompiledCircuit<T>>(tmpl_.compile(point)));
+    } catch (...) {
+      // forget the failure so a later run() compiles this structure again
+      {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        cache_.erase(key);
+      }
+      promise.set_exception(std::current_exception());
+    }
+  }
+  return future.get();
+}
+
+template <typename T>
+void SweepExecutor<T>::run_chunk(const ParamGrid& grid, uint64_t begin,
+                                 uint64_t end, SweepSink& sink, uint32_t seed) {
+  Compiled current;
+  uint64_t current_key = 0;
+  Program<T> program;
+  for (uint64_t k = begin; k < end; ++k) {
+    const ParamPoint point = grid.point(k);
+    const uint64_t key = tmpl_.structure(point);
+    if (!current || key != current_key) {
+      current = compiled(key, point);
+      current_key = key;
+      program = current->program;
+    }
+    if (tmpl_.bind)
+      tmpl_.bind(point, program);
+
+    std::seed_seq seq{seed, static_cast<uint32_t>(k),
+                      static_cast<uint32_t>(k >> 32)};
+    uint32_t point_seed = 0;
+    seq.generate(&point_seed, &point_seed + 1);
+
+    Circuit<T> circuit(current->nreg, current->dim, point_seed);
+    execute(circuit, program);
+
+    SweepRecord record{k, point.values(), {}};
+    if (tmpl_.observe) {
+      record.values = tmpl_.observe(point, circuit);
+    } else {
+      for (const auto & creg : circuit.cregs())
+        record.values.push_back(creg);
+    }
+
+    std::lock_guard<std::mutex> lock(sink_mutex_);
+    sink.write(record);
+  }
+}
+
+} // namespace qsystem
+} // namespace qengine
+
+#endif // QENGINE_INCLUDE_SWEEP_H_
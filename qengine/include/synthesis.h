@@ -0,0 +1,442 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_INCLUDE_SYNTHESIS_H_
+#define QENGINE_INCLUDE_SYNTHESIS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "circuit.h"
+#include "instruction.h"
+#include "qreg.h"
+#include "types.h"
+
+#include <gsl/gsl_assert>
+
+namespace qengine {
+inline namespace qsystem {
+
+// Cheapest representation found for the unitary of a subcircuit; `replay`
+// means running the gates again is cheaper than any of them.
+enum class OperatorKind { replay, diagonal, permutation, banded, dense };
+
+// Cost of a call in amplitude updates on top of its arithmetic: bounds
+// checks, the Givens normalization, dispatch.
+constexpr uint64_t kGateOverhead = 16;
+// Synthesis runs the subcircuit once per column, so larger registers
+// always replay.
+constexpr uint64_t kSynthesisMaxDim = 1 << 12;
+// Largest column capture, in dim x replay cost amplitude updates (a few
+// seconds); a subcircuit this expensive is not synthesized even if it
+// would be reused.
+constexpr uint64_t kSynthesisMaxWork = 1ULL << 32;
+// Largest number of stored matrix entries (4 MB for double): a banded or
+// dense operator bigger than this replays, and column capture stops once
+// it has seen more nonzeros.
+constexpr uint64_t kSynthesisMaxEntries = 1 << 18;
+// Matrix entries below this magnitude are structural zeros.
+constexpr double kSynthesisTolerance = 1e-13;
+
+template <typename T>
+struct CompiledOperator {
+  OperatorKind kind = OperatorKind::replay;
+  uint64_t dim = 0;
+  uint64_t replay_cost = 0;
+  uint64_t cost = 0;
+  CVec<T> d;                  // diagonal and permutation factors
+  std::vector<uint64_t> perm; // permutation: column j goes to row perm[j]
+  uint64_t kl = 0;            // banded: sub- and superdiagonals
+  uint64_t ku = 0;
+  CVec<T> band;               // banded: LAPACK band storage
+  CMat<T> mat;                // dense
+
+  bool profitable() const { return kind != OperatorKind::replay; }
+};
+
+// Estimated cost of replaying `program` on a register of dimension `dim`.
+template <typename T>
+uint64_t replay_cost(const Program<T>& program, uint64_t dim) {
+  uint64_t cost = 0;
+  for (const auto & ins : program) {
+    switch (ins.op) {
+    case OpCode::apply:
+      cost += dim * dim;
+      break;
+    case OpCode::applyX:
+    case OpCode::applyXconjugate:
+      cost += 4;
+      break;
+    case OpCode::applyDiagonal:
+      cost += ins.phases.size();
+      break;
+    default:
+      cost += 1;
+      break;
+    }
+    cost += kGateOverhead;
+  }
+  return cost;
+}
+
+constexpr uint64_t kFnvOffset = 14695981039346656037ULL;
+constexpr uint64_t kFnvPrime = 1099511628211ULL;
+
+inline uint64_t fnv1a(uint64_t hash, const void* data, uint64_t size) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (uint64_t k = 0; k < size; ++k) {
+    hash ^= bytes[k];
+    hash *= kFnvPrime;
+  }
+  return hash;
+}
+
+template <typename U>
+uint64_t fnv1a(uint64_t hash, const U& value) {
+  return fnv1a(hash, &value, sizeof(U));
+}
+
+// Builds the unitary column by column (the subcircuit applied to every
+// basis state) and keeps the cheapest of diagonal, permutation times
+// diagonal, banded and dense, or `replay` if none beats the gates. Every
+// instruction is taken to act on one register; idx_qreg is ignored.
+template <typename T>
+CompiledOperator<T> synthesize(const Program<T>& program, uint64_t dim) {
+  Expects(dim > 0);
+  for (const auto & ins : program)
+    Expects(ins.op != OpCode::measure);
+
+  CompiledOperator<T> op;
+  op.dim = dim;
+  op.replay_cost = replay_cost(program, dim);
+  op.cost = op.replay_cost;
+  // A diagonal, the cheapest form, costs dim + kGateOverhead; a lone gate
+  // is already applied by the kernel for its form, e.g. a dense apply
+  // costs as much as the dense matrix it would synthesize to.
+  if (dim > kSynthesisMaxDim || op.replay_cost <= dim + kGateOverhead
+      || program.size() == 1 || dim > kSynthesisMaxWork / op.replay_cost)
+    return op;
+
+  // every form costs at least its number of nonzeros
+  std::vector<std::vector<std::pair<uint64_t, Cmplx<T>>>> cols(dim);
+  uint64_t nnz = 0;
+  QReg<T> reg(dim);
+  for (uint64_t j = 0; j < dim; ++j) {
+    reg.reset(j);
+    for (const auto & ins : program)
+      execute(reg, ins);
+    for (uint64_t i = 0; i < dim; ++i)
+      if (std::abs(reg.data()[i]) > kSynthesisTolerance)
+        cols[j].emplace_back(i, reg.data()[i]);
+    nnz += cols[j].size();
+    if (nnz > kSynthesisMaxEntries || nnz + kGateOverhead >= op.replay_cost)
+      return op;
+  }
+
+  bool single = true;
+  bool diagonal = true;
+  std::vector<bool> seen(dim, false);
+  uint64_t kl = 0;
+  uint64_t ku = 0;
+  for (uint64_t j = 0; j < dim; ++j) {
+    if (cols[j].size() != 1 || seen[cols[j][0].first]) {
+      single = false;
+    } else {
+      seen[cols[j][0].first] = true;
+      diagonal = diagonal && cols[j][0].first == j;
+    }
+    for (const auto & e : cols[j]) {
+      kl = std::max(kl, e.first > j ? e.first - j : 0);
+      ku = std::max(ku, j > e.first ? j - e.first : 0);
+    }
+  }
+
+  const uint64_t ldb = kl + ku + 1;
+  if (single && diagonal) {
+    op.kind = OperatorKind::diagonal;
+    op.cost = dim + kGateOverhead;
+  } else if (single) {
+    op.kind = OperatorKind::permutation;
+    op.cost = 2 * dim + kGateOverhead;
+  } else if (ldb < dim) {
+    op.kind = OperatorKind::banded;
+    op.cost = ldb * dim + kGateOverhead;
+  } else {
+    op.kind = OperatorKind::dense;
+    op.cost = dim * dim + kGateOverhead;
+  }
+  const bool stored = op.kind == OperatorKind::banded
+                      || op.kind == OperatorKind::dense;
+  if (op.cost >= op.replay_cost
+      || (stored && op.cost - kGateOverhead > kSynthesisMaxEntries)) {
+    op.kind = OperatorKind::replay;
+    op.cost = op.replay_cost;
+    return op;
+  }
+
+  switch (op.kind) {
+  case OperatorKind::diagonal:
+  case OperatorKind::permutation:
+    op.d.resize(dim);
+    op.perm.resize(dim);
+    for (uint64_t j = 0; j < dim; ++j) {
+      op.perm[j] = cols[j][0].first;
+      op.d[j] = cols[j][0].second;
+    }
+    if (op.kind == OperatorKind::diagonal)
+      op.perm.clear();
+    break;
+  case OperatorKind::banded:
+    op.kl = kl;
+    op.ku = ku;
+    op.band.assign(ldb * dim, Cmplx<T>(0.0));
+    for (uint64_t j = 0; j < dim; ++j)
+      for (const auto & e : cols[j])
+        op.band[ku + e.first - j + j * ldb] = e.second;
+    break;
+  case OperatorKind::dense:
+    op.mat = CMat<T>(dim);
+    for (uint64_t j = 0; j < dim; ++j)
+      for (const auto & e : cols[j])
+        op.mat(e.first, j) = e.second;
+    break;
+  case OperatorKind::replay:
+    break;
+  }
+  return op;
+}
+
+template <typename T>
+void replay(Circuit<T>& circuit, uint64_t idx_qreg, const Program<T>& program) {
+  for (auto ins : program) {
+    ins.idx_qreg = idx_qreg;
+    execute(circuit, ins);
+  }
+}
+
+// Applies a profitable operator; `program` is replayed otherwise.
+template <typename T>
+void apply_operator(Circuit<T>& circuit, uint64_t idx_qreg,
+                    const CompiledOperator<T>& op, const Program<T>& program) {
+  Expects(op.dim == circuit.dim());
+
+  switch (op.kind) {
+  case OperatorKind::diagonal:
+    circuit.applyDiagonal(idx_qreg, op.d);
+    break;
+  case OperatorKind::permutation:
+    circuit.applyPermutation(idx_qreg, op.perm, op.d);
+    break;
+  case OperatorKind::banded:
+    circuit.applyBanded(idx_qreg, op.kl, op.ku, op.band);
+    break;
+  case OperatorKind::dense:
+    circuit.apply(idx_qreg, op.mat);
+    break;
+  case OperatorKind::replay:
+    replay(circuit, idx_qreg, program);
+    break;
+  }
+}
+
+// Content-addressed store of synthesized subcircuits: the key is an FNV-1a
+// hash of the gates and dim (not the register they were recorded on), and
+// entries are compared gate by gate, so a collision costs a synthesis but
+// never returns a wrong operator. Safe to share between threads.
+template <typename T>
+class SynthesisCache {
+public:
+  SynthesisCache<T>() = default;
+  ~SynthesisCache<T>() = default;
+  SynthesisCache<T>(const SynthesisCache<T>&) = delete;
+  SynthesisCache<T>(SynthesisCache<T>&&) = delete;
+  SynthesisCache<T>& operator=(const SynthesisCache<T>&) = delete;
+  SynthesisCache<T>& operator=(SynthesisCache<T>&&) = delete;
+
+  std::shared_ptr<const CompiledOperator<T>> compile(
+      const Program<T>& program, uint64_t dim);
+  void apply(Circuit<T>& circuit, uint64_t idx_qreg,
+             const Program<T>& program);
+
+  uint64_t size() const;
+  uint64_t hits() const;
+  uint64_t misses() const;
+  void clear();
+
+  static uint64_t key(const Program<T>& program, uint64_t dim);
+
+private:
+  struct Entry {
+    Program<T> program;
+    uint64_t dim;
+    std::shared_ptr<const CompiledOperator<T>> op;
+  };
+
+  static bool same(const Instruction<T>& a, const Instruction<T>& b);
+  const Entry* find(uint64_t key, const Program<T>& program,
+                    uint64_t dim) const;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<uint64_t, std::vector<Entry>> entries_;
+  uint64_t size_ = 0;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+};
+
+template <typename T>
+uint64_t SynthesisCache<T>::key(const Program<T>& program, uint64_t dim) {
+  uint64_t hash = fnv1a(kFnvOffset, dim);
+  for (const auto & ins : program) {
+    hash = fnv1a(hash, static_cast<uint8_t>(ins.op));
+    switch (ins.op) {
+    case OpCode::apply:
+      hash = fnv1a(hash, ins.mat.data(),
+                           ins.mat.size() * sizeof(Cmplx<T>));
+      break;
+    case OpCode::applyX:
+    case OpCode::applyXconjugate:
+      hash = fnv1a(hash, ins.i);
+      hash = fnv1a(hash, ins.x);
+      hash = fnv1a(hash, ins.y);
+      break;
+    case OpCode::applyZ:
+    case OpCode::applyZconjugate:
+      hash = fnv1a(hash, ins.i);
+      hash = fnv1a(hash, ins.tau);
+      break;
+    case OpCode::applyDiagonal:
+      hash = fnv1a(hash, ins.phases.data(),
+                           ins.phases.size() * sizeof(double));
+      break;
+    case OpCode::measure:
+      break;
+    }
+  }
+  return hash;
+}
+
+template <typename T>
+bool SynthesisCache<T>::same(
+    const Instruction<T>& a, const Instruction<T>& b) {
+  if (a.op != b.op)
+    return false;
+  switch (a.op) {
+  case OpCode::apply:
+    return a.mat == b.mat;
+  case OpCode::applyX:
+  case OpCode::applyXconjugate:
+    return a.i == b.i && a.x == b.x && a.y == b.y;
+  case OpCode::applyZ:
+  case OpCode::applyZconjugate:
+    return a.i == b.i && a.tau == b.tau;
+  case OpCode::applyDiagonal:
+    return a.phases == b.phases;
+  case OpCode::measure:
+    return a.i == b.i;
+  }
+  return false;
+}
+
+template <typename T>
+auto SynthesisCache<T>::find(uint64_t key, const Program<T>& program,
+                             uint64_t dim) const -> const Entry* {
+  const auto it = entries_.find(key);
+  if (it == entries_.end())
+    return nullptr;
+  for (const auto & entry : it->second)
+    if (entry.dim == dim && entry.program.size() == program.size()
+        && std::equal(program.begin(), program.end(), entry.program.begin(),
+                      same))
+      return &entry;
+  return nullptr;
+}
+
+template <typename T>
+std::shared_ptr<const CompiledOperator<T>> SynthesisCache<T>::compile(
+    const Program<T>& program, uint64_t dim) {
+  const uint64_t k = key(program, dim);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (const Entry* entry = find(k, program, dim)) {
+      ++hits_;
+      return entry->op;
+    }
+    ++misses_;
+  }
+
+  // synthesized without the lock; a concurrent miss on the same key keeps
+  // whichever operator was stored first
+  auto op = std::make_shared<const CompiledOperator<T>>(
+      synthesize(program, dim));
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (const Entry* entry = find(k, program, dim))
+    return entry->op;
+  entries_[k].push_back({program, dim, op});
+  ++size_;
+  return op;
+}
+
+template <typename T>
+void SynthesisCache<T>::apply(
+    Circuit<T>& circuit, uint64_t idx_qreg, const Program<T>& program) {
+  apply_operator(circuit, idx_qreg, *compile(program, circuit.dim()),
+                 program);
+}
+
+template <typename T>
+uint64_t SynthesisCache<T>::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return size_;
+}
+
+template <typename T>
+uint64_t SynthesisCache<T>::hits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return hits_;
+}
+
+template <typename T>
+uint64_t SynthesisCache<T>::misses() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return misses_;
+}
+
+template <typename T>
+void SynthesisCache<T>::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  size_ = 0;
+  hits_ = 0;
+  misses_ = 0;
+}
+
+} // namespace qsystem
+} // namespace qengine
+
+#endif // QENGINE_INCLUDE_SYNTHESIS_H_
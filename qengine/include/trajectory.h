@@ -0,0 +1,221 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_INCLUDE_TRAJECTORY_H_
+#define QENGINE_INCLUDE_TRAJECTORY_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "instruction.h"
+#include "qreg.h"
+#include "types.h"
+
+#include <gsl/gsl_assert>
+
+namespace qengine {
+inline namespace qsystem {
+
+// Squared norm below which a trajectory register is renormalized.
+constexpr double kTrajectoryRescale = 1e-4;
+
+// Noise applied after every gate of a trajectory: a phase flip of level i
+// with probability `dephasing` after applyZ(i), and a decay of level i into
+// level i - 1 with probability `damping` after applyX(i) (the same channels
+// as DensityReg::dephase and DensityReg::damp).
+template <typename T>
+struct NoiseModel {
+  T dephasing;
+  T damping;
+};
+
+// Monte-Carlo wave-function simulation of a Program under a NoiseModel.
+// Each worker owns one set of registers (O(dim) memory) and reuses it for
+// all trajectories it takes. Registers are left unnormalized between
+// gates; their squared norm is tracked in O(1) per damping step. Trajectory t draws from its own engine seeded
+// with (seed, t), so the histogram does not depend on the thread count.
+template <typename T>
+class TrajectoryEngine {
+public:
+  TrajectoryEngine<T>() = delete;
+  ~TrajectoryEngine<T>() = default;
+  TrajectoryEngine<T>(const TrajectoryEngine<T>&) = delete;
+  TrajectoryEngine<T>(TrajectoryEngine<T>&&) = delete;
+  TrajectoryEngine<T>& operator=(const TrajectoryEngine<T>&) = delete;
+  TrajectoryEngine<T>& operator=(TrajectoryEngine<T>&&) = delete;
+
+  TrajectoryEngine<T>(uint64_t nreg, uint64_t dim, NoiseModel<T> noise,
+                      uint64_t nthreads = 0);
+
+  uint64_t nthreads() const;
+
+  Histogram run(const Program<T>& program, uint64_t ntraj,
+                uint32_t seed = 1) const;
+
+private:
+  void run_one(const Program<T>& program, std::mt19937& mte,
+               std::vector<QReg<T>>& qregs, std::vector<CReg>& cregs) const;
+  void dephase(QReg<T>& qreg, uint64_t i, std::mt19937& mte) const;
+  void damp(QReg<T>& qreg, T& norm2, uint64_t i, std::mt19937& mte) const;
+
+  uint64_t nreg_;
+  uint64_t dim_;
+  NoiseModel<T> noise_;
+  uint64_t nthreads_;
+};
+
+template <typename T>
+TrajectoryEngine<T>::TrajectoryEngine(
+    uint64_t nreg, uint64_t dim, NoiseModel<T> noise, uint64_t nthreads)
+  : nreg_{nreg}, dim_{dim}, noise_(noise),
+    nthreads_{nthreads > 0 ? nthreads
+              : std::max<uint64_t>(1, std::thread::hardware_concurrency())} {
+  Expects(0 <= noise_.dephasing && noise_.dephasing <= 1);
+  Expects(0 <= noise_.damping && noise_.damping <= 1);
+}
+
+template <typename T>
+uint64_t TrajectoryEngine<T>::nthreads() const { return nthreads_; }
+
+template <typename T>
+Histogram TrajectoryEngine<T>::run(
+    const Program<T>& program, uint64_t ntraj, uint32_t seed) const {
+  Histogram histogram;
+  std::mutex mutex;
+  std::atomic<uint64_t> next{0};
+
+  const auto worker = [&]() {
+    std::vector<QReg<T>> qregs(nreg_, QReg<T>(dim_));
+    std::vector<CReg> cregs(nreg_);
+    Histogram local;
+    for (uint64_t t = next++; t < ntraj; t = next++) {
+      std::seed_seq seq{seed, static_cast<uint32_t>(t),
+                        static_cast<uint32_t>(t >> 32)};
+      std::mt19937 mte(seq);
+      for (auto & qreg : qregs)
+        qreg.reset();
+      std::fill(cregs.begin(), cregs.end(), 0);
+      run_one(program, mte, qregs, cregs);
+      ++local[cregs];
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto & h : local)
+      histogram[h.first] += h.second;
+  };
+
+  const uint64_t nworkers = std::min(nthreads_, std::max<uint64_t>(ntraj, 1));
+  std::vector<std::thread> threads;
+  for (uint64_t w = 1; w < nworkers; ++w)
+    threads.emplace_back(worker);
+  worker();
+  for (auto & thread : threads)
+    thread.join();
+  return histogram;
+}
+
+template <typename T>
+void TrajectoryEngine<T>::run_one(
+    const Program<T>& program, std::mt19937& mte,
+    std::vector<QReg<T>>& qregs, std::vector<CReg>& cregs) const {
+  std::vector<T> norm2(qregs.size(), T(1));
+  for (const auto & ins : program) {
+    QReg<T>& qreg = qregs[ins.idx_qreg];
+    switch (ins.op) {
+    case OpCode::apply:
+      qreg.apply(ins.mat);
+      break;
+    case OpCode::applyX:
+      qreg.applyX(ins.i, ins.x, ins.y);
+      damp(qreg, norm2[ins.idx_qreg], ins.i, mte);
+      break;
+    case OpCode::applyXconjugate:
+      qreg.applyXconjugate(ins.i, ins.x, ins.y);
+      damp(qreg, norm2[ins.idx_qreg], ins.i, mte);
+      break;
+    case OpCode::applyZ:
+      qreg.applyZ(ins.i, ins.tau);
+      dephase(qreg, ins.i, mte);
+      break;
+    case OpCode::applyZconjugate:
+      qreg.applyZconjugate(ins.i, ins.tau);
+      dephase(qreg, ins.i, mte);
+      break;
+    case OpCode::applyDiagonal:
+      qreg.applyDiagonal(ins.phases);
+      for (uint64_t i = 0; i < ins.phases.size(); ++i)
+        dephase(qreg, i, mte);
+      break;
+    case OpCode::measure: {
+      // discrete_distribution normalizes the weights itself
+      const RVec<T> probs = qreg.probabilities();
+      std::discrete_distribution<CReg> distrib(probs.begin(), probs.end());
+      cregs[ins.i] = distrib(mte);
+      break;
+    }
+    }
+  }
+}
+
+template <typename T>
+void TrajectoryEngine<T>::dephase(
+    QReg<T>& qreg, uint64_t i, std::mt19937& mte) const {
+  if (noise_.dephasing == 0)
+    return;
+  std::uniform_real_distribution<T> uniform;
+  if (uniform(mte) < noise_.dephasing)
+    qreg.scale(i, -1);
+}
+
+// Jump with probability gamma |a_i|^2 / norm2 to |i - 1>; otherwise apply
+// K_0, which lowers the squared norm by gamma |a_i|^2. The register is only
+// rescaled once its norm has decayed far enough to cost precision.
+template <typename T>
+void TrajectoryEngine<T>::damp(
+    QReg<T>& qreg, T& norm2, uint64_t i, std::mt19937& mte) const {
+  if (noise_.damping == 0)
+    return;
+  std::uniform_real_distribution<T> uniform;
+  const T weight = noise_.damping * probability(qreg.data()[i]);
+  if (uniform(mte) * norm2 < weight) {
+    qreg.reset(i - 1);
+    norm2 = 1;
+  } else {
+    qreg.scale(i, std::sqrt(1 - noise_.damping));
+    norm2 -= weight;
+    if (norm2 < kTrajectoryRescale) {
+      qreg.normalize();
+      norm2 = 1;
+    }
+  }
+}
+
+} // namespace qsystem
+} // namespace qengine
+
+#endif // QENGINE_INCLUDE_TRAJECTORY_H_
@@ -0,0 +1,185 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_UTILS_COMPRESSION_H_
+#define QENGINE_UTILS_COMPRESSION_H_
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <gsl/gsl_assert>
+
+namespace qengine {
+inline namespace util {
+
+// Cold storage of amplitude arrays. The 2n real components are written as
+// fixed-width words, byte-shuffled so that byte b of every word lands in
+// plane b, and the planes run-length encoded: zero amplitudes and the
+// sign/exponent bytes of similar values become long runs. lossless keeps
+// the IEEE words; quantized stores round(x / step) zig-zag encoded in as
+// few bytes as the largest one needs, so every component is reproduced
+// within step / 2.
+enum class Codec : uint8_t { lossless, quantized };
+
+struct CompressedBlock {
+  Codec codec;
+  uint64_t count;
+  uint32_t width;
+  double step;
+  std::vector<uint8_t> bytes;
+};
+
+// Control byte c < 128: c + 1 literal bytes follow; c >= 128: the next byte
+// repeats c - 125 times (3 .. 130).
+inline std::vector<uint8_t> rle_encode(const uint8_t* data, uint64_t n) {
+  std::vector<uint8_t> res;
+  uint64_t i = 0;
+  while (i < n) {
+    uint64_t run = 1;
+    while (i + run < n && run < 130 && data[i + run] == data[i])
+      ++run;
+    if (run >= 3) {
+      res.push_back(static_cast<uint8_t>(125 + run));
+      res.push_back(data[i]);
+      i += run;
+      continue;
+    }
+
+    const uint64_t start = i;
+    while (i < n && i - start < 128
+           && !(i + 2 < n && data[i] == data[i + 1] && data[i] == data[i + 2]))
+      ++i;
+    res.push_back(static_cast<uint8_t>(i - start - 1));
+    res.insert(res.end(), data + start, data + i);
+  }
+  return res;
+}
+
+inline std::vector<uint8_t> rle_decode(
+    const std::vector<uint8_t>& encoded, uint64_t n) {
+  std::vector<uint8_t> res;
+  res.reserve(n);
+  uint64_t k = 0;
+  while (k < encoded.size()) {
+    const uint8_t c = encoded[k++];
+    if (c < 128) {
+      Expects(k + c + 1 <= encoded.size());
+      res.insert(res.end(), encoded.begin() + k, encoded.begin() + k + c + 1);
+      k += c + 1;
+    } else {
+      Expects(k < encoded.size());
+      res.insert(res.end(), c - 125, encoded[k++]);
+    }
+  }
+  Expects(res.size() == n);
+  return res;
+}
+
+// planes[b * count + k] = words[k * width + b], and back.
+inline std::vector<uint8_t> shuffle_bytes(
+    const uint8_t* words, uint64_t count, uint32_t width) {
+  std::vector<uint8_t> planes(count * width);
+  for (uint64_t k = 0; k < count; ++k)
+    for (uint32_t b = 0; b < width; ++b)
+      planes[b * count + k] = words[k * width + b];
+  return planes;
+}
+
+inline std::vector<uint8_t> unshuffle_bytes(
+    const std::vector<uint8_t>& planes, uint64_t count, uint32_t width) {
+  std::vector<uint8_t> words(count * width);
+  for (uint64_t k = 0; k < count; ++k)
+    for (uint32_t b = 0; b < width; ++b)
+      words[k * width + b] = planes[b * count + k];
+  return words;
+}
+
+// tolerance > 0 selects the quantized codec with step = 2 * tolerance,
+// unless the quantized words would not fit in 62 bits.
+template <typename T>
+CompressedBlock compress(
+    const std::complex<T>* data, uint64_t n, double tolerance = 0.0) {
+  Expects(tolerance >= 0.0);
+  const T* x = reinterpret_cast<const T*>(data);
+  const uint64_t count = 2 * n;
+
+  T max_abs = 0;
+  for (uint64_t k = 0; k < count; ++k)
+    max_abs = std::max(max_abs, std::abs(x[k]));
+  const double step = 2 * tolerance;
+  if (tolerance == 0.0 || !(max_abs / step < std::ldexp(1.0, 61))) {
+    const auto planes = shuffle_bytes(
+        reinterpret_cast<const uint8_t*>(x), count, sizeof(T));
+    return {Codec::lossless, count, sizeof(T), 0.0,
+            rle_encode(planes.data(), planes.size())};
+  }
+
+  std::vector<uint64_t> q(count);
+  uint64_t max_q = 0;
+  for (uint64_t k = 0; k < count; ++k) {
+    const int64_t v = std::llround(x[k] / step);
+    q[k] = (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    max_q = std::max(max_q, q[k]);
+  }
+  uint32_t width = 1;
+  while (width < 8 && (max_q >> (8 * width)) != 0)
+    ++width;
+
+  std::vector<uint8_t> words(count * width);
+  for (uint64_t k = 0; k < count; ++k)
+    for (uint32_t b = 0; b < width; ++b)
+      words[k * width + b] = static_cast<uint8_t>(q[k] >> (8 * b));
+  const auto planes = shuffle_bytes(words.data(), count, width);
+  return {Codec::quantized, count, width, step,
+          rle_encode(planes.data(), planes.size())};
+}
+
+template <typename T>
+void decompress(const CompressedBlock& block, std::complex<T>* data) {
+  const auto words = unshuffle_bytes(
+      rle_decode(block.bytes, block.count * block.width), block.count,
+      block.width);
+  T* x = reinterpret_cast<T*>(data);
+  if (block.codec == Codec::lossless) {
+    Expects(block.width == sizeof(T));
+    std::memcpy(x, words.data(), words.size());
+    return;
+  }
+
+  for (uint64_t k = 0; k < block.count; ++k) {
+    uint64_t q = 0;
+    for (uint32_t b = 0; b < block.width; ++b)
+      q |= static_cast<uint64_t>(words[k * block.width + b]) << (8 * b);
+    const int64_t v =
+        static_cast<int64_t>(q >> 1) ^ -static_cast<int64_t>(q & 1);
+    x[k] = static_cast<T>(v * block.step);
+  }
+}
+
+} // namespace util
+} // namespace qengine
+
+#endif // QENGINE_UTILS_COMPRESSION_H_
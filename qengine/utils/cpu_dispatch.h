@@ -0,0 +1,260 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_UTILS_CPU_DISPATCH_H_
+#define QENGINE_UTILS_CPU_DISPATCH_H_
+
+#include <complex>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// Kernels are compiled for every ISA level via target attributes and one
+// variant is picked at startup from CPUID, independently of -march.
+#if defined(QENGINE_RUNTIME_DISPATCH) && defined(__GNUC__) \
+    && (defined(__x86_64__) || defined(__i386__))
+#define QENGINE_HAS_DISPATCH 1
+#define QENGINE_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define QENGINE_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#endif
+
+#if defined(__GNUC__)
+#define QENGINE_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define QENGINE_ALWAYS_INLINE inline
+#endif
+
+namespace qengine {
+inline namespace util {
+
+enum class Isa { scalar, avx2, avx512 };
+
+inline const char* isa_name(Isa isa) {
+  switch (isa) {
+  case Isa::avx2:
+    return "avx2";
+  case Isa::avx512:
+    return "avx512";
+  default:
+    return "scalar";
+  }
+}
+
+// Best level the CPU (and OS) supports among the compiled variants.
+inline Isa detect_isa() {
+#ifdef QENGINE_HAS_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return Isa::avx512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return Isa::avx2;
+#endif
+  return Isa::scalar;
+}
+
+// Level used by the kernels, fixed on first call. QENGINE_ISA=scalar|avx2
+// lowers it, e.g. to compare paths on one host; it is never raised above
+// detect_isa().
+inline Isa active_isa() {
+  static const Isa isa = [] {
+    Isa res = detect_isa();
+    const char* env = std::getenv("QENGINE_ISA");
+    if (env != nullptr) {
+      Isa cap = Isa::avx512;
+      if (std::strcmp(env, "scalar") == 0)
+        cap = Isa::scalar;
+      else if (std::strcmp(env, "avx2") == 0)
+        cap = Isa::avx2;
+      if (static_cast<int>(cap) < static_cast<int>(res))
+        res = cap;
+    }
+    return res;
+  }();
+  return isa;
+}
+
+namespace kernel {
+
+// Bodies shared by every variant. W independent accumulators let the
+// compiler vectorize the reductions without reassociating them.
+template <typename T, int W>
+QENGINE_ALWAYS_INLINE std::complex<T> dot_conj(
+    const std::complex<T>* bra, const std::complex<T>* ket, uint64_t n) {
+  const T* a = reinterpret_cast<const T*>(bra);
+  const T* b = reinterpret_cast<const T*>(ket);
+  T re[W] = {};
+  T im[W] = {};
+  uint64_t k = 0;
+  for (; k + W <= n; k += W) {
+    for (int l = 0; l < W; ++l) {
+      const uint64_t m = 2 * (k + l);
+      re[l] += a[m] * b[m] + a[m + 1] * b[m + 1];
+      im[l] += a[m] * b[m + 1] - a[m + 1] * b[m];
+    }
+  }
+  for (; k < n; ++k) {
+    const uint64_t m = 2 * k;
+    re[0] += a[m] * b[m] + a[m + 1] * b[m + 1];
+    im[0] += a[m] * b[m + 1] - a[m + 1] * b[m];
+  }
+  T res_re = 0;
+  T res_im = 0;
+  for (int l = 0; l < W; ++l) {
+    res_re += re[l];
+    res_im += im[l];
+  }
+  return std::complex<T>(res_re, res_im);
+}
+
+template <typename T, int W>
+QENGINE_ALWAYS_INLINE T norm2(const std::complex<T>* x, uint64_t n) {
+  const T* a = reinterpret_cast<const T*>(x);
+  T acc[W] = {};
+  uint64_t k = 0;
+  for (; k + W <= 2 * n; k += W)
+    for (int l = 0; l < W; ++l)
+      acc[l] += a[k + l] * a[k + l];
+  for (; k < 2 * n; ++k)
+    acc[0] += a[k] * a[k];
+  T res = 0;
+  for (int l = 0; l < W; ++l)
+    res += acc[l];
+  return res;
+}
+
+// y += alpha * x
+template <typename T>
+QENGINE_ALWAYS_INLINE void axpy(std::complex<T> alpha,
+                                const std::complex<T>* x,
+                                std::complex<T>* y, uint64_t n) {
+  const T* a = reinterpret_cast<const T*>(x);
+  T* b = reinterpret_cast<T*>(y);
+  const T re = alpha.real();
+  const T im = alpha.imag();
+  for (uint64_t k = 0; k < 2 * n; k += 2) {
+    b[k] += re * a[k] - im * a[k + 1];
+    b[k + 1] += re * a[k + 1] + im * a[k];
+  }
+}
+
+// y += alpha * x for a real x
+template <typename T>
+QENGINE_ALWAYS_INLINE void axpy_real(std::complex<T> alpha, const T* x,
+                                     std::complex<T>* y, uint64_t n) {
+  T* b = reinterpret_cast<T*>(y);
+  const T re = alpha.real();
+  const T im = alpha.imag();
+  for (uint64_t k = 0; k < n; ++k) {
+    b[2 * k] += re * x[k];
+    b[2 * k + 1] += im * x[k];
+  }
+}
+
+template <typename T>
+QENGINE_ALWAYS_INLINE void scale(T factor, std::complex<T>* x, uint64_t n) {
+  T* a = reinterpret_cast<T*>(x);
+  for (uint64_t k = 0; k < 2 * n; ++k)
+    a[k] *= factor;
+}
+
+template <typename T>
+struct Table {
+  std::complex<T> (*dot_conj)(
+      const std::complex<T>*, const std::complex<T>*, uint64_t);
+  T (*norm2)(const std::complex<T>*, uint64_t);
+  void (*axpy)(std::complex<T>, const std::complex<T>*, std::complex<T>*,
+               uint64_t);
+  void (*axpy_real)(std::complex<T>, const T*, std::complex<T>*, uint64_t);
+  void (*scale)(T, std::complex<T>*, uint64_t);
+};
+
+#define QENGINE_KERNEL_VARIANT(NAME, TARGET, LANES)                          \
+  template <typename T>                                                      \
+  struct NAME {                                                              \
+    TARGET static std::complex<T> dot_conj(                                  \
+        const std::complex<T>* a, const std::complex<T>* b, uint64_t n) {    \
+      return kernel::dot_conj<T, LANES>(a, b, n);                            \
+    }                                                                        \
+    TARGET static T norm2(const std::complex<T>* x, uint64_t n) {            \
+      return kernel::norm2<T, 2 * LANES>(x, n);                              \
+    }                                                                        \
+    TARGET static void axpy(std::complex<T> alpha, const std::complex<T>* x, \
+                            std::complex<T>* y, uint64_t n) {                \
+      kernel::axpy(alpha, x, y, n);                                          \
+    }                                                                        \
+    TARGET static void axpy_real(std::complex<T> alpha, const T* x,          \
+                                 std::complex<T>* y, uint64_t n) {           \
+      kernel::axpy_real(alpha, x, y, n);                                     \
+    }                                                                        \
+    TARGET static void scale(T factor, std::complex<T>* x, uint64_t n) {     \
+      kernel::scale(factor, x, n);                                           \
+    }                                                                        \
+    static Table<T> table() {                                                \
+      return {&dot_conj, &norm2, &axpy, &axpy_real, &scale};                 \
+    }                                                                        \
+  };
+
+QENGINE_KERNEL_VARIANT(Scalar, , 4)
+#ifdef QENGINE_HAS_DISPATCH
+QENGINE_KERNEL_VARIANT(Avx2, QENGINE_TARGET_AVX2, 32 / (2 * sizeof(T)))
+QENGINE_KERNEL_VARIANT(Avx512, QENGINE_TARGET_AVX512, 64 / (2 * sizeof(T)))
+#endif
+
+#undef QENGINE_KERNEL_VARIANT
+
+#ifdef QENGINE_EXTERN_TEMPLATES
+// one object file per ISA in the compiled library, see src/kernels_*.cpp
+extern template struct Scalar<float>;
+extern template struct Scalar<double>;
+#ifdef QENGINE_HAS_DISPATCH
+extern template struct Avx2<float>;
+extern template struct Avx2<double>;
+extern template struct Avx512<float>;
+extern template struct Avx512<double>;
+#endif
+#endif
+
+} // namespace kernel
+
+// Function table for active_isa(), built once per precision.
+template <typename T>
+const kernel::Table<T>& kernels() {
+  static const kernel::Table<T> table = [] {
+#ifdef QENGINE_HAS_DISPATCH
+    switch (active_isa()) {
+    case Isa::avx512:
+      return kernel::Avx512<T>::table();
+    case Isa::avx2:
+      return kernel::Avx2<T>::table();
+    default:
+      break;
+    }
+#endif
+    return kernel::Scalar<T>::table();
+  }();
+  return table;
+}
+
+} // namespace util
+} // namespace qengine
+
+#endif // QENGINE_UTILS_CPU_DISPATCH_H_
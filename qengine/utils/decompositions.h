@@ -0,0 +1,239 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_UTILS_DECOMPOSITIONS_H_
+#define QENGINE_UTILS_DECOMPOSITIONS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include "linalg_backend.h"
+#include "matrix.h"
+
+namespace qengine {
+inline namespace util {
+
+// A = U diag(S) Vh with S sorted in descending order; U is m x k and Vh is
+// k x n with k = min(m, n).
+template <typename T>
+struct SVD {
+  Matrix<std::complex<T>> U;
+  std::vector<T> S;
+  Matrix<std::complex<T>> Vh;
+};
+
+// One-sided (Hestenes) Jacobi SVD. Columns of A V are rotated pairwise until
+// they are mutually orthogonal; their norms are then the singular values.
+template <typename T>
+SVD<T> svd_jacobi(const Matrix<std::complex<T>>& A) {
+  using C = std::complex<T>;
+  const uint64_t m = A.nrows();
+  const uint64_t n = A.ncols();
+  const T eps = std::numeric_limits<T>::epsilon();
+
+  Matrix<C> W(A);
+  Matrix<C> V(n, n);
+  for (uint64_t i = 0; i < n; ++i)
+    V(i, i) = 1.0;
+
+  for (int sweep = 0; sweep < 60; ++sweep) {
+    bool rotated = false;
+    for (uint64_t p = 0; p + 1 < n; ++p)
+      for (uint64_t q = p + 1; q < n; ++q) {
+        T alpha = 0.0, beta = 0.0;
+        C gamma = 0.0;
+        for (uint64_t i = 0; i < m; ++i) {
+          alpha += std::norm(W(i, p));
+          beta += std::norm(W(i, q));
+          gamma += std::conj(W(i, p)) * W(i, q);
+        }
+        const T abs_gamma = std::abs(gamma);
+        if (abs_gamma <= eps * std::sqrt(alpha * beta) || abs_gamma == 0.0)
+          continue;
+        rotated = true;
+
+        const C phase = std::conj(gamma) / abs_gamma;
+        const T zeta = (beta - alpha) / (2 * abs_gamma);
+        const T t = (zeta >= 0 ? 1 : -1)
+                  / (std::abs(zeta) + std::sqrt(1 + zeta * zeta));
+        const T c = 1 / std::sqrt(1 + t * t);
+        const T s = c * t;
+        for (uint64_t i = 0; i < m; ++i) {
+          const C w_p = W(i, p);
+          const C w_q = W(i, q) * phase;
+          W(i, p) = c * w_p - s * w_q;
+          W(i, q) = s * w_p + c * w_q;
+        }
+        for (uint64_t i = 0; i < n; ++i) {
+          const C v_p = V(i, p);
+          const C v_q = V(i, q) * phase;
+          V(i, p) = c * v_p - s * v_q;
+          V(i, q) = s * v_p + c * v_q;
+        }
+      }
+    if (!rotated)
+      break;
+  }
+
+  std::vector<T> norms(n);
+  for (uint64_t j = 0; j < n; ++j) {
+    T norm = 0.0;
+    for (uint64_t i = 0; i < m; ++i)
+      norm += std::norm(W(i, j));
+    norms[j] = std::sqrt(norm);
+  }
+  std::vector<uint64_t> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&norms](uint64_t a, uint64_t b) {
+                     return norms[a] > norms[b];
+                   });
+
+  const uint64_t k = std::min(m, n);
+  SVD<T> res{Matrix<C>(m, k), std::vector<T>(k), Matrix<C>(k, n)};
+  for (uint64_t r = 0; r < k; ++r) {
+    const uint64_t j = order[r];
+    res.S[r] = norms[j];
+    for (uint64_t i = 0; i < m; ++i)
+      res.U(i, r) = norms[j] > 0 ? W(i, j) / norms[j] : C(i == r ? 1 : 0);
+    for (uint64_t i = 0; i < n; ++i)
+      res.Vh(r, i) = std::conj(V(i, j));
+  }
+  return res;
+}
+
+// LAPACK ?gesvd when available, see linalg_backend.h; the singular vectors
+// may then differ from svd_jacobi() by a phase.
+template <typename T>
+SVD<T> svd(const Matrix<std::complex<T>>& A) {
+  const uint64_t m = A.nrows();
+  const uint64_t n = A.ncols();
+  const uint64_t k = std::min(m, n);
+  Matrix<std::complex<T>> W(A);
+  SVD<T> res{Matrix<std::complex<T>>(m, k), std::vector<T>(k),
+             Matrix<std::complex<T>>(k, n)};
+  if (k > 0 && gesvd(m, n, &W(0, 0), res.S.data(), &res.U(0, 0),
+                     &res.Vh(0, 0)) == 0)
+    return res;
+  return svd_jacobi(A);
+}
+
+// A = V diag(w) V^dagger for a Hermitian A, with w sorted in ascending order
+// and the eigenvectors in the columns of V.
+template <typename T>
+struct EigH {
+  std::vector<T> w;
+  Matrix<std::complex<T>> V;
+};
+
+// Cyclic Jacobi for Hermitian matrices. Each rotation first turns the pivot
+// a_pq = |a_pq| e^{i phi} real with diag(1, e^{-i phi}) and then applies
+// the real symmetric Jacobi rotation to rows and columns p, q.
+template <typename T>
+EigH<T> eigh_jacobi(const Matrix<std::complex<T>>& A) {
+  using C = std::complex<T>;
+  Expects(A.nrows() == A.ncols());
+  const uint64_t n = A.nrows();
+  const T eps = std::numeric_limits<T>::epsilon();
+
+  Matrix<C> B(A);
+  Matrix<C> V(n, n);
+  for (uint64_t i = 0; i < n; ++i)
+    V(i, i) = 1.0;
+
+  for (int sweep = 0; sweep < 60; ++sweep) {
+    T off = 0.0, diag = 0.0;
+    for (uint64_t j = 0; j < n; ++j)
+      for (uint64_t i = 0; i < n; ++i)
+        (i == j ? diag : off) += std::norm(B(i, j));
+    if (off <= eps * eps * diag || off == 0.0)
+      break;
+
+    for (uint64_t p = 0; p + 1 < n; ++p)
+      for (uint64_t q = p + 1; q < n; ++q) {
+        const T abs_b = std::abs(B(p, q));
+        if (abs_b == 0.0)
+          continue;
+
+        const C phase = B(p, q) / abs_b;
+        const T zeta = (B(q, q).real() - B(p, p).real()) / (2 * abs_b);
+        const T t = (zeta >= 0 ? 1 : -1)
+                  / (std::abs(zeta) + std::sqrt(1 + zeta * zeta));
+        const T c = 1 / std::sqrt(1 + t * t);
+        const T s = c * t;
+        // U = diag(1, e^{-i phi}) [[c, s], [-s, c]], B <- U^dagger B U
+        const C u_qp = -s * std::conj(phase);
+        const C u_qq = c * std::conj(phase);
+        for (uint64_t k = 0; k < n; ++k) {
+          const C b_p = B(k, p);
+          const C b_q = B(k, q);
+          B(k, p) = c * b_p + u_qp * b_q;
+          B(k, q) = s * b_p + u_qq * b_q;
+          const C v_p = V(k, p);
+          const C v_q = V(k, q);
+          V(k, p) = c * v_p + u_qp * v_q;
+          V(k, q) = s * v_p + u_qq * v_q;
+        }
+        for (uint64_t k = 0; k < n; ++k) {
+          const C b_p = B(p, k);
+          const C b_q = B(q, k);
+          B(p, k) = c * b_p + std::conj(u_qp) * b_q;
+          B(q, k) = s * b_p + std::conj(u_qq) * b_q;
+        }
+      }
+  }
+
+  std::vector<uint64_t> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&B](uint64_t a, uint64_t b) {
+    return B(a, a).real() < B(b, b).real();
+  });
+
+  EigH<T> res{std::vector<T>(n), Matrix<C>(n, n)};
+  for (uint64_t r = 0; r < n; ++r) {
+    res.w[r] = B(order[r], order[r]).real();
+    for (uint64_t i = 0; i < n; ++i)
+      res.V(i, r) = V(i, order[r]);
+  }
+  return res;
+}
+
+// LAPACK ?heev when available, see linalg_backend.h.
+template <typename T>
+EigH<T> eigh(const Matrix<std::complex<T>>& A) {
+  Expects(A.nrows() == A.ncols());
+  const uint64_t n = A.nrows();
+  EigH<T> res{std::vector<T>(n), A};
+  if (n > 0 && heev(n, &res.V(0, 0), res.w.data()) == 0)
+    return res;
+  return eigh_jacobi(A);
+}
+
+} // namespace util
+} // namespace qengine
+
+#endif // QENGINE_UTILS_DECOMPOSITIONS_H_
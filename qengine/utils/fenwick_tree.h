@@ -0,0 +1,166 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_UTILS_FENWICK_TREE_H_
+#define QENGINE_UTILS_FENWICK_TREE_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <gsl/gsl_assert>
+
+namespace qengine {
+inline namespace util {
+
+// Binary indexed tree over non-negative weights: point updates, prefix sums
+// and inverse-CDF lookup in O(log n). The weights themselves are kept too,
+// so set() can turn an absolute value into a delta.
+template <typename T>
+class FenwickTree {
+public:
+  FenwickTree<T>();
+  ~FenwickTree<T>();
+  FenwickTree<T>(const FenwickTree<T>&);
+  FenwickTree<T>(FenwickTree<T>&&);
+  FenwickTree<T>& operator=(const FenwickTree<T>&);
+  FenwickTree<T>& operator=(FenwickTree<T>&&);
+
+  explicit FenwickTree<T>(const std::vector<T>& values);
+
+  uint64_t size() const;
+  T value(uint64_t i) const;
+  const std::vector<T>& values() const;
+
+  void assign(const std::vector<T>& values);
+  void set(uint64_t i, T value);
+  void add(uint64_t i, T delta);
+
+  // Sum of the first i weights.
+  T prefix_sum(uint64_t i) const;
+  T total() const;
+  // Smallest i with prefix_sum(i + 1) > u, skipping zero weights.
+  uint64_t find(T u) const;
+
+private:
+  std::vector<T> values_;
+  std::vector<T> tree_;
+};
+
+template <typename T>
+FenwickTree<T>::FenwickTree() = default;
+
+template <typename T>
+FenwickTree<T>::~FenwickTree() = default;
+
+template <typename T>
+FenwickTree<T>::FenwickTree(const FenwickTree<T>&) = default;
+
+template <typename T>
+FenwickTree<T>::FenwickTree(FenwickTree<T>&&) = default;
+
+template <typename T>
+FenwickTree<T>& FenwickTree<T>::operator=(const FenwickTree<T>&) = default;
+
+template <typename T>
+FenwickTree<T>& FenwickTree<T>::operator=(FenwickTree<T>&&) = default;
+
+template <typename T>
+FenwickTree<T>::FenwickTree(const std::vector<T>& values) { assign(values); }
+
+template <typename T>
+uint64_t FenwickTree<T>::size() const { return values_.size(); }
+
+template <typename T>
+T FenwickTree<T>::value(uint64_t i) const { return values_[i]; }
+
+template <typename T>
+const std::vector<T>& FenwickTree<T>::values() const { return values_; }
+
+template <typename T>
+void FenwickTree<T>::assign(const std::vector<T>& values) {
+  values_ = values;
+  tree_.assign(values_.size() + 1, T(0));
+  const uint64_t n = values_.size();
+  for (uint64_t i = 1; i <= n; ++i) {
+    tree_[i] += values_[i - 1];
+    const uint64_t parent = i + (i & (~i + 1));
+    if (parent <= n)
+      tree_[parent] += tree_[i];
+  }
+}
+
+template <typename T>
+void FenwickTree<T>::set(uint64_t i, T value) {
+  Expects(i < values_.size());
+  const T delta = value - values_[i];
+  values_[i] = value;
+  for (uint64_t k = i + 1; k < tree_.size(); k += k & (~k + 1))
+    tree_[k] += delta;
+}
+
+template <typename T>
+void FenwickTree<T>::add(uint64_t i, T delta) {
+  Expects(i < values_.size());
+  set(i, values_[i] + delta);
+}
+
+template <typename T>
+T FenwickTree<T>::prefix_sum(uint64_t i) const {
+  Expects(i <= values_.size());
+  T res(0);
+  for (uint64_t k = i; k > 0; k -= k & (~k + 1))
+    res += tree_[k];
+  return res;
+}
+
+template <typename T>
+T FenwickTree<T>::total() const { return prefix_sum(values_.size()); }
+
+template <typename T>
+uint64_t FenwickTree<T>::find(T u) const {
+  Expects(!values_.empty());
+
+  const uint64_t n = values_.size();
+  uint64_t step = 1;
+  while (step * 2 <= n)
+    step *= 2;
+
+  uint64_t pos = 0;
+  for (; step > 0; step /= 2) {
+    if (pos + step <= n && tree_[pos + step] <= u) {
+      pos += step;
+      u -= tree_[pos];
+    }
+  }
+
+  // Rounding can leave u past the last non-zero weight.
+  if (pos >= n)
+    pos = n - 1;
+  while (pos > 0 && values_[pos] == T(0))
+    --pos;
+  return pos;
+}
+
+} // namespace util
+} // namespace qengine
+
+#endif // QENGINE_UTILS_FENWICK_TREE_H_
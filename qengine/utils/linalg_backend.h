@@ -0,0 +1,238 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_UTILS_LINALG_BACKEND_H_
+#define QENGINE_UTILS_LINALG_BACKEND_H_
+
+#include <algorithm>
+#include <complex>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Dense products go to CBLAS and Hermitian eigen / singular value
+// decompositions to LAPACK when CMake found them (QENGINE_HAS_CBLAS,
+// QENGINE_HAS_LAPACK); otherwise, and for other element types, to the
+// built-in kernels.
+#ifdef QENGINE_HAS_CBLAS
+#include <cblas.h>
+#endif
+
+#ifdef QENGINE_HAS_LAPACK
+// Fortran LAPACK, exported under these names by the reference library,
+// OpenBLAS and MKL alike.
+extern "C" {
+void cheev_(const char* jobz, const char* uplo, const int* n,
+            std::complex<float>* a, const int* lda, float* w,
+            std::complex<float>* work, const int* lwork, float* rwork,
+            int* info);
+void zheev_(const char* jobz, const char* uplo, const int* n,
+            std::complex<double>* a, const int* lda, double* w,
+            std::complex<double>* work, const int* lwork, double* rwork,
+            int* info);
+void cgesvd_(const char* jobu, const char* jobvt, const int* m, const int* n,
+             std::complex<float>* a, const int* lda, float* s,
+             std::complex<float>* u, const int* ldu, std::complex<float>* vt,
+             const int* ldvt, std::complex<float>* work, const int* lwork,
+             float* rwork, int* info);
+void zgesvd_(const char* jobu, const char* jobvt, const int* m, const int* n,
+             std::complex<double>* a, const int* lda, double* s,
+             std::complex<double>* u, const int* ldu,
+             std::complex<double>* vt, const int* ldvt,
+             std::complex<double>* work, const int* lwork, double* rwork,
+             int* info);
+}
+#endif
+
+namespace qengine {
+inline namespace util {
+
+inline const char* backend_name() {
+#if defined(QENGINE_HAS_CBLAS) && defined(QENGINE_HAS_LAPACK)
+  return "cblas+lapack";
+#elif defined(QENGINE_HAS_CBLAS)
+  return "cblas";
+#elif defined(QENGINE_HAS_LAPACK)
+  return "lapack";
+#else
+  return "builtin";
+#endif
+}
+
+// Tile edge of the built-in product, a 64 x 64 complex<double> tile is 64 KB.
+constexpr uint64_t kGemmBlock = 64;
+// Below this many multiply-adds the call overhead of the vendor library
+// outweighs its kernels (gate-sized matrices).
+constexpr uint64_t kBlasMinWork = 4096;
+
+// C += A B for column-major A (m x k), B (k x n) and C (m x n), tiled so
+// that a block of A stays in cache while the columns of B stream past.
+template <typename T>
+void gemm_builtin(uint64_t m, uint64_t n, uint64_t k,
+                  const T* A, const T* B, T* C) {
+  for (uint64_t jb = 0; jb < n; jb += kGemmBlock)
+    for (uint64_t lb = 0; lb < k; lb += kGemmBlock)
+      for (uint64_t ib = 0; ib < m; ib += kGemmBlock) {
+        const uint64_t j_end = std::min(n, jb + kGemmBlock);
+        const uint64_t l_end = std::min(k, lb + kGemmBlock);
+        const uint64_t i_end = std::min(m, ib + kGemmBlock);
+        for (uint64_t j = jb; j < j_end; ++j)
+          for (uint64_t l = lb; l < l_end; ++l) {
+            const T b = B[l + j * k];
+            for (uint64_t i = ib; i < i_end; ++i)
+              C[i + j * m] += A[i + l * m] * b;
+          }
+      }
+}
+
+// C += x y^T for an m x n block of C with leading dimension ldc.
+template <typename T>
+void ger_builtin(uint64_t m, uint64_t n, const T* x, const T* y,
+                 T* C, uint64_t ldc) {
+  for (uint64_t j = 0; j < n; ++j)
+    for (uint64_t i = 0; i < m; ++i)
+      C[i + j * ldc] += x[i] * y[j];
+}
+
+// The vendor interfaces take int dimensions.
+inline bool fits_int(uint64_t dim) {
+  return dim <= static_cast<uint64_t>(std::numeric_limits<int>::max());
+}
+
+inline bool use_blas(uint64_t work, uint64_t max_dim) {
+  return work >= kBlasMinWork && fits_int(max_dim);
+}
+
+template <typename T>
+void gemm(uint64_t m, uint64_t n, uint64_t k, const T* A, const T* B, T* C) {
+  gemm_builtin(m, n, k, A, B, C);
+}
+
+template <typename T>
+void ger(uint64_t m, uint64_t n, const T* x, const T* y, T* C, uint64_t ldc) {
+  ger_builtin(m, n, x, y, C, ldc);
+}
+
+#ifdef QENGINE_HAS_CBLAS
+#define QENGINE_CBLAS_REAL(T, PREFIX)                                        \
+  inline void gemm(uint64_t m, uint64_t n, uint64_t k,                       \
+                   const T* A, const T* B, T* C) {                           \
+    if (!use_blas(m * n * k, std::max(std::max(m, n), k)))                   \
+      return gemm_builtin(m, n, k, A, B, C);                                 \
+    cblas_##PREFIX##gemm(CblasColMajor, CblasNoTrans, CblasNoTrans,          \
+                         m, n, k, 1, A, m, B, k, 1, C, m);                   \
+  }                                                                          \
+  inline void ger(uint64_t m, uint64_t n, const T* x, const T* y,            \
+                  T* C, uint64_t ldc) {                                      \
+    if (!use_blas(m * n, std::max(m, n)))                                    \
+      return ger_builtin(m, n, x, y, C, ldc);                                \
+    cblas_##PREFIX##ger(CblasColMajor, m, n, 1, x, 1, y, 1, C, ldc);         \
+  }
+
+#define QENGINE_CBLAS_COMPLEX(T, PREFIX)                                     \
+  inline void gemm(uint64_t m, uint64_t n, uint64_t k,                       \
+                   const T* A, const T* B, T* C) {                           \
+    if (!use_blas(m * n * k, std::max(std::max(m, n), k)))                   \
+      return gemm_builtin(m, n, k, A, B, C);                                 \
+    const T one(1);                                                          \
+    cblas_##PREFIX##gemm(CblasColMajor, CblasNoTrans, CblasNoTrans,          \
+                         m, n, k, &one, A, m, B, k, &one, C, m);             \
+  }                                                                          \
+  inline void ger(uint64_t m, uint64_t n, const T* x, const T* y,            \
+                  T* C, uint64_t ldc) {                                      \
+    if (!use_blas(m * n, std::max(m, n)))                                    \
+      return ger_builtin(m, n, x, y, C, ldc);                                \
+    const T one(1);                                                          \
+    cblas_##PREFIX##geru(CblasColMajor, m, n, &one, x, 1, y, 1, C, ldc);     \
+  }
+
+QENGINE_CBLAS_REAL(float, s)
+QENGINE_CBLAS_REAL(double, d)
+QENGINE_CBLAS_COMPLEX(std::complex<float>, c)
+QENGINE_CBLAS_COMPLEX(std::complex<double>, z)
+
+#undef QENGINE_CBLAS_REAL
+#undef QENGINE_CBLAS_COMPLEX
+#endif // QENGINE_HAS_CBLAS
+
+// A <- V, w <- eigenvalues in ascending order for the Hermitian n x n A.
+// Returns non-zero when no LAPACK routine applies or it failed; the caller
+// then falls back to the built-in decomposition.
+template <typename T>
+int heev(uint64_t, std::complex<T>*, T*) { return -1; }
+
+// A = U diag(s) Vt with U m x min(m, n) and Vt min(m, n) x n; A is
+// overwritten. Same return convention as heev.
+template <typename T>
+int gesvd(uint64_t, uint64_t, std::complex<T>*, T*, std::complex<T>*,
+          std::complex<T>*) {
+  return -1;
+}
+
+#ifdef QENGINE_HAS_LAPACK
+#define QENGINE_LAPACK(T, PREFIX)                                            \
+  inline int heev(uint64_t n, std::complex<T>* a, T* w) {                    \
+    if (n == 0 || !fits_int(n))                                              \
+      return -1;                                                             \
+    const int n_ = static_cast<int>(n);                                      \
+    const int query = -1;                                                    \
+    std::complex<T> size;                                                    \
+    std::vector<T> rwork(std::max(1, 3 * n_ - 2));                           \
+    int info = 0;                                                            \
+    PREFIX##heev_("V", "U", &n_, a, &n_, w, &size, &query, rwork.data(),     \
+                  &info);                                                    \
+    const int lwork = static_cast<int>(size.real());                         \
+    std::vector<std::complex<T>> work(lwork);                                \
+    PREFIX##heev_("V", "U", &n_, a, &n_, w, work.data(), &lwork,             \
+                  rwork.data(), &info);                                      \
+    return info;                                                             \
+  }                                                                          \
+  inline int gesvd(uint64_t m, uint64_t n, std::complex<T>* a, T* s,         \
+                   std::complex<T>* u, std::complex<T>* vt) {                \
+    if (m == 0 || n == 0 || !fits_int(std::max(m, n)))                       \
+      return -1;                                                             \
+    const int m_ = static_cast<int>(m);                                      \
+    const int n_ = static_cast<int>(n);                                      \
+    const int k_ = std::min(m_, n_);                                         \
+    const int query = -1;                                                    \
+    std::complex<T> size;                                                    \
+    std::vector<T> rwork(5 * k_);                                            \
+    int info = 0;                                                            \
+    PREFIX##gesvd_("S", "S", &m_, &n_, a, &m_, s, u, &m_, vt, &k_, &size,    \
+                   &query, rwork.data(), &info);                             \
+    const int lwork = static_cast<int>(size.real());                         \
+    std::vector<std::complex<T>> work(lwork);                                \
+    PREFIX##gesvd_("S", "S", &m_, &n_, a, &m_, s, u, &m_, vt, &k_,           \
+                   work.data(), &lwork, rwork.data(), &info);                \
+    return info;                                                             \
+  }
+
+QENGINE_LAPACK(float, c)
+QENGINE_LAPACK(double, z)
+
+#undef QENGINE_LAPACK
+#endif // QENGINE_HAS_LAPACK
+
+} // namespace util
+} // namespace qengine
+
+#endif // QENGINE_UTILS_LINALG_BACKEND_H_
@@ -23,12 +23,14 @@
 #ifndef QENGINE_UTILS_MATH_OPERATIONS_H_
 #define QENGINE_UTILS_MATH_OPERATIONS_H_
 
+#include <cmath>
 #include <complex>
 #include <cstdint>
 #include <vector>
 
 #include <gsl/gsl_assert>
 
+#include "cpu_dispatch.h"
 #include "square_matrix.h"
 
 namespace qengine {
@@ -82,6 +84,68 @@ T probability(std::complex<T> amplitude) {
   return std::real(amplitude * std::conj(amplitude));
 }
 
+// sum_k conj(bra[k]) * ket[k] over [begin, end), see cpu_dispatch.h.
+template <typename T>
+std::complex<T> dot_conj(const std::complex<T>* bra,
+                         const std::complex<T>* ket,
+                         uint64_t begin, uint64_t end) {
+  return kernels<T>().dot_conj(bra + begin, ket + begin, end - begin);
+}
+
+// 2x2 block acting on the levels (i - 1, i), already divided by its norm.
+// C is T for the real rotations of QReg::applyX and std::complex<T> else.
+template <typename C>
+struct Givens {
+  C x_11;
+  C x_12;
+  C x_21;
+  C x_22;
+};
+
+template <typename T>
+Givens<T> givens_X(T x, T y) {
+  const T norm = std::sqrt(x * x + y * y);
+  return {x / norm, -y / norm, y / norm, x / norm};
+}
+
+template <typename T>
+Givens<std::complex<T>> givens_X(std::complex<T> x, std::complex<T> y) {
+  const T norm = std::sqrt(std::norm(x) + std::norm(y));
+  return {x / norm, -y / norm, std::conj(y) / norm, std::conj(x) / norm};
+}
+
+template <typename T>
+Givens<T> givens_Xconjugate(T x, T y) {
+  const T norm = std::sqrt(x * x + y * y);
+  return {x / norm, y / norm, -y / norm, x / norm};
+}
+
+template <typename T>
+Givens<std::complex<T>> givens_Xconjugate(
+    std::complex<T> x, std::complex<T> y) {
+  const T norm = std::sqrt(std::norm(x) + std::norm(y));
+  return {std::conj(x) / norm, y / norm, -std::conj(y) / norm, x / norm};
+}
+
+// Coefficients of G* (elementwise conjugate); G rho G^dagger applies G to the
+// rows and G* to the columns of rho.
+template <typename T>
+Givens<T> conjugate(const Givens<T>& g) { return g; }
+
+template <typename T>
+Givens<std::complex<T>> conjugate(const Givens<std::complex<T>>& g) {
+  return {std::conj(g.x_11), std::conj(g.x_12),
+          std::conj(g.x_21), std::conj(g.x_22)};
+}
+
+template <typename C, typename A>
+void apply_givens(const Givens<C>& g, A& a_i_1, A& a_i) {
+  const A a_1 = a_i_1;
+  const A a_2 = a_i;
+  a_i_1 = g.x_11 * a_1 + g.x_12 * a_2;
+  a_i = g.x_21 * a_1 + g.x_22 * a_2;
+}
+
 } // namespace mo
 } // namespace qengine
 
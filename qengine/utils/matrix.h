@@ -30,9 +30,19 @@
 
 #include <gsl/gsl_assert>
 
+#include "linalg_backend.h"
+
 namespace qengine {
 inline namespace util {
 
+// std::conj promotes a real argument to std::complex, so real matrices
+// would not survive dagger() and conjugate().
+template <typename T>
+T conj_entry(const T& x) { return x; }
+
+template <typename T>
+std::complex<T> conj_entry(const std::complex<T>& x) { return std::conj(x); }
+
 template <typename T>
 class Matrix {
 public:
@@ -43,10 +53,10 @@ public:
   Matrix<T>& operator=(const Matrix<T>&);
   Matrix<T>& operator=(Matrix<T>&&);
 
-  Matrix<T>(uint64_t ncols, uint64_t nrows, const std::vector<T>& vals);
+  Matrix<T>(uint64_t nrows, uint64_t ncols, const std::vector<T>& vals);
   Matrix<T>(
-      uint64_t ncols, uint64_t nrows, const std::initializer_list<T>& vals);
-  Matrix<T>(uint64_t ncols, uint64_t nrows);
+      uint64_t nrows, uint64_t ncols, const std::initializer_list<T>& vals);
+  Matrix<T>(uint64_t nrows, uint64_t ncols);
 
   T& operator()(uint64_t i, uint64_t j);
   T operator()(uint64_t i, uint64_t j) const;
@@ -67,13 +77,14 @@ public:
   uint64_t ncols() const;
   uint64_t nrows() const;
   std::vector<T> vals() const;
+  const T* data() const;
   uint64_t size() const;
 
   template <typename T1>
   friend std::ostream& operator<<(std::ostream& out, const Matrix<T1>& A);
 
   template <typename T1>
-  friend std::istream& operator>>(std::istream& in, const Matrix<T1>& A);
+  friend std::istream& operator>>(std::istream& in, Matrix<T1>& A);
 
   template <typename T1, typename T2>
   friend Matrix<T1> operator*(T2 alpha, const Matrix<T1>& A);
@@ -99,8 +110,8 @@ public:
   friend bool operator!=(const Matrix<T1>& A, const Matrix<T1>& B);
 
 protected:
-  uint64_t ncols_;
   uint64_t nrows_;
+  uint64_t ncols_;
   std::vector<T> vals_;
 };
 
@@ -208,7 +219,10 @@ Matrix<T>& Matrix<T>::operator-=(const Matrix<T>& A) {
 }
 
 template <typename T>
-Matrix<T>& Matrix<T>::operator*=(const Matrix<T>& A) { return *this * A; }
+Matrix<T>& Matrix<T>::operator*=(const Matrix<T>& A) {
+  *this = *this * A;
+  return *this;
+}
 
 template <class T>
 T Matrix<T>::trace() const {
@@ -234,7 +248,7 @@ Matrix<T> Matrix<T>::dagger() const {
   Matrix<T> temp(ncols_, nrows_);
   for (uint64_t i = 0; i < ncols_; ++i)
     for (uint64_t j = 0; j < nrows_; ++j)
-      temp.vals_[i + j * ncols_] = std::conj(vals_[j + i * nrows_]);
+      temp.vals_[i + j * ncols_] = conj_entry(vals_[j + i * nrows_]);
   return temp;
 }
 
@@ -243,21 +257,20 @@ Matrix<T> Matrix<T>::conjugate() const {
   Matrix<T> temp(nrows_, ncols_);
   for (uint64_t i = 0; i < nrows_; ++i)
     for (uint64_t j = 0; j < ncols_; ++j)
-      temp.vals_[i + j * nrows_] = std::conj(vals_[i + j * nrows_]);
+      temp.vals_[i + j * nrows_] = conj_entry(vals_[i + j * nrows_]);
   return temp;
 }
 
 template <class T>
 Matrix<T> Matrix<T>::tensor_times(const Matrix<T> & A) const {
   Matrix<T> C(nrows_ * A.nrows_, ncols_ * A.ncols_);
-  for (uint64_t q = 0; q < A.ncols_; ++q)
-    for (uint64_t j = 0; j < ncols_; ++j)
-      for (uint64_t i = 0; i < nrows_; ++i)
-        for (uint64_t p = 0; p < A.nrows_; ++p) {
-          uint64_t n = i * A.nrows_ + p;
-          uint64_t m = j * A.ncols_ + q;
-          C(n, m) = vals_[i + j * nrows_] * A(p, q);
-        }
+  // column j * A.ncols_ + q of C, seen as an A.nrows_ x nrows_ block, is the
+  // outer product of column q of A and column j of this
+  for (uint64_t j = 0; j < ncols_; ++j)
+    for (uint64_t q = 0; q < A.ncols_; ++q)
+      ger(A.nrows_, nrows_, A.vals_.data() + q * A.nrows_,
+          vals_.data() + j * nrows_,
+          C.vals_.data() + (j * A.ncols_ + q) * C.nrows_, A.nrows_);
   return C;
 }
 
@@ -270,6 +283,9 @@ uint64_t Matrix<T>::nrows() const { return nrows_; }
 template <typename T>
 std::vector<T> Matrix<T>::vals() const { return vals_; }
 
+template <typename T>
+const T* Matrix<T>::data() const { return vals_.data(); }
+
 template <typename T>
 uint64_t Matrix<T>::size() const {
   return static_cast<uint64_t>(vals_.size());
@@ -286,7 +302,7 @@ std::ostream& operator<<(std::ostream& out, const Matrix<T1>& A) {
 }
 
 template <typename T>
-std::istream& operator>>(std::istream& in, const Matrix<T>& A) {
+std::istream& operator>>(std::istream& in, Matrix<T>& A) {
   for (uint64_t j = 0; j < A.ncols_; ++j)
     for (uint64_t i = 0; i < A.nrows_; ++i)
       in >> A.vals_[i + j * A.nrows_];
@@ -333,11 +349,8 @@ Matrix<T1> operator*(const Matrix<T1>& A, const Matrix<T1>& B) {
 
   Matrix<T1> C(A.nrows_, B.ncols_);
   // column-major order: A(i, j) = A.val[i + j * nrows_]
-  for(uint64_t j = 0; j < B.ncols_; ++j)
-    for(uint64_t k = 0; k < A.ncols_; ++k)
-      for(uint64_t i = 0; i < A.nrows_; ++i)
-        C(i, j) += A(i, k) * B(k, j);
-
+  gemm(A.nrows_, B.ncols_, A.ncols_,
+       A.vals_.data(), B.vals_.data(), C.vals_.data());
   return C;
 }
 
@@ -351,9 +364,36 @@ bool operator==(const Matrix<T1>& A, const Matrix<T1>& B) {
 
 template <typename T1>
 bool operator!=(const Matrix<T1>& A, const Matrix<T1>& B) {
-  return !(A.vals_ == B.vals_);
+  return !(A == B);
 }
 
+// The free operators for one entry type, e.g. the product kernel, which
+// the class instantiation does not cover; src/matrix.cpp expands this
+// with an empty EXTERN.
+#define QENGINE_MATRIX_OPERATORS(EXTERN, T)                                  \
+  EXTERN template Matrix<T> operator*(T, const Matrix<T>&);                  \
+  EXTERN template Matrix<T> operator*(const Matrix<T>&, T);                  \
+  EXTERN template std::vector<T> operator*(const Matrix<T>&,                 \
+                                           const std::vector<T>&);           \
+  EXTERN template std::vector<T> operator*(const std::vector<T>&,            \
+                                           const Matrix<T>&);                \
+  EXTERN template Matrix<T> operator*(const Matrix<T>&, const Matrix<T>&);   \
+  EXTERN template bool operator==(const Matrix<T>&, const Matrix<T>&);       \
+  EXTERN template bool operator!=(const Matrix<T>&, const Matrix<T>&);
+
+#ifdef QENGINE_EXTERN_TEMPLATES
+// instantiated once in the compiled library, see src/matrix.cpp
+extern template class Matrix<float>;
+extern template class Matrix<double>;
+extern template class Matrix<std::complex<float>>;
+extern template class Matrix<std::complex<double>>;
+
+QENGINE_MATRIX_OPERATORS(extern, float)
+QENGINE_MATRIX_OPERATORS(extern, double)
+QENGINE_MATRIX_OPERATORS(extern, std::complex<float>)
+QENGINE_MATRIX_OPERATORS(extern, std::complex<double>)
+#endif
+
 } // namespace util
 } // namespace qengine
 
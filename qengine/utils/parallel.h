@@ -0,0 +1,346 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_UTILS_PARALLEL_H_
+#define QENGINE_UTILS_PARALLEL_H_
+
+#if defined(__linux__)
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <sched.h>
+#define QENGINE_HAS_AFFINITY 1
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#define QENGINE_HAS_ATFORK 1
+#endif
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace qengine {
+inline namespace util {
+
+// Registers smaller than this are processed by the calling thread.
+constexpr uint64_t kParallelThreshold = 1 << 15;
+
+// Allocator that leaves default-constructed trivially destructible elements
+// untouched, so the pages of a new buffer are first written (and therefore
+// placed on a NUMA node) by whichever thread initializes them.
+template <typename U>
+class FirstTouchAllocator : public std::allocator<U> {
+public:
+  template <typename V>
+  struct rebind { using other = FirstTouchAllocator<V>; };
+
+  FirstTouchAllocator() = default;
+  template <typename V>
+  FirstTouchAllocator(const FirstTouchAllocator<V>&) noexcept {}
+
+  template <typename V>
+  void construct(V* p) {
+    construct(p, std::is_trivially_destructible<V>());
+  }
+
+  template <typename V, typename... Args>
+  void construct(V* p, Args&&... args) {
+    ::new (static_cast<void*>(p)) V(std::forward<Args>(args)...);
+  }
+
+private:
+  template <typename V>
+  void construct(V*, std::true_type) {}
+
+  template <typename V>
+  void construct(V* p, std::false_type) { ::new (static_cast<void*>(p)) V; }
+};
+
+template <typename U, typename V>
+bool operator==(const FirstTouchAllocator<U>&, const FirstTouchAllocator<V>&) {
+  return true;
+}
+
+template <typename U, typename V>
+bool operator!=(const FirstTouchAllocator<U>&, const FirstTouchAllocator<V>&) {
+  return false;
+}
+
+template <typename U>
+using NumaVec = std::vector<U, FirstTouchAllocator<U>>;
+
+// Fixed set of workers with a static partition: for a given length, worker
+// `tid` always receives the same slice. Buffers initialized through the pool
+// are therefore first-touched by the thread that later processes them, and
+// with pinning that thread never migrates to another socket.
+class ThreadPool {
+public:
+  using Job = std::function<void(uint64_t tid, uint64_t begin, uint64_t end)>;
+
+  ThreadPool() = delete;
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool(ThreadPool&&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ThreadPool& operator=(ThreadPool&&) = delete;
+
+  explicit ThreadPool(uint64_t nthreads, bool pin = true);
+
+  uint64_t nthreads() const { return nthreads_; }
+  bool pinned() const { return pinned_; }
+
+  // Runs `job` over [0, n) split into nthreads() slices. Calls from a worker,
+  // while another thread owns the pool, or in a child forked after the pool
+  // was created (which has none of its workers) run the same slices inline,
+  // so a reduction over them adds in the same order either way.
+  void run(uint64_t n, const Job& job);
+
+  static std::pair<uint64_t, uint64_t> slice(
+      uint64_t n, uint64_t tid, uint64_t nthreads);
+
+  // Process-wide pool sized by QENGINE_NUM_THREADS (default: all cores);
+  // QENGINE_PIN_THREADS=0 disables pinning.
+  static ThreadPool& global();
+
+private:
+  void work(uint64_t tid);
+  void run_inline(uint64_t n, const Job& job) const;
+  bool orphaned() const { return epoch_ != fork_epoch(); }
+  static bool pin(uint64_t tid);
+  static bool& in_worker();
+  // Number of forks this process descends from.
+  static uint64_t& fork_epoch();
+
+  uint64_t nthreads_;
+  bool pinned_;
+  uint64_t epoch_;
+  std::vector<std::thread> workers_;
+
+  std::mutex busy_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  const Job* job_ = nullptr;
+  uint64_t n_ = 0;
+  uint64_t generation_ = 0;
+  uint64_t pending_ = 0;
+  bool stop_ = false;
+};
+
+inline ThreadPool::ThreadPool(uint64_t nthreads, bool pin)
+  : nthreads_{nthreads > 0 ? nthreads : 1}, pinned_{pin},
+    epoch_{fork_epoch()} {
+  std::vector<char> pinned(nthreads_, 0);
+  std::mutex pin_mutex;
+  for (uint64_t tid = 0; tid < nthreads_; ++tid)
+    workers_.emplace_back([this, tid, pin, &pinned, &pin_mutex] {
+      in_worker() = true;
+      if (pin) {
+        const bool ok = ThreadPool::pin(tid);
+        std::lock_guard<std::mutex> lock(pin_mutex);
+        pinned[tid] = ok;
+      }
+      work(tid);
+    });
+  if (pin) {
+    // Wait for every worker to report so pinned() is meaningful.
+    run(nthreads_, [](uint64_t, uint64_t, uint64_t) {});
+    std::lock_guard<std::mutex> lock(pin_mutex);
+    for (const auto ok : pinned)
+      pinned_ = pinned_ && ok;
+  }
+}
+
+inline ThreadPool::~ThreadPool() {
+  if (orphaned()) {
+    // the threads belong to the parent; they can be neither joined nor
+    // detached here
+    new std::vector<std::thread>(std::move(workers_));
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  start_.notify_all();
+  for (auto & worker : workers_)
+    worker.join();
+}
+
+inline void ThreadPool::run(uint64_t n, const Job& job) {
+  if (n == 0)
+    return;
+  if (orphaned() || in_worker()) {
+    run_inline(n, job);
+    return;
+  }
+  std::unique_lock<std::mutex> busy(busy_, std::try_to_lock);
+  if (!busy.owns_lock()) {
+    run_inline(n, job);
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  job_ = &job;
+  n_ = n;
+  pending_ = nthreads_;
+  ++generation_;
+  start_.notify_all();
+  done_.wait(lock, [this] { return pending_ == 0; });
+  job_ = nullptr;
+}
+
+inline void ThreadPool::run_inline(uint64_t n, const Job& job) const {
+  for (uint64_t tid = 0; tid < nthreads_; ++tid) {
+    const auto range = slice(n, tid, nthreads_);
+    if (range.first < range.second)
+      job(tid, range.first, range.second);
+  }
+}
+
+inline std::pair<uint64_t, uint64_t> ThreadPool::slice(
+    uint64_t n, uint64_t tid, uint64_t nthreads) {
+  return {n * tid / nthreads, n * (tid + 1) / nthreads};
+}
+
+inline ThreadPool& ThreadPool::global() {
+  static ThreadPool pool([] {
+    const char* env = std::getenv("QENGINE_NUM_THREADS");
+    const uint64_t n = env != nullptr ? std::strtoull(env, nullptr, 10) : 0;
+    return n > 0 ? n : std::max(1u, std::thread::hardware_concurrency());
+  }(), [] {
+    const char* env = std::getenv("QENGINE_PIN_THREADS");
+    return env == nullptr || std::atoi(env) != 0;
+  }());
+  return pool;
+}
+
+inline void ThreadPool::work(uint64_t tid) {
+  uint64_t seen = 0;
+  for (;;) {
+    const Job* job;
+    uint64_t n;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_.wait(lock, [this, seen] { return stop_ || generation_ != seen; });
+      if (stop_)
+        return;
+      seen = generation_;
+      job = job_;
+      n = n_;
+    }
+
+    const auto range = slice(n, tid, nthreads_);
+    if (range.first < range.second)
+      (*job)(tid, range.first, range.second);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--pending_ == 0)
+      done_.notify_one();
+  }
+}
+
+inline bool ThreadPool::pin(uint64_t tid) {
+#ifdef QENGINE_HAS_AFFINITY
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    return false;
+  std::vector<int> cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    if (CPU_ISSET(cpu, &allowed))
+      cpus.push_back(cpu);
+  if (cpus.empty())
+    return false;
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpus[tid % cpus.size()], &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  (void)tid;
+  return false;
+#endif
+}
+
+inline bool& ThreadPool::in_worker() {
+  static thread_local bool flag = false;
+  return flag;
+}
+
+// Only the single thread of a freshly forked child writes the counter.
+inline uint64_t& ThreadPool::fork_epoch() {
+  static uint64_t epoch = 0;
+#ifdef QENGINE_HAS_ATFORK
+  static const bool registered =
+      pthread_atfork(nullptr, nullptr, [] { ++fork_epoch(); }) == 0;
+  (void)registered;
+#endif
+  return epoch;
+}
+
+// Runs fn(begin, end) over [0, n) on the global pool, or inline when n is
+// below `threshold`.
+template <typename F>
+void parallel_for(uint64_t n, F&& fn, uint64_t threshold = kParallelThreshold) {
+  if (n < threshold) {
+    fn(uint64_t{0}, n);
+    return;
+  }
+  ThreadPool::global().run(n, [&fn](uint64_t, uint64_t begin, uint64_t end) {
+    fn(begin, end);
+  });
+}
+
+// Sums fn(begin, end) over the slices of [0, n); partial results are added
+// in slice order and the slices are the same when run() falls back to the
+// calling thread, so the result does not depend on scheduling.
+template <typename U, typename F>
+U parallel_sum(uint64_t n, F&& fn, uint64_t threshold = kParallelThreshold) {
+  if (n < threshold)
+    return fn(uint64_t{0}, n);
+  ThreadPool& pool = ThreadPool::global();
+  std::vector<U> partial(pool.nthreads(), U(0));
+  pool.run(n, [&fn, &partial](uint64_t tid, uint64_t begin, uint64_t end) {
+    partial[tid] = fn(begin, end);
+  });
+  U res(0);
+  for (const auto & p : partial)
+    res += p;
+  return res;
+}
+
+} // namespace util
+} // namespace qengine
+
+#endif // QENGINE_UTILS_PARALLEL_H_
@@ -0,0 +1,232 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_UTILS_PROFILER_H_
+#define QENGINE_UTILS_PROFILER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace qengine {
+inline namespace util {
+
+struct GateStats {
+  const char* name;
+  uint64_t calls;
+  uint64_t nanoseconds;
+  uint64_t bytes;
+  uint64_t flops;
+
+  double seconds() const { return nanoseconds * 1e-9; }
+  double gbytes_per_second() const {
+    return nanoseconds > 0 ? static_cast<double>(bytes) / nanoseconds : 0.0;
+  }
+  double gflops() const {
+    return nanoseconds > 0 ? static_cast<double>(flops) / nanoseconds : 0.0;
+  }
+};
+
+struct TraceEvent {
+  const char* name;
+  uint64_t idx_qreg;
+  uint64_t start_ns;
+  uint64_t duration_ns;
+};
+
+// Per-gate-kind counters. Gate names are expected to be string literals and
+// are compared by address first, so recording does not allocate.
+class Profiler {
+public:
+  ~Profiler() = default;
+  Profiler(const Profiler&) = delete;
+  Profiler(Profiler&&) = delete;
+  Profiler& operator=(const Profiler&) = delete;
+  Profiler& operator=(Profiler&&) = delete;
+
+  Profiler() : enabled_{true}, trace_{false}, max_events_{0},
+               origin_ns_{now_ns()} {}
+
+  static uint64_t now_ns() {
+    return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+
+  // May be toggled while gates run on other threads.
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+  void enable(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+
+  void enable_trace(bool trace, uint64_t max_events = 1 << 20) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    trace_ = trace;
+    max_events_ = max_events;
+  }
+
+  void record(const char* name, uint64_t idx_qreg, uint64_t start_ns,
+              uint64_t duration_ns, uint64_t bytes, uint64_t flops) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    GateStats& gate = find(name);
+    ++gate.calls;
+    gate.nanoseconds += duration_ns;
+    gate.bytes += bytes;
+    gate.flops += flops;
+    if (trace_ && events_.size() < max_events_)
+      events_.push_back({name, idx_qreg, start_ns, duration_ns});
+  }
+
+  std::vector<GateStats> stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+  GateStats stats(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto & gate : stats_)
+      if (name == gate.name)
+        return gate;
+    return GateStats{nullptr, 0, 0, 0, 0};
+  }
+
+  std::vector<TraceEvent> events() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return events_;
+  }
+
+  void reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.clear();
+    events_.clear();
+    origin_ns_ = now_ns();
+  }
+
+  void report(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << std::left << std::setw(18) << "gate"
+        << std::right << std::setw(12) << "calls"
+        << std::setw(14) << "total ms"
+        << std::setw(12) << "avg ns"
+        << std::setw(10) << "GB/s"
+        << std::setw(10) << "GFLOP/s" << "\n";
+    for (const auto & gate : stats_)
+      out << std::left << std::setw(18) << gate.name
+          << std::right << std::setw(12) << gate.calls
+          << std::setw(14) << std::fixed << std::setprecision(3)
+          << gate.nanoseconds * 1e-6
+          << std::setw(12) << std::setprecision(1)
+          << static_cast<double>(gate.nanoseconds) / gate.calls
+          << std::setw(10) << std::setprecision(2) << gate.gbytes_per_second()
+          << std::setw(10) << gate.gflops() << "\n";
+    out.flags(flags);
+    out.precision(precision);
+  }
+
+  // Chrome trace event format, loadable in chrome://tracing or Perfetto.
+  // Every register is shown as its own thread.
+  void chrome_trace(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for (uint64_t k = 0; k < events_.size(); ++k) {
+      const auto & e = events_[k];
+      out << (k == 0 ? "" : ",") << "\n{\"name\":\"" << e.name
+          << "\",\"cat\":\"qengine\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+          << e.idx_qreg << std::fixed << std::setprecision(3)
+          << ",\"ts\":" << (e.start_ns - origin_ns_) * 1e-3
+          << ",\"dur\":" << e.duration_ns * 1e-3 << "}";
+    }
+    out << "\n]}\n";
+    out.flags(flags);
+    out.precision(precision);
+  }
+
+private:
+  GateStats& find(const char* name) {
+    for (auto & gate : stats_)
+      if (gate.name == name || std::strcmp(gate.name, name) == 0)
+        return gate;
+    stats_.push_back({name, 0, 0, 0, 0});
+    return stats_.back();
+  }
+
+  std::atomic<bool> enabled_;
+  bool trace_;
+  uint64_t max_events_;
+  uint64_t origin_ns_;
+  std::vector<GateStats> stats_;
+  std::vector<TraceEvent> events_;
+  mutable std::mutex mutex_;
+};
+
+class ProfileScope {
+public:
+  ProfileScope() = delete;
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope(ProfileScope&&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+  ProfileScope& operator=(ProfileScope&&) = delete;
+
+  ProfileScope(Profiler& profiler, const char* name, uint64_t idx_qreg,
+               uint64_t bytes, uint64_t flops)
+    : profiler_(profiler), name_{name}, idx_qreg_{idx_qreg},
+      bytes_{bytes}, flops_{flops}, enabled_{profiler.enabled()},
+      start_ns_{enabled_ ? Profiler::now_ns() : 0} {}
+
+  ~ProfileScope() {
+    if (enabled_)
+      profiler_.record(name_, idx_qreg_, start_ns_,
+                       Profiler::now_ns() - start_ns_, bytes_, flops_);
+  }
+
+private:
+  Profiler& profiler_;
+  const char* name_;
+  uint64_t idx_qreg_;
+  uint64_t bytes_;
+  uint64_t flops_;
+  bool enabled_;
+  uint64_t start_ns_;
+};
+
+} // namespace util
+} // namespace qengine
+
+#ifdef QENGINE_PROFILING
+#define QENGINE_PROFILE(profiler, name, idx_qreg, bytes, flops) \
+  ::qengine::ProfileScope qengine_profile_scope_( \
+      profiler, name, idx_qreg, bytes, flops)
+#else
+#define QENGINE_PROFILE(profiler, name, idx_qreg, bytes, flops)
+#endif
+
+#endif // QENGINE_UTILS_PROFILER_H_
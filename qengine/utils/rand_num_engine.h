@@ -24,6 +24,8 @@
 #define QENGINE_UTILS_RAND_NUM_ENGINE_H_
 
 #include <random>
+#include <sstream>
+#include <string>
 
 namespace qengine {
 inline namespace util {
@@ -40,6 +42,17 @@ public:
 
   std::mt19937& mte() { return mt_; }
 
+  std::string state() const {
+    std::ostringstream out;
+    out << mt_;
+    return out.str();
+  }
+
+  void set_state(const std::string& state) {
+    std::istringstream in(state);
+    in >> mt_;
+  }
+
 private:
   std::mt19937 mt_;
 };
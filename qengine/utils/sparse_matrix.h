@@ -0,0 +1,213 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_UTILS_SPARSE_MATRIX_H_
+#define QENGINE_UTILS_SPARSE_MATRIX_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include <gsl/gsl_assert>
+
+#include "matrix.h"
+
+namespace qengine {
+inline namespace util {
+
+// Compressed sparse row matrix: the non-zeros of row i are
+// vals_[row_ptr_[i] .. row_ptr_[i + 1]) in columns col_idx_[...].
+template <typename T>
+class SparseMatrix {
+public:
+  using Triplet = std::tuple<uint64_t, uint64_t, T>;
+
+  SparseMatrix<T>();
+  ~SparseMatrix<T>();
+  SparseMatrix<T>(const SparseMatrix<T>&);
+  SparseMatrix<T>(SparseMatrix<T>&&);
+  SparseMatrix<T>& operator=(const SparseMatrix<T>&);
+  SparseMatrix<T>& operator=(SparseMatrix<T>&&);
+
+  SparseMatrix<T>(uint64_t nrows, uint64_t ncols);
+  // Duplicate (i, j) entries are summed.
+  SparseMatrix<T>(
+      uint64_t nrows, uint64_t ncols, std::vector<Triplet> triplets);
+  explicit SparseMatrix<T>(const Matrix<T>& A);
+
+  T operator()(uint64_t i, uint64_t j) const;
+
+  uint64_t nrows() const;
+  uint64_t ncols() const;
+  uint64_t nnz() const;
+  const std::vector<uint64_t>& row_ptr() const;
+  const std::vector<uint64_t>& col_idx() const;
+  const std::vector<T>& vals() const;
+
+  Matrix<T> to_dense() const;
+
+  // y[i] = sum_j A(i, j) x[j] for rows [begin, end).
+  template <typename U>
+  void multiply(const U* x, U* y, uint64_t begin, uint64_t end) const;
+
+  template <typename T1, typename T2>
+  friend std::vector<T2> operator*(
+      const SparseMatrix<T1>& A, const std::vector<T2>& x);
+
+private:
+  uint64_t nrows_;
+  uint64_t ncols_;
+  std::vector<uint64_t> row_ptr_;
+  std::vector<uint64_t> col_idx_;
+  std::vector<T> vals_;
+};
+
+template <typename T>
+SparseMatrix<T>::SparseMatrix() : SparseMatrix<T>(0, 0) {}
+
+template <typename T>
+SparseMatrix<T>::~SparseMatrix() = default;
+
+template <typename T>
+SparseMatrix<T>::SparseMatrix(const SparseMatrix<T>&) = default;
+
+template <typename T>
+SparseMatrix<T>::SparseMatrix(SparseMatrix<T>&&) = default;
+
+template <typename T>
+SparseMatrix<T>& SparseMatrix<T>::operator=(const SparseMatrix<T>&) = default;
+
+template <typename T>
+SparseMatrix<T>& SparseMatrix<T>::operator=(SparseMatrix<T>&&) = default;
+
+template <typename T>
+SparseMatrix<T>::SparseMatrix(uint64_t nrows, uint64_t ncols)
+  : nrows_{nrows}, ncols_{ncols}, row_ptr_(nrows + 1, 0) {}
+
+template <typename T>
+SparseMatrix<T>::SparseMatrix(
+    uint64_t nrows, uint64_t ncols, std::vector<Triplet> triplets)
+  : SparseMatrix<T>(nrows, ncols) {
+  std::sort(triplets.begin(), triplets.end(),
+            [](const Triplet& a, const Triplet& b) {
+              return std::make_pair(std::get<0>(a), std::get<1>(a))
+                     < std::make_pair(std::get<0>(b), std::get<1>(b));
+            });
+
+  for (uint64_t k = 0; k < triplets.size(); ++k) {
+    const uint64_t i = std::get<0>(triplets[k]);
+    const uint64_t j = std::get<1>(triplets[k]);
+    Expects(i < nrows_ && j < ncols_);
+    if (k > 0 && std::get<0>(triplets[k - 1]) == i
+        && std::get<1>(triplets[k - 1]) == j) {
+      vals_.back() += std::get<2>(triplets[k]);
+      continue;
+    }
+    col_idx_.push_back(j);
+    vals_.push_back(std::get<2>(triplets[k]));
+    ++row_ptr_[i + 1];
+  }
+  for (uint64_t i = 1; i <= nrows_; ++i)
+    row_ptr_[i] += row_ptr_[i - 1];
+}
+
+template <typename T>
+SparseMatrix<T>::SparseMatrix(const Matrix<T>& A)
+  : SparseMatrix<T>(A.nrows(), A.ncols()) {
+  for (uint64_t i = 0; i < nrows_; ++i) {
+    for (uint64_t j = 0; j < ncols_; ++j) {
+      if (A(i, j) != T(0)) {
+        col_idx_.push_back(j);
+        vals_.push_back(A(i, j));
+      }
+    }
+    row_ptr_[i + 1] = col_idx_.size();
+  }
+}
+
+template <typename T>
+T SparseMatrix<T>::operator()(uint64_t i, uint64_t j) const {
+  Expects(i < nrows_ && j < ncols_);
+  const auto first = col_idx_.begin() + row_ptr_[i];
+  const auto last = col_idx_.begin() + row_ptr_[i + 1];
+  const auto it = std::lower_bound(first, last, j);
+  return it != last && *it == j ? vals_[it - col_idx_.begin()] : T(0);
+}
+
+template <typename T>
+uint64_t SparseMatrix<T>::nrows() const { return nrows_; }
+
+template <typename T>
+uint64_t SparseMatrix<T>::ncols() const { return ncols_; }
+
+template <typename T>
+uint64_t SparseMatrix<T>::nnz() const { return vals_.size(); }
+
+template <typename T>
+const std::vector<uint64_t>& SparseMatrix<T>::row_ptr() const {
+  return row_ptr_;
+}
+
+template <typename T>
+const std::vector<uint64_t>& SparseMatrix<T>::col_idx() const {
+  return col_idx_;
+}
+
+template <typename T>
+const std::vector<T>& SparseMatrix<T>::vals() const { return vals_; }
+
+template <typename T>
+Matrix<T> SparseMatrix<T>::to_dense() const {
+  Matrix<T> res(nrows_, ncols_);
+  for (uint64_t i = 0; i < nrows_; ++i)
+    for (uint64_t k = row_ptr_[i]; k < row_ptr_[i + 1]; ++k)
+      res(i, col_idx_[k]) = vals_[k];
+  return res;
+}
+
+template <typename T>
+template <typename U>
+void SparseMatrix<T>::multiply(
+    const U* x, U* y, uint64_t begin, uint64_t end) const {
+  for (uint64_t i = begin; i < end; ++i) {
+    U sum(0);
+    for (uint64_t k = row_ptr_[i]; k < row_ptr_[i + 1]; ++k)
+      sum += vals_[k] * x[col_idx_[k]];
+    y[i] = sum;
+  }
+}
+
+template <typename T1, typename T2>
+std::vector<T2> operator*(
+    const SparseMatrix<T1>& A, const std::vector<T2>& x) {
+  Expects(A.ncols_ == x.size());
+
+  std::vector<T2> res(A.nrows_);
+  A.multiply(x.data(), res.data(), 0, A.nrows_);
+  return res;
+}
+
+} // namespace util
+} // namespace qengine
+
+#endif // QENGINE_UTILS_SPARSE_MATRIX_H_
@@ -23,6 +23,7 @@
 #ifndef QENGINE_UTILS_SQUARE_MATRIX_H_
 #define QENGINE_UTILS_SQUARE_MATRIX_H_
 
+#include <complex>
 #include <cstdint>
 #include <initializer_list>
 #include <vector>
@@ -77,6 +78,13 @@ template <typename T>
 SquareMatrix<T>::SquareMatrix(uint64_t n, const std::initializer_list<T>& vals)
   : Matrix<T>(n, n, vals) {}
 
+#ifdef QENGINE_EXTERN_TEMPLATES
+extern template class SquareMatrix<float>;
+extern template class SquareMatrix<double>;
+extern template class SquareMatrix<std::complex<float>>;
+extern template class SquareMatrix<std::complex<double>>;
+#endif
+
 } // namespace util
 } // namespace qengine
 
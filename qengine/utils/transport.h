@@ -0,0 +1,293 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_UTILS_TRANSPORT_H_
+#define QENGINE_UTILS_TRANSPORT_H_
+
+#if defined(__unix__) || defined(__APPLE__)
+#define QENGINE_HAS_FORK 1
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gsl/gsl_assert>
+
+namespace qengine {
+inline namespace util {
+
+// Point-to-point byte transport between the ranks of a distributed register,
+// a minimal stand-in for MPI. Collectives are built on send/recv through
+// rank 0, which is enough for the scalar reductions the kernels need.
+class Transport {
+public:
+  virtual ~Transport() = default;
+
+  virtual uint64_t rank() const = 0;
+  virtual uint64_t nranks() const = 0;
+  virtual void send(uint64_t peer, const void* data, uint64_t bytes) = 0;
+  virtual void recv(uint64_t peer, void* data, uint64_t bytes) = 0;
+
+  // Lower rank sends first, so blocking transports cannot deadlock.
+  void sendrecv(uint64_t peer, const void* out, void* in, uint64_t bytes) {
+    if (rank() < peer) {
+      send(peer, out, bytes);
+      recv(peer, in, bytes);
+    } else {
+      recv(peer, in, bytes);
+      send(peer, out, bytes);
+    }
+  }
+
+  // Every rank contributes `bytes` bytes; `out` receives nranks * bytes in
+  // rank order on all ranks.
+  void allgather(const void* data, void* out, uint64_t bytes) {
+    char* res = static_cast<char*>(out);
+    if (rank() == 0) {
+      std::memcpy(res, data, bytes);
+      for (uint64_t r = 1; r < nranks(); ++r)
+        recv(r, res + r * bytes, bytes);
+      for (uint64_t r = 1; r < nranks(); ++r)
+        send(r, res, nranks() * bytes);
+    } else {
+      send(0, data, bytes);
+      recv(0, res, nranks() * bytes);
+    }
+  }
+
+  template <typename U>
+  std::vector<U> allgather(const U& value) {
+    std::vector<U> res(nranks());
+    allgather(&value, res.data(), sizeof(U));
+    return res;
+  }
+
+  template <typename U>
+  U allreduce_sum(const U& value) {
+    U res{};
+    for (const auto & v : allgather(value))
+      res += v;
+    return res;
+  }
+
+  void barrier() { allgather(static_cast<uint8_t>(0)); }
+};
+
+// Ranks are threads of one process exchanging messages through shared
+// memory mailboxes.
+class ThreadTransport : public Transport {
+public:
+  class World {
+  public:
+    explicit World(uint64_t nranks)
+      : nranks_{nranks}, boxes_(nranks * nranks) {
+      for (auto & box : boxes_)
+        box.reset(new Mailbox());
+    }
+
+    uint64_t nranks() const { return nranks_; }
+
+  private:
+    friend class ThreadTransport;
+
+    struct Mailbox {
+      std::mutex mutex;
+      std::condition_variable ready;
+      std::deque<std::vector<char>> messages;
+    };
+
+    Mailbox& box(uint64_t src, uint64_t dst) {
+      return *boxes_[src * nranks_ + dst];
+    }
+
+    uint64_t nranks_;
+    std::vector<std::unique_ptr<Mailbox>> boxes_;
+  };
+
+  ThreadTransport(World& world, uint64_t rank)
+    : world_(world), rank_{rank} {
+    Expects(rank < world.nranks());
+  }
+
+  uint64_t rank() const override { return rank_; }
+  uint64_t nranks() const override { return world_.nranks(); }
+
+  void send(uint64_t peer, const void* data, uint64_t bytes) override {
+    auto & box = world_.box(rank_, peer);
+    const char* first = static_cast<const char*>(data);
+    {
+      std::lock_guard<std::mutex> lock(box.mutex);
+      box.messages.emplace_back(first, first + bytes);
+    }
+    box.ready.notify_one();
+  }
+
+  void recv(uint64_t peer, void* data, uint64_t bytes) override {
+    auto & box = world_.box(peer, rank_);
+    std::unique_lock<std::mutex> lock(box.mutex);
+    box.ready.wait(lock, [&box]() { return !box.messages.empty(); });
+    Expects(box.messages.front().size() == bytes);
+    std::memcpy(data, box.messages.front().data(), bytes);
+    box.messages.pop_front();
+  }
+
+  // Runs fn on nranks threads, one ThreadTransport each.
+  static void run(uint64_t nranks, const std::function<void(Transport&)>& fn) {
+    World world(nranks);
+    std::vector<std::thread> threads;
+    for (uint64_t r = 1; r < nranks; ++r)
+      threads.emplace_back([&world, &fn, r]() {
+        ThreadTransport transport(world, r);
+        fn(transport);
+      });
+    ThreadTransport transport(world, 0);
+    fn(transport);
+    for (auto & thread : threads)
+      thread.join();
+  }
+
+private:
+  World& world_;
+  uint64_t rank_;
+};
+
+#ifdef QENGINE_HAS_FORK
+// Ranks are processes connected pairwise by Unix domain sockets.
+class SocketTransport : public Transport {
+public:
+  SocketTransport(uint64_t rank, std::vector<int> fds)
+    : rank_{rank}, fds_(std::move(fds)) {}
+
+  ~SocketTransport() override {
+    for (const auto & fd : fds_)
+      if (fd >= 0)
+        ::close(fd);
+  }
+
+  SocketTransport(const SocketTransport&) = delete;
+  SocketTransport& operator=(const SocketTransport&) = delete;
+
+  uint64_t rank() const override { return rank_; }
+  uint64_t nranks() const override { return fds_.size(); }
+
+  void send(uint64_t peer, const void* data, uint64_t bytes) override {
+    const char* first = static_cast<const char*>(data);
+    while (bytes > 0) {
+      const ssize_t n = ::write(fds_[peer], first, bytes);
+      if (n <= 0)
+        throw std::runtime_error("qengine: socket transport send failed");
+      first += n;
+      bytes -= static_cast<uint64_t>(n);
+    }
+  }
+
+  void recv(uint64_t peer, void* data, uint64_t bytes) override {
+    char* first = static_cast<char*>(data);
+    while (bytes > 0) {
+      const ssize_t n = ::read(fds_[peer], first, bytes);
+      if (n <= 0)
+        throw std::runtime_error("qengine: socket transport recv failed");
+      first += n;
+      bytes -= static_cast<uint64_t>(n);
+    }
+  }
+
+  // Forks nranks - 1 children; the caller becomes rank 0. Children exit
+  // with 0 if fn returns normally. Returns true if every rank succeeded.
+  static bool fork_run(uint64_t nranks,
+                       const std::function<void(Transport&)>& fn) {
+    std::vector<std::vector<int>> fds(nranks, std::vector<int>(nranks, -1));
+    for (uint64_t a = 0; a < nranks; ++a)
+      for (uint64_t b = a + 1; b < nranks; ++b) {
+        int pair[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0)
+          throw std::runtime_error("qengine: socketpair failed");
+        fds[a][b] = pair[0];
+        fds[b][a] = pair[1];
+      }
+
+    std::vector<pid_t> children;
+    for (uint64_t r = 1; r < nranks; ++r) {
+      const pid_t pid = ::fork();
+      if (pid < 0)
+        throw std::runtime_error("qengine: fork failed");
+      if (pid == 0) {
+        close_others(fds, r);
+        int status = 0;
+        try {
+          SocketTransport transport(r, fds[r]);
+          fn(transport);
+        } catch (...) {
+          status = 1;
+        }
+        ::_exit(status);
+      }
+      children.push_back(pid);
+    }
+
+    close_others(fds, 0);
+    bool ok = true;
+    try {
+      SocketTransport transport(0, fds[0]);
+      fn(transport);
+    } catch (...) {
+      ok = false;
+    }
+    for (const auto & pid : children) {
+      int status = 0;
+      ::waitpid(pid, &status, 0);
+      ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    return ok;
+  }
+
+private:
+  static void close_others(const std::vector<std::vector<int>>& fds,
+                           uint64_t rank) {
+    for (uint64_t r = 0; r < fds.size(); ++r)
+      if (r != rank)
+        for (const auto & fd : fds[r])
+          if (fd >= 0)
+            ::close(fd);
+  }
+
+  uint64_t rank_;
+  std::vector<int> fds_;
+};
+#endif
+
+} // namespace util
+} // namespace qengine
+
+#endif // QENGINE_UTILS_TRANSPORT_H_
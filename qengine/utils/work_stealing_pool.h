@@ -0,0 +1,215 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_UTILS_WORK_STEALING_POOL_H_
+#define QENGINE_UTILS_WORK_STEALING_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace qengine {
+inline namespace util {
+
+// Pool of workers with one task deque each. A worker pops its own newest
+// task first and, when empty, steals the oldest task of another worker, so
+// tasks submitted from inside a task stay on the submitting thread unless
+// someone else is idle. Used for irregular work (sweeps, gate DAGs) where
+// the static partition of ThreadPool would leave threads waiting.
+class WorkStealingPool {
+public:
+  using Task = std::function<void()>;
+
+  WorkStealingPool() = delete;
+  ~WorkStealingPool();
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool(WorkStealingPool&&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(WorkStealingPool&&) = delete;
+
+  // nthreads == 0 uses all cores.
+  explicit WorkStealingPool(uint64_t nthreads);
+
+  uint64_t nthreads() const { return threads_.size(); }
+
+  void submit(Task task);
+  // Blocks until every task, including tasks submitted by tasks, has
+  // finished; rethrows the first exception a task threw.
+  void wait();
+
+  // Index of the calling worker of this pool, or nthreads() outside it.
+  uint64_t worker_index() const;
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  bool pop(uint64_t self, Task& task);
+  void work(uint64_t self);
+  void finish();
+
+  static const WorkStealingPool*& current_pool();
+  static uint64_t& current_index();
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  std::atomic<int64_t> queued_{0};
+  std::atomic<uint64_t> pending_{0};
+  uint64_t next_ = 0;
+  bool stop_ = false;
+  std::exception_ptr error_;
+};
+
+inline WorkStealingPool::WorkStealingPool(uint64_t nthreads) {
+  if (nthreads == 0)
+    nthreads = std::max(1u, std::thread::hardware_concurrency());
+  for (uint64_t t = 0; t < nthreads; ++t)
+    queues_.emplace_back(new Queue);
+  for (uint64_t t = 0; t < nthreads; ++t)
+    threads_.emplace_back([this, t] { work(t); });
+}
+
+inline WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto & thread : threads_)
+    thread.join();
+}
+
+inline void WorkStealingPool::submit(Task task) {
+  ++pending_;
+  uint64_t target = worker_index();
+  if (target == nthreads()) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    target = next_++ % nthreads();
+  }
+  {
+    std::lock_guard<std::mutex> lock(queues_[target]->mutex);
+    queues_[target]->tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++queued_;
+  }
+  wake_.notify_one();
+}
+
+inline void WorkStealingPool::wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_.wait(lock, [this] { return pending_ == 0; });
+  if (error_) {
+    std::exception_ptr error = error_;
+    error_ = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+inline uint64_t WorkStealingPool::worker_index() const {
+  return current_pool() == this ? current_index() : nthreads();
+}
+
+inline bool WorkStealingPool::pop(uint64_t self, Task& task) {
+  {
+    Queue& own = *queues_[self];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      --queued_;
+      return true;
+    }
+  }
+  for (uint64_t k = 1; k < queues_.size(); ++k) {
+    Queue& victim = *queues_[(self + k) % queues_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      --queued_;
+      return true;
+    }
+  }
+  return false;
+}
+
+inline void WorkStealingPool::work(uint64_t self) {
+  current_pool() = this;
+  current_index() = self;
+  for (;;) {
+    Task task;
+    if (pop(self, task)) {
+      try {
+        task();
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_)
+          error_ = std::current_exception();
+      }
+      finish();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    wake_.wait(lock, [this] { return stop_ || queued_ > 0; });
+    if (stop_ && queued_ == 0)
+      return;
+  }
+}
+
+inline void WorkStealingPool::finish() {
+  if (--pending_ == 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_.notify_all();
+  }
+}
+
+inline const WorkStealingPool*& WorkStealingPool::current_pool() {
+  static thread_local const WorkStealingPool* pool = nullptr;
+  return pool;
+}
+
+inline uint64_t& WorkStealingPool::current_index() {
+  static thread_local uint64_t index = 0;
+  return index;
+}
+
+} // namespace util
+} // namespace qengine
+
+#endif // QENGINE_UTILS_WORK_STEALING_POOL_H_
@@ -0,0 +1,134 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "checkpoint.h"
+#include "circuit.h"
+#include "qreg.h"
+
+class CheckpointTests : public ::testing::Test {
+protected:
+  std::string path(const std::string& name) const {
+    return ::testing::TempDir() + name;
+  }
+};
+
+TEST_F(CheckpointTests, qreg_roundtrip) {
+  qengine::QReg<double> a(5);
+  a.applyX(1, 0.6, 0.8);
+  a.applyZ(1, 0.3);
+  qengine::save_checkpoint(path("qreg.ckpt"), a);
+
+  qengine::QReg<double> b = qengine::load_checkpoint<double>(path("qreg.ckpt"));
+
+  EXPECT_EQ(b.sdim(), a.sdim());
+  EXPECT_EQ(b.size(), a.size());
+  EXPECT_EQ(b.probabilities(), a.probabilities());
+  EXPECT_EQ(b.braket_product(a), a.braket_product(a));
+}
+
+TEST_F(CheckpointTests, precision_mismatch) {
+  qengine::save_checkpoint(path("float.ckpt"), qengine::QReg<float>(3));
+
+  EXPECT_THROW(
+    qengine::load_checkpoint<double>(path("float.ckpt")), std::runtime_error);
+}
+
+TEST_F(CheckpointTests, mapped) {
+  qengine::QReg<double> a(7);
+  a.applyX(3, 0.0, 1.0);
+  qengine::save_checkpoint(path("mapped.ckpt"), a);
+
+  qengine::MappedCheckpoint<double> mapped(path("mapped.ckpt"));
+
+  ASSERT_EQ(mapped.nreg(), 1);
+  EXPECT_EQ(mapped.dim(0), a.dim());
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(mapped.amplitudes(0)) % 64, 0);
+  for (uint64_t i = 0; i < a.dim(); ++i)
+    EXPECT_EQ(mapped.amplitudes(0)[i], a.data()[i]);
+  EXPECT_EQ(mapped.qreg(0).probabilities(), a.probabilities());
+}
+
+TEST_F(CheckpointTests, corrupt) {
+  qengine::save_checkpoint(path("good.ckpt"), qengine::QReg<double>(4));
+  std::ifstream in(path("good.ckpt"), std::ios::binary);
+  const std::string good{std::istreambuf_iterator<char>(in),
+                         std::istreambuf_iterator<char>()};
+  // both readers reject the good file with one field overwritten
+  const auto expect_rejected = [&](uint64_t pos, uint64_t value,
+                                   uint64_t bytes) {
+    std::string bad(good);
+    std::memcpy(&bad[pos], &value, bytes);
+    std::ofstream(path("corrupt.ckpt"), std::ios::binary) << bad;
+    EXPECT_THROW(qengine::MappedCheckpoint<double>(path("corrupt.ckpt")),
+                 std::runtime_error);
+    EXPECT_THROW(qengine::load_checkpoint<double>(path("corrupt.ckpt")),
+                 std::runtime_error);
+  };
+  using qengine::CheckpointHeader;
+  using qengine::RegisterHeader;
+  const uint64_t reg = sizeof(CheckpointHeader);
+
+  expect_rejected(offsetof(CheckpointHeader, nreg), 1u << 30, 4);
+  expect_rejected(offsetof(CheckpointHeader, ncregs), ~0ULL >> 3, 8);
+  expect_rejected(offsetof(CheckpointHeader, rng_bytes), ~0ULL, 8);
+  expect_rejected(reg + offsetof(RegisterHeader, dim), ~0ULL >> 3, 8);
+  expect_rejected(reg + offsetof(RegisterHeader, offset), ~0ULL, 8);
+  expect_rejected(reg + offsetof(RegisterHeader, sdim), 3, 8);
+  expect_rejected(reg + offsetof(RegisterHeader, size), 0, 8);
+}
+
+TEST_F(CheckpointTests, circuit_resume) {
+  const uint64_t nreg = 2;
+  const uint64_t dim = 4;
+  qengine::Circuit<double> a(nreg, dim);
+  a.applyX(0, 1, 1.0, 1.0);
+  a.applyX(1, 2, 1.0, 1.0);
+  a.measure(1, 1);
+  a.checkpoint(path("circuit.ckpt"));
+
+  qengine::Circuit<double> b(1, 1);
+  b.restore(path("circuit.ckpt"));
+
+  ASSERT_EQ(b.nreg(), nreg);
+  EXPECT_EQ(b.dim(), dim);
+  EXPECT_EQ(b.cregs(), a.cregs());
+
+  std::vector<qengine::CReg> results_a;
+  std::vector<qengine::CReg> results_b;
+  for (int k = 0; k < 16; ++k) {
+    a.measure(0, 0);
+    b.measure(0, 0);
+    results_a.push_back(a.get_creg(0));
+    results_b.push_back(b.get_creg(0));
+  }
+  EXPECT_EQ(results_a, results_b);
+}
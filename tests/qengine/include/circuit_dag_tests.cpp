@@ -0,0 +1,133 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "circuit.h"
+#include "circuit_dag.h"
+#include "instruction.h"
+#include "test_instructions.h"
+
+class CircuitDagTests : public ::testing::Test {};
+
+TEST_F(CircuitDagTests, independent_registers) {
+  qengine::Program<double> program;
+  for (uint64_t r = 0; r < 3; ++r)
+    for (uint64_t i = 1; i < 4; ++i)
+      program.push_back(make_instruction<double>(
+          qengine::OpCode::applyX, r, i, 1.0, 1.0));
+
+  qengine::CircuitDag<double> dag(program, 3, 4);
+
+  EXPECT_EQ(dag.nblocks(), 3);
+  EXPECT_EQ(dag.depth(), 1);
+}
+
+TEST_F(CircuitDagTests, disjoint_levels_and_measure) {
+  qengine::Program<double> program = {
+    make_instruction<double>(qengine::OpCode::applyX, 0, 1, 1.0, 1.0),
+    make_instruction<double>(qengine::OpCode::applyX, 0, 4, 1.0, 1.0),
+    make_instruction<double>(
+        qengine::OpCode::applyZ, 0, 1, 0.0, 0.0, 0.2),
+    make_instruction<double>(
+        qengine::OpCode::applyZ, 0, 4, 0.0, 0.0, 0.5),
+    make_instruction<double>(qengine::OpCode::measure, 0, 0),
+    make_instruction<double>(qengine::OpCode::measure, 1, 1),
+  };
+
+  qengine::CircuitDag<double> dag(program, 2, 6);
+
+  // {X1, Z1} and {X4, Z4} run side by side, then the measurements in order.
+  EXPECT_EQ(dag.nblocks(), 3);
+  EXPECT_EQ(dag.depth(), 2);
+
+  qengine::CircuitDag<double> tracked(program, 2, 6, {true, false});
+  EXPECT_EQ(tracked.nblocks(), 1);
+}
+
+TEST_F(CircuitDagTests, matches_sequential) {
+  const uint64_t nreg = 3;
+  const uint64_t dim = 9;
+  qengine::Program<double> program;
+  for (uint64_t step = 0; step < 40; ++step) {
+    const uint64_t r = step % nreg;
+    const uint64_t i = 1 + (step * 5) % (dim - 1);
+    program.push_back(make_instruction<double>(
+        qengine::OpCode::applyX, r, i, 1.0, 0.3 * step));
+    program.push_back(make_instruction<double>(
+        qengine::OpCode::applyZ, r, (step * 7) % dim, 0.0, 0.0,
+        0.1 * ((step * 7) % dim + 1)));
+    if (step % 13 == 12)
+      program.push_back(make_instruction<double>(
+          qengine::OpCode::measure, r, r));
+  }
+
+  qengine::Circuit<double> sequential(nreg, dim);
+  qengine::execute(sequential, program);
+
+  qengine::Circuit<double> parallel(nreg, dim);
+  qengine::DagExecutor<double> executor(4);
+  qengine::execute(parallel, program, executor);
+
+  EXPECT_EQ(parallel.cregs(), sequential.cregs());
+  for (uint64_t r = 0; r < nreg; ++r)
+    for (uint64_t i = 0; i < dim; ++i)
+      EXPECT_NEAR(std::abs(parallel.qregs()[r].data()[i]
+                           - sequential.qregs()[r].data()[i]), 0.0, 1e-12);
+}
+
+TEST_F(CircuitDagTests, memory_budget) {
+  // concurrent blocks decompress registers while others are evicted
+  const uint64_t nreg = 8;
+  const uint64_t dim = 256;
+  const uint64_t reg_bytes = dim * sizeof(qengine::Cmplx<double>);
+  qengine::Program<double> program;
+  for (uint64_t step = 0; step < 2000; ++step) {
+    const uint64_t r = (step * 3) % nreg;
+    const uint64_t i = 1 + (step * 37) % (dim - 1);
+    program.push_back(make_instruction<double>(
+        qengine::OpCode::applyX, r, i, 1.0, 0.3 * step));
+    program.push_back(make_instruction<double>(
+        qengine::OpCode::applyZ, r, (step * 11) % dim, 0.0, 0.0,
+        0.01 * step));
+  }
+
+  qengine::Circuit<double> sequential(nreg, dim);
+  qengine::execute(sequential, program);
+
+  qengine::Circuit<double> parallel(nreg, dim);
+  parallel.set_memory_budget(2 * reg_bytes);
+  qengine::DagExecutor<double> executor(4);
+  qengine::execute(parallel, program, executor);
+
+  EXPECT_LE(parallel.resident_bytes(), 2 * reg_bytes);
+  const auto actual = parallel.qregs();
+  const auto expected = sequential.qregs();
+  for (uint64_t r = 0; r < nreg; ++r)
+    for (uint64_t i = 0; i < dim; ++i)
+      EXPECT_NEAR(std::abs(actual[r].data()[i] - expected[r].data()[i]),
+                  0.0, 1e-12);
+}
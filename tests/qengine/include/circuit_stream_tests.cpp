@@ -0,0 +1,133 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "circuit.h"
+#include "circuit_stream.h"
+#include "instruction.h"
+
+class CircuitStreamTests : public ::testing::Test {
+protected:
+  qengine::Program<double> fingerprint(uint64_t dim) const {
+    qengine::Program<double> program;
+    qengine::Instruction<double> ins{};
+    ins.idx_qreg = 0;
+    ins.op = qengine::OpCode::applyX;
+    for (uint64_t i = 1; i < dim; ++i) {
+      ins.i = i;
+      ins.x = std::sqrt(1.0 / dim);
+      ins.y = std::sqrt(static_cast<double>(dim - i) / dim);
+      program.push_back(ins);
+    }
+    ins.op = qengine::OpCode::applyZ;
+    for (uint64_t i = 0; i < dim; ++i) {
+      ins.i = i;
+      ins.tau = 0.1 * i;
+      program.push_back(ins);
+    }
+    ins.op = qengine::OpCode::applyDiagonal;
+    ins.i = 0;
+    ins.phases = {0.3, -0.2, 0.5};
+    program.push_back(ins);
+    ins.op = qengine::OpCode::measure;
+    ins.i = 0;
+    program.push_back(ins);
+    return program;
+  }
+
+  void roundtrip(qengine::StreamFormat format) const {
+    const uint64_t dim = 6;
+    const auto program = fingerprint(dim);
+
+    std::stringstream stream;
+    qengine::CircuitWriter<double> writer(stream, format, 1, dim);
+    for (const auto & ins : program)
+      writer.write(ins);
+
+    qengine::CircuitReader<double> reader(stream);
+    EXPECT_EQ(reader.format(), format);
+    ASSERT_EQ(reader.nreg(), 1);
+    ASSERT_EQ(reader.dim(), dim);
+
+    qengine::Circuit<double> expected(1, dim);
+    qengine::execute(expected, program);
+    qengine::Circuit<double> actual(1, dim);
+
+    EXPECT_EQ(qengine::run_stream(actual, reader), program.size());
+    EXPECT_EQ(actual.qregs()[0].probabilities(),
+              expected.qregs()[0].probabilities());
+    EXPECT_EQ(actual.cregs(), expected.cregs());
+  }
+};
+
+TEST_F(CircuitStreamTests, text_roundtrip) {
+  roundtrip(qengine::StreamFormat::text);
+}
+
+TEST_F(CircuitStreamTests, binary_roundtrip) {
+  roundtrip(qengine::StreamFormat::binary);
+}
+
+TEST_F(CircuitStreamTests, text_program) {
+  std::istringstream stream(
+    "# swap level 0 into level 2\n"
+    "qengine 2 3\n"
+    "u 1 3 0 0 0 0 1 0  0 0 1 0 0 0  1 0 0 0 0 0\n"
+    "x 0 1 0 1   # rotate\n"
+    "cx 0 2 0 0 1 0\n"
+    "m 0 0\n"
+    "m 1 1\n");
+  qengine::CircuitReader<double> reader(stream);
+  qengine::Circuit<double> circuit(reader.nreg(), reader.dim());
+  qengine::run_stream(circuit, reader);
+
+  EXPECT_EQ(circuit.cregs()[0], 2);
+  EXPECT_EQ(circuit.cregs()[1], 2);
+}
+
+TEST_F(CircuitStreamTests, malformed) {
+  std::istringstream unknown("qengine 1 2\ny 0 1 0.5\n");
+  qengine::CircuitReader<double> reader(unknown);
+  qengine::Instruction<double> ins{};
+  EXPECT_THROW(reader.next(ins), std::runtime_error);
+
+  std::istringstream range("qengine 1 2\nz 0 2 0.5\n");
+  qengine::CircuitReader<double> range_reader(range);
+  EXPECT_THROW(range_reader.next(ins), std::runtime_error);
+
+  std::istringstream level("qengine 1 2\nx 0 0 0 1\n");
+  qengine::CircuitReader<double> level_reader(level);
+  EXPECT_THROW(level_reader.next(ins), std::runtime_error);
+
+  std::istringstream diag("qengine 1 2\ndiag 0 3 0.1 0.2 0.3\n");
+  qengine::CircuitReader<double> diag_reader(diag);
+  EXPECT_THROW(diag_reader.next(ins), std::runtime_error);
+
+  std::istringstream header("x 0 1 0 1\n");
+  EXPECT_THROW(qengine::CircuitReader<double> bad(header), std::runtime_error);
+}
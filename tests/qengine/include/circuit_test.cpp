@@ -54,6 +54,22 @@ TEST_F(CircuitTests, measure) {
   EXPECT_EQ(circuit.cregs()[0], 2);
 }
 
+TEST_F(CircuitTests, measure_tracked) {
+  qengine::Circuit<double> circuit(1, 3);
+  circuit.track_probabilities(0);
+
+  qengine::RMat<double> op(3, { 0.0, 0.0, 1.0,
+                                0.0, 1.0, 0.0,
+                                1.0, 0.0, 0.0 });
+  circuit.apply(0, op);
+  circuit.measure(0, 0);
+  EXPECT_EQ(circuit.cregs()[0], 2);
+
+  circuit.applyX(0, 2, 0.0, 1.0);
+  circuit.measure(0, 0);
+  EXPECT_EQ(circuit.cregs()[0], 1);
+}
+
 TEST_F(CircuitTests, applyX) {
   uint64_t nreg = 2;
   uint64_t dim = 3;
@@ -65,3 +81,57 @@ TEST_F(CircuitTests, applyX) {
 
   EXPECT_EQ(circuit.cregs()[0], 2);
 }
+
+TEST_F(CircuitTests, memory_budget) {
+  const uint64_t nreg = 6;
+  const uint64_t dim = 256;
+  const uint64_t reg_bytes = dim * sizeof(qengine::Cmplx<double>);
+  qengine::Circuit<double> circuit(nreg, dim);
+  qengine::Circuit<double> reference(nreg, dim);
+  for (auto * c : {&circuit, &reference})
+    for (uint64_t r = 0; r < nreg; ++r)
+      for (uint64_t i = 1; i < dim; ++i)
+        c->applyX(r, i, 1.0 + r, 0.5 * i);
+
+  circuit.set_memory_budget(2 * reg_bytes);
+  EXPECT_LE(circuit.resident_bytes(), 2 * reg_bytes);
+  // the two most recently used registers stay resident
+  for (uint64_t r = 0; r < nreg; ++r)
+    EXPECT_EQ(circuit.compressed(r), r < nreg - 2);
+
+  for (auto * c : {&circuit, &reference}) {
+    c->applyZ(0, 3, 0.7);
+    c->applyX(1, 5, 0.2, 0.9);
+  }
+  EXPECT_FALSE(circuit.compressed(0));
+  EXPECT_FALSE(circuit.compressed(1));
+  EXPECT_TRUE(circuit.compressed(nreg - 1));
+  EXPECT_EQ(circuit.dim(), dim);
+
+  const auto actual = circuit.qregs();
+  const auto expected = reference.qregs();
+  for (uint64_t r = 0; r < nreg; ++r)
+    for (uint64_t i = 0; i < dim; ++i)
+      EXPECT_EQ(actual[r].data()[i], expected[r].data()[i]);
+
+  circuit.set_memory_budget(0);
+  circuit.applyZ(4, 1, 0.1);
+  EXPECT_FALSE(circuit.compressed(4));
+  EXPECT_TRUE(circuit.compressed(5));
+}
+
+#ifdef QENGINE_PROFILING
+TEST_F(CircuitTests, profiler) {
+  uint64_t dim = 3;
+  qengine::Circuit<double> circuit(1, dim);
+
+  circuit.applyX(0, 1, 0.0, 1.0);
+  circuit.applyX(0, 2, 0.0, 1.0);
+  circuit.applyZ(0, 2, 0.5);
+  circuit.measure(0, 0);
+
+  EXPECT_EQ(circuit.profiler().stats("applyX").calls, 2);
+  EXPECT_EQ(circuit.profiler().stats("applyZ").calls, 1);
+  EXPECT_EQ(circuit.profiler().stats("measure").calls, 1);
+}
+#endif
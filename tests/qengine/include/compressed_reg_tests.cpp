@@ -0,0 +1,55 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cmath>
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include "compressed_reg.h"
+#include "qreg.h"
+
+class CompressedRegTests : public ::testing::Test {};
+
+TEST_F(CompressedRegTests, round_trip) {
+  const uint64_t dim = 300;
+  qengine::QReg<double> qreg(dim);
+  for (uint64_t i = 1; i < dim; i += 2)
+    qreg.applyX(i, 1.0, 0.3);
+  qreg.track_probabilities();
+
+  const qengine::CompressedReg<double> lossless(qreg);
+  EXPECT_TRUE(lossless.lossless());
+  EXPECT_EQ(lossless.sdim(), dim);
+  EXPECT_LT(lossless.bytes(), dim * sizeof(qengine::Cmplx<double>));
+  const auto restored = lossless.decompress();
+  EXPECT_TRUE(restored.tracks_probabilities());
+  for (uint64_t i = 0; i < dim; ++i)
+    EXPECT_EQ(restored.data()[i], qreg.data()[i]);
+
+  const qengine::CompressedReg<double> lossy(qreg, 1e-8);
+  EXPECT_FALSE(lossy.lossless());
+  EXPECT_LT(lossy.bytes(), lossless.bytes());
+  const auto approx = lossy.decompress();
+  for (uint64_t i = 0; i < dim; ++i)
+    EXPECT_LE(std::abs(approx.data()[i] - qreg.data()[i]), 2e-8);
+}
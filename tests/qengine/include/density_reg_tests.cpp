@@ -0,0 +1,123 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "density_reg.h"
+#include "qreg.h"
+#include "types.h"
+
+class DensityRegTests : public ::testing::Test {
+protected:
+  void expect_pure(const qengine::DensityReg<double>& rho,
+                   const qengine::QReg<double>& psi) const {
+    const auto a = psi.data();
+    for (uint64_t j = 0; j < psi.dim(); ++j)
+      for (uint64_t i = 0; i < psi.dim(); ++i) {
+        const auto expected = a[i] * std::conj(a[j]);
+        EXPECT_NEAR(rho(i, j).real(), expected.real(), 1e-12);
+        EXPECT_NEAR(rho(i, j).imag(), expected.imag(), 1e-12);
+      }
+  }
+};
+
+TEST_F(DensityRegTests, simple) {
+  qengine::DensityReg<double> rho(3);
+
+  EXPECT_EQ(rho.probabilities(), qengine::RVec<double>({1.0, 0.0, 0.0}));
+  EXPECT_DOUBLE_EQ(rho.trace(), 1.0);
+  EXPECT_DOUBLE_EQ(rho.purity(), 1.0);
+}
+
+TEST_F(DensityRegTests, unitaries) {
+  const uint64_t dim = 5;
+  qengine::QReg<double> psi(dim);
+  qengine::DensityReg<double> rho(dim);
+
+  for (uint64_t i = 1; i < dim; ++i) {
+    psi.applyX(i, 0.3 * i, 1.0);
+    rho.applyX(i, 0.3 * i, 1.0);
+  }
+  for (uint64_t i = 0; i < dim; ++i) {
+    psi.applyZ(i, 0.7 * i);
+    rho.applyZ(i, 0.7 * i);
+  }
+  const qengine::Cmplx<double> x(0.2, 0.5), y(-0.4, 0.1);
+  psi.applyX(2, x, y);
+  rho.applyX(2, x, y);
+  psi.applyXconjugate(3, x, y);
+  rho.applyXconjugate(3, x, y);
+  psi.applyZconjugate(1, 0.9);
+  rho.applyZconjugate(1, 0.9);
+
+  expect_pure(rho, psi);
+  expect_pure(qengine::DensityReg<double>(psi), psi);
+}
+
+TEST_F(DensityRegTests, apply) {
+  qengine::QReg<double> psi(3);
+  psi.applyX(1, 1.0, 1.0);
+  qengine::DensityReg<double> rho(psi);
+  qengine::CMat<double> M(3, { 0.0, 0.0, 1.0,
+                               0.0, 1.0, 0.0,
+                               1.0, 0.0, 0.0 });
+  psi.apply(M);
+  rho.apply(M);
+
+  expect_pure(rho, psi);
+}
+
+TEST_F(DensityRegTests, damp) {
+  qengine::DensityReg<double> rho(3);
+  rho.applyX(1, 0.0, 1.0);
+  rho.applyX(1, 1.0, 1.0);
+
+  qengine::DensityReg<double> kraus(rho);
+  const double gamma = 0.3;
+  qengine::CMat<double> K0(3), K1(3);
+  K0(0, 0) = 1.0;
+  K0(1, 1) = std::sqrt(1 - gamma);
+  K0(2, 2) = 1.0;
+  K1(0, 1) = std::sqrt(gamma);
+  kraus.apply_channel({K0, K1});
+  rho.damp(1, gamma);
+
+  for (uint64_t j = 0; j < 3; ++j)
+    for (uint64_t i = 0; i < 3; ++i)
+      EXPECT_NEAR(std::abs(rho(i, j) - kraus(i, j)), 0.0, 1e-12);
+  EXPECT_NEAR(rho.trace(), 1.0, 1e-12);
+  EXPECT_LT(rho.purity(), 1.0);
+}
+
+TEST_F(DensityRegTests, dephase) {
+  qengine::DensityReg<double> rho(2);
+  rho.applyX(1, 1.0, 1.0);
+  rho.dephase(1, 0.5);
+
+  EXPECT_NEAR(std::abs(rho(0, 1)), 0.0, 1e-12);
+  EXPECT_NEAR(rho.purity(), 0.5, 1e-12);
+  EXPECT_NEAR(rho.probabilities()[1], 0.5, 1e-12);
+}
@@ -0,0 +1,127 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dist_reg.h"
+#include "qreg.h"
+#include "transport.h"
+
+class DistQRegTests : public ::testing::Test {
+protected:
+  template <typename Reg>
+  void circuit(Reg& reg) const {
+    reg.applyX(1, 0.6, 0.8);
+    reg.applyX(3, std::complex<double>(0.0, 1.0), 1.0);
+    reg.applyX(4, 1.0, 2.0);
+    reg.applyZ(3, 0.7);
+    reg.applyX(5, 0.3, -0.4);
+    reg.applyX(6, 1.0, 1.0);
+    reg.applyXconjugate(4, 0.5, 1.5);
+    reg.applyZconjugate(1, 0.2);
+  }
+};
+
+TEST_F(DistQRegTests, matches_dense_register) {
+  qengine::QReg<double> dense(7, 1);
+  dense.applyX(2, 1.0, 1.0);
+  circuit(dense);
+
+  std::vector<qengine::CVec<double>> states(3);
+  qengine::ThreadTransport::run(3, [&](qengine::Transport& transport) {
+    qengine::DistQReg<double> reg(transport, 7);
+    reg.applyX(2, 1.0, 1.0);
+    circuit(reg);
+    const auto full = reg.gather();
+    states[transport.rank()].assign(full.data(), full.data() + 7);
+  });
+
+  for (const auto & state : states)
+    for (uint64_t i = 0; i < 7; ++i)
+      EXPECT_NEAR(std::abs(state[i] - dense.data()[i]), 0.0, 1e-12);
+}
+
+TEST_F(DistQRegTests, dense_gate_and_norm) {
+  qengine::CMat<double> mat(5);
+  for (uint64_t i = 0; i < 5; ++i)
+    mat(i, (i + 1) % 5) = 1.0;
+
+  std::vector<double> norms(2);
+  std::vector<qengine::CVec<double>> states(2);
+  qengine::ThreadTransport::run(2, [&](qengine::Transport& transport) {
+    qengine::DistQReg<double> reg(transport, 5);
+    reg.applyX(1, 1.0, 1.0);
+    reg.apply(mat);
+    norms[transport.rank()] = reg.norm();
+    const auto full = reg.gather();
+    states[transport.rank()].assign(full.data(), full.data() + 5);
+  });
+
+  for (uint64_t r = 0; r < 2; ++r) {
+    EXPECT_NEAR(norms[r], 1.0, 1e-12);
+    EXPECT_NEAR(std::abs(states[r][0]), std::sqrt(0.5), 1e-12);
+    EXPECT_NEAR(std::abs(states[r][4]), std::sqrt(0.5), 1e-12);
+  }
+}
+
+TEST_F(DistQRegTests, measure_agrees_across_ranks) {
+  std::vector<std::vector<qengine::CReg>> results(4);
+  qengine::ThreadTransport::run(4, [&](qengine::Transport& transport) {
+    qengine::DistQReg<double> reg(transport, 8);
+    for (uint64_t i = 1; i < 8; ++i)
+      reg.applyX(i, 1.0, 1.0);
+    std::mt19937 mte(5);
+    for (int k = 0; k < 50; ++k)
+      results[transport.rank()].push_back(reg.measure(mte));
+  });
+
+  for (uint64_t r = 1; r < 4; ++r)
+    EXPECT_EQ(results[r], results[0]);
+  for (const auto & level : results[0])
+    EXPECT_LT(level, 8);
+}
+
+#ifdef QENGINE_HAS_FORK
+TEST_F(DistQRegTests, socket_transport) {
+  qengine::QReg<double> dense(7, 1);
+  circuit(dense);
+  const qengine::CVec<double> expected(dense.data(), dense.data() + 7);
+
+  const bool ok = qengine::SocketTransport::fork_run(
+      3, [&](qengine::Transport& transport) {
+        qengine::DistQReg<double> reg(transport, 7);
+        circuit(reg);
+        const auto full = reg.gather();
+        for (uint64_t i = 0; i < 7; ++i)
+          if (std::abs(full.data()[i] - expected[i]) > 1e-12)
+            throw std::runtime_error("mismatch");
+      });
+  EXPECT_TRUE(ok);
+}
+#endif
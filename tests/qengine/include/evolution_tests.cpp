@@ -0,0 +1,130 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "evolution.h"
+#include "qreg.h"
+
+class EvolutionTests : public ::testing::Test {
+protected:
+  // Hopping chain with complex couplings and an on-site potential.
+  static qengine::SparseMatrix<qengine::DCmplx> chain(uint64_t n) {
+    std::vector<qengine::SparseMatrix<qengine::DCmplx>::Triplet> triplets;
+    for (uint64_t i = 0; i < n; ++i) {
+      triplets.emplace_back(i, i, qengine::DCmplx(std::cos(0.7 * i)));
+      if (i + 1 < n) {
+        const qengine::DCmplx b(0.5 + 0.1 * i, 0.3);
+        triplets.emplace_back(i, i + 1, b);
+        triplets.emplace_back(i + 1, i, std::conj(b));
+      }
+    }
+    return qengine::SparseMatrix<qengine::DCmplx>(n, n, triplets);
+  }
+
+  static qengine::QReg<double> start(uint64_t n) {
+    qengine::DCVec psi(n);
+    for (uint64_t i = 0; i < n; ++i)
+      psi[i] = qengine::DCmplx(1.0 + std::sin(1.3 * i), 0.2 * i);
+    qengine::QReg<double> reg(n);
+    reg.prepare_state(psi);
+    return reg;
+  }
+
+  static void expect_near(const qengine::QReg<double>& a,
+                          const qengine::QReg<double>& b, double eps) {
+    for (uint64_t i = 0; i < a.sdim(); ++i)
+      EXPECT_NEAR(std::abs(a.data()[i] - b.data()[i]), 0.0, eps);
+  }
+};
+
+TEST_F(EvolutionTests, methods_agree) {
+  const uint64_t n = 12;
+  const double t = 1.7;
+  qengine::TimeEvolution<double> evolution(chain(n), 1e-8);
+  EXPECT_TRUE(evolution.tridiagonal());
+
+  auto eigen = start(n);
+  auto krylov = start(n);
+  auto trotter = start(n);
+  evolution.evolve(eigen, t, qengine::EvolutionMethod::eigen);
+  evolution.evolve(krylov, t, qengine::EvolutionMethod::krylov);
+  evolution.evolve(trotter, t, qengine::EvolutionMethod::trotter);
+  EXPECT_TRUE(evolution.decomposed());
+
+  expect_near(eigen, krylov, 1e-8);
+  expect_near(eigen, trotter, 1e-6);
+
+  double norm = 0.0;
+  for (uint64_t i = 0; i < n; ++i)
+    norm += std::norm(eigen.data()[i]);
+  EXPECT_NEAR(norm, 1.0, 1e-12);
+}
+
+TEST_F(EvolutionTests, round_trip) {
+  const uint64_t n = 40;
+  const auto H = chain(n);
+  auto reg = start(n);
+  const auto expected = reg;
+
+  const auto psi = qengine::expm_multiply(
+      H, qengine::DCVec(reg.data(), reg.data() + n), 25.0);
+  reg.assign(qengine::expm_multiply(H, psi, -25.0));
+  expect_near(reg, expected, 1e-8);
+}
+
+TEST_F(EvolutionTests, dense) {
+  const uint64_t n = 6;
+  qengine::DCMat H(n);
+  for (uint64_t i = 0; i < n; ++i)
+    for (uint64_t j = 0; j <= i; ++j) {
+      H(i, j) = qengine::DCmplx(1.0 / (1 + i + j), i == j ? 0.0 : 0.1 * j);
+      H(j, i) = std::conj(H(i, j));
+    }
+  qengine::TimeEvolution<double> evolution(H);
+  EXPECT_FALSE(evolution.tridiagonal());
+  EXPECT_EQ(evolution.select(1.0), qengine::EvolutionMethod::krylov);
+
+  auto eigen = start(n);
+  auto krylov = start(n);
+  evolution.evolve(eigen, 3.0, qengine::EvolutionMethod::eigen);
+  EXPECT_EQ(evolution.select(1.0), qengine::EvolutionMethod::eigen);
+  evolution.evolve(krylov, 3.0, qengine::EvolutionMethod::krylov);
+  expect_near(eigen, krylov, 1e-9);
+}
+
+TEST_F(EvolutionTests, select) {
+  const uint64_t n = 4096;
+  qengine::TimeEvolution<double> evolution(chain(n), 1e-6);
+  EXPECT_NE(evolution.select(0.5), qengine::EvolutionMethod::eigen);
+  EXPECT_FALSE(evolution.decomposed());
+
+  auto trotter = start(n);
+  auto krylov = start(n);
+  evolution.evolve(trotter, 0.5);
+  evolution.evolve(krylov, 0.5, qengine::EvolutionMethod::krylov);
+  expect_near(trotter, krylov, 1e-5);
+}
@@ -0,0 +1,120 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cmath>
+#include <complex>
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include "expectation.h"
+#include "qreg.h"
+#include "sparse_matrix.h"
+#include "types.h"
+
+class ExpectationTests : public ::testing::Test {
+protected:
+  qengine::QReg<double> state(uint64_t dim, double phase) const {
+    qengine::QReg<double> reg(dim);
+    for (uint64_t i = 1; i < dim; ++i) {
+      reg.applyX(i, 1.0, 0.5 * i);
+      reg.applyZ(i, phase * i);
+    }
+    return reg;
+  }
+};
+
+TEST_F(ExpectationTests, overlap_conjugates_bra) {
+  const auto a = state(4, 0.4);
+  const auto b = state(4, -0.9);
+
+  std::complex<double> expected(0.0);
+  for (uint64_t i = 0; i < 4; ++i)
+    expected += std::conj(a.data()[i]) * b.data()[i];
+  EXPECT_NEAR(std::abs(qengine::overlap(a, b) - expected), 0.0, 1e-12);
+  EXPECT_NEAR(qengine::fidelity(a, a), 1.0, 1e-12);
+}
+
+TEST_F(ExpectationTests, observables_agree) {
+  const uint64_t dim = 5;
+  const auto psi = state(dim, 0.7);
+
+  qengine::CMat<double> dense(dim);
+  for (uint64_t i = 0; i < dim; ++i) {
+    dense(i, i) = 1.0 + i;
+    if (i + 1 < dim) {
+      dense(i, i + 1) = std::complex<double>(0.0, 0.5);
+      dense(i + 1, i) = std::complex<double>(0.0, -0.5);
+    }
+  }
+  const qengine::SparseMatrix<std::complex<double>> sparse(dense);
+
+  std::complex<double> expected(0.0);
+  for (uint64_t i = 0; i < dim; ++i)
+    for (uint64_t j = 0; j < dim; ++j)
+      expected += std::conj(psi.data()[i]) * dense(i, j) * psi.data()[j];
+
+  EXPECT_NEAR(
+    std::abs(qengine::expectation(psi, dense) - expected), 0.0, 1e-12);
+  EXPECT_NEAR(
+    std::abs(qengine::expectation(psi, sparse) - expected), 0.0, 1e-12);
+  EXPECT_NEAR(expected.imag(), 0.0, 1e-12);
+
+  qengine::RVec<double> diagonal(dim);
+  double expected_diagonal = 0.0;
+  for (uint64_t i = 0; i < dim; ++i) {
+    diagonal[i] = 1.0 + i;
+    expected_diagonal += diagonal[i] * std::norm(psi.data()[i]);
+  }
+  EXPECT_NEAR(qengine::expectation(psi, diagonal), expected_diagonal, 1e-12);
+}
+
+TEST_F(ExpectationTests, reduced_probabilities) {
+  // Three qutrits; the middle one is in |2>.
+  qengine::QReg<double> reg(27);
+  reg.applyX(1, 0.0, 1.0);
+  reg.applyX(2, 0.0, 1.0);
+  reg.applyX(3, 0.0, 1.0);
+  reg.applyX(4, 0.0, 1.0);
+  reg.applyX(5, 0.0, 1.0);
+  reg.applyX(6, 1.0, 1.0);
+
+  const auto middle = qengine::reduced_probabilities(reg, 3, 1);
+  const auto last = qengine::reduced_probabilities(reg, 3, 2);
+
+  EXPECT_NEAR(middle[2], 0.5, 1e-12);
+  EXPECT_NEAR(middle[0], 0.0, 1e-12);
+  EXPECT_NEAR(last[2], 0.5, 1e-12);
+  EXPECT_NEAR(last[0], 0.5, 1e-12);
+}
+
+TEST_F(ExpectationTests, large_register) {
+  const uint64_t dim = 2 * qengine::kParallelThreshold;
+  const auto psi = state(dim, 0.01);
+
+  qengine::RVec<double> ones(dim, 1.0);
+  EXPECT_NEAR(qengine::expectation(psi, ones), 1.0, 1e-9);
+  EXPECT_NEAR(qengine::fidelity(psi, psi), 1.0, 1e-9);
+
+  const auto marginal = qengine::reduced_probabilities(psi, 2, 0);
+  EXPECT_NEAR(marginal[0] + marginal[1], 1.0, 1e-9);
+}
@@ -0,0 +1,181 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "instruction.h"
+#include "job_executor.h"
+#include "test_instructions.h"
+
+class JobExecutorTests : public ::testing::Test {
+protected:
+  // Equal superposition of |0> and |2> on every register, then measure.
+  static std::shared_ptr<const qengine::CompiledCircuit<double>> job(
+      uint64_t nreg) {
+    auto res = std::make_shared<qengine::CompiledCircuit<double>>();
+    res->nreg = nreg;
+    res->dim = 3;
+    for (uint64_t r = 0; r < nreg; ++r) {
+      res->program.push_back(make_instruction<double>(
+          qengine::OpCode::applyX, r, 1, 0.0, 1.0));
+      res->program.push_back(make_instruction<double>(
+          qengine::OpCode::applyX, r, 2, 0.0, 1.0));
+      res->program.push_back(make_instruction<double>(
+          qengine::OpCode::applyX, r, 1, 1.0, 1.0));
+      res->program.push_back(make_instruction<double>(
+          qengine::OpCode::measure, r, r, 0.0, 0.0));
+    }
+    return res;
+  }
+};
+
+TEST_F(JobExecutorTests, futures) {
+  qengine::JobExecutor<double> executor(2, 4);
+  std::vector<std::future<qengine::JobResult>> results;
+  for (uint32_t seed = 0; seed < 16; ++seed)
+    results.push_back(executor.submit(job(2), 50, seed));
+
+  for (uint32_t seed = 0; seed < 16; ++seed) {
+    const auto result = results[seed].get();
+    uint64_t total = 0;
+    for (const auto & entry : result.histogram) {
+      for (const auto & creg : entry.first)
+        EXPECT_TRUE(creg == 0 || creg == 2);
+      total += entry.second;
+    }
+    EXPECT_EQ(total, 50);
+    EXPECT_EQ(result.histogram,
+              qengine::JobExecutor<double>::run(*job(2), 50, seed).histogram);
+  }
+}
+
+TEST_F(JobExecutorTests, backpressure) {
+  qengine::JobExecutor<double> executor(1, 1);
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  std::promise<void> started;
+
+  executor.submit(job(1), 1, 1,
+                  [&started, released](qengine::JobResult,
+                                       std::exception_ptr) {
+    started.set_value();
+    released.wait();
+  });
+  started.get_future().wait();
+
+  std::future<qengine::JobResult> queued;
+  std::future<qengine::JobResult> rejected;
+  EXPECT_TRUE(executor.try_submit(job(1), 1, 2, queued));
+  EXPECT_FALSE(executor.try_submit(job(1), 1, 3, rejected));
+  EXPECT_EQ(executor.queued(), 1);
+
+  release.set_value();
+  EXPECT_EQ(queued.get().histogram.size(), 1);
+}
+
+TEST_F(JobExecutorTests, throwing_callback) {
+  qengine::JobExecutor<double> executor(1, 2);
+  executor.submit(job(1), 1, 1, [](qengine::JobResult, std::exception_ptr) {
+    throw std::runtime_error("callback failed");
+  });
+
+  EXPECT_EQ(executor.submit(job(1), 10, 7).get().histogram,
+            qengine::JobExecutor<double>::run(*job(1), 10, 7).histogram);
+}
+
+#ifdef QENGINE_HAS_COROUTINES
+namespace {
+
+struct FireAndForget {
+  struct promise_type {
+    FireAndForget get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+FireAndForget await_job(
+    qengine::JobExecutor<double>& executor,
+    std::shared_ptr<const qengine::CompiledCircuit<double>> job,
+    std::promise<qengine::JobResult>& out) {
+  out.set_value(co_await qengine::schedule(executor, job, 10, 7));
+}
+
+// The second job is scheduled from the worker that resumed the coroutine.
+FireAndForget await_two_jobs(
+    qengine::JobExecutor<double>& executor,
+    std::shared_ptr<const qengine::CompiledCircuit<double>> job,
+    std::promise<qengine::JobResult>& out) {
+  co_await qengine::schedule(executor, job, 2000, 7);
+  out.set_value(co_await qengine::schedule(executor, job, 10, 8));
+}
+
+} // namespace
+
+TEST_F(JobExecutorTests, coroutine) {
+  qengine::JobExecutor<double> executor(1, 2);
+  std::promise<qengine::JobResult> out;
+  await_job(executor, job(1), out);
+
+  EXPECT_EQ(out.get_future().get().histogram,
+            qengine::JobExecutor<double>::run(*job(1), 10, 7).histogram);
+}
+
+TEST_F(JobExecutorTests, coroutine_on_full_queue) {
+  // one worker and one slot: the worker resumes both coroutines while the
+  // slot holds a job that cannot start until the worker is free
+  qengine::JobExecutor<double> executor(1, 1);
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  std::promise<void> started;
+  executor.submit(job(1), 1, 1,
+                  [&started, released](qengine::JobResult,
+                                       std::exception_ptr) {
+    started.set_value();
+    released.wait();
+  });
+  started.get_future().wait();
+
+  std::promise<qengine::JobResult> first;
+  std::promise<qengine::JobResult> second;
+  std::thread producer([&] {
+    await_two_jobs(executor, job(1), first);
+    await_two_jobs(executor, job(1), second);
+  });
+  release.set_value();
+  producer.join();
+
+  const auto expected =
+      qengine::JobExecutor<double>::run(*job(1), 10, 8).histogram;
+  EXPECT_EQ(first.get_future().get().histogram, expected);
+  EXPECT_EQ(second.get_future().get().histogram, expected);
+}
+#endif
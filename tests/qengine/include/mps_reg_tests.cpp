@@ -0,0 +1,164 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "decompositions.h"
+#include "math_operations.h"
+#include "mps_reg.h"
+#include "types.h"
+
+class MPSRegTests : public ::testing::Test {
+protected:
+  using DCMat = qengine::CMat<double>;
+
+  // |s1, s2> -> |s1, s1 + s2 mod d>
+  DCMat controlled_shift(uint64_t d) const {
+    DCMat gate(d * d);
+    for (uint64_t s1 = 0; s1 < d; ++s1)
+      for (uint64_t s2 = 0; s2 < d; ++s2)
+        gate(s1 * d + (s1 + s2) % d, s1 * d + s2) = 1.0;
+    return gate;
+  }
+
+  // gate on qudits k .. k + width - 1 of a dense register of `size` qudits
+  DCMat local(const DCMat& gate, uint64_t k, uint64_t width,
+              uint64_t d, uint64_t size) const {
+    qengine::Matrix<qengine::DCmplx> res = qengine::I_mat<qengine::DCmplx>(1);
+    for (uint64_t j = 0; j < size; ++j)
+      if (j == k)
+        res = res.tensor_times(gate);
+      else if (j < k || j >= k + width)
+        res = res.tensor_times(qengine::I_mat<qengine::DCmplx>(d));
+    return DCMat(res.nrows(), res.vals());
+  }
+};
+
+TEST_F(MPSRegTests, matches_dense) {
+  const uint64_t d = 3;
+  const uint64_t size = 3;
+  qengine::MPSReg<double> mps(d, size);
+  qengine::QReg<double> dense(27);
+
+  DCMat F(d);
+  for (uint64_t j = 0; j < d; ++j)
+    for (uint64_t i = 0; i < d; ++i)
+      F(i, j) = std::polar(1.0 / std::sqrt(d), 2 * M_PI * i * j / d);
+
+  mps.apply(F, 0);
+  dense.apply(local(F, 0, 1, d, size));
+
+  const double norm = std::sqrt(0.3 * 0.3 + 0.7 * 0.7);
+  DCMat X(d, { 0.3 / norm, 0.7 / norm, 0.0,
+              -0.7 / norm, 0.3 / norm, 0.0,
+               0.0, 0.0, 1.0 });
+  mps.applyX(1, 1, 0.3, 0.7);
+  dense.apply(local(X, 1, 1, d, size));
+
+  DCMat Z(d, {1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, std::polar(1.0, 0.4)});
+  mps.applyZ(2, 2, 0.4);
+  dense.apply(local(Z, 2, 1, d, size));
+
+  const DCMat CS = controlled_shift(d);
+  mps.apply(CS, 0);
+  dense.apply(local(CS, 0, 2, d, size));
+  mps.apply(CS, 1);
+  dense.apply(local(CS, 1, 2, d, size));
+
+  const auto expected = dense.data();
+  const auto actual = mps.to_qreg();
+  for (uint64_t i = 0; i < 27; ++i)
+    EXPECT_NEAR(std::abs(actual.data()[i] - expected[i]), 0.0, 1e-12);
+  EXPECT_NEAR(mps.norm(), 1.0, 1e-12);
+  EXPECT_EQ(mps.bond_dim(1), 3);
+  EXPECT_NEAR(mps.discarded_weight(), 0.0, 1e-12);
+}
+
+TEST_F(MPSRegTests, sample_ghz) {
+  const uint64_t d = 3;
+  const uint64_t size = 24;
+  qengine::MPSReg<double> mps(d, size, 8);
+
+  DCMat F(d);
+  for (uint64_t j = 0; j < d; ++j)
+    for (uint64_t i = 0; i < d; ++i)
+      F(i, j) = std::polar(1.0 / std::sqrt(d), 2 * M_PI * i * j / d);
+  mps.apply(F, 0);
+  for (uint64_t k = 0; k + 1 < size; ++k)
+    mps.apply(controlled_shift(d), k);
+
+  EXPECT_EQ(mps.max_bond(), d);
+
+  std::mt19937 mte(3);
+  std::vector<uint64_t> counts(d);
+  for (const auto & shot : mps.sample(mte, 300)) {
+    for (const auto & digit : shot)
+      EXPECT_EQ(digit, shot[0]);
+    ++counts[shot[0]];
+  }
+  for (const auto & count : counts)
+    EXPECT_GT(count, 50);
+}
+
+TEST_F(MPSRegTests, truncation) {
+  qengine::MPSReg<double> mps(2, 2, 1);
+  mps.applyX(0, 1, 1.0, 1.0);
+  mps.apply(controlled_shift(2), 0);
+
+  EXPECT_EQ(mps.bond_dim(1), 1);
+  EXPECT_NEAR(mps.discarded_weight(), 0.5, 1e-12);
+}
+
+TEST_F(MPSRegTests, canonical_truncation) {
+  // Only the middle bond can exceed 2, so the gate on qudits 1, 2 is the
+  // one truncation; the pair order keeps the centre away from it.
+  const uint64_t d = 2;
+  const uint64_t size = 4;
+  qengine::MPSReg<double> mps(d, size, 2);
+  qengine::QReg<double> dense(16);
+
+  std::mt19937 mte(11);
+  std::normal_distribution<double> normal;
+  for (uint64_t k : {2, 0, 1, 0, 2}) {
+    qengine::Matrix<qengine::DCmplx> g(d * d, d * d);
+    for (uint64_t j = 0; j < d * d; ++j)
+      for (uint64_t i = 0; i < d * d; ++i)
+        g(i, j) = qengine::DCmplx(normal(mte), normal(mte));
+    const auto dec = qengine::svd(g);
+    const DCMat U(d * d, (dec.U * dec.Vh).vals());
+    mps.apply(U, k);
+    dense.apply(local(U, k, 2, d, size));
+  }
+
+  const auto actual = mps.to_qreg();
+  qengine::DCmplx overlap = 0.0;
+  for (uint64_t i = 0; i < 16; ++i)
+    overlap += std::conj(dense.data()[i]) * actual.data()[i];
+  EXPECT_GT(mps.discarded_weight(), 1e-3);
+  EXPECT_NEAR(mps.norm(), 1.0, 1e-12);
+  EXPECT_NEAR(std::norm(overlap), 1.0 - mps.discarded_weight(), 1e-12);
+}
@@ -0,0 +1,172 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include "circuit.h"
+#include "instruction.h"
+#include "optimizer.h"
+#include "test_instructions.h"
+
+class OptimizerTests : public ::testing::Test {
+protected:
+  static void expect_same_state(const qengine::Program<double>& a,
+                                const qengine::Program<double>& b,
+                                uint64_t nreg, uint64_t dim) {
+    qengine::Circuit<double> ca(nreg, dim);
+    qengine::Circuit<double> cb(nreg, dim);
+    qengine::execute(ca, a);
+    qengine::execute(cb, b);
+    for (uint64_t r = 0; r < nreg; ++r)
+      for (uint64_t i = 0; i < dim; ++i)
+        EXPECT_NEAR(std::abs(ca.qregs()[r].data()[i]
+                             - cb.qregs()[r].data()[i]), 0.0, 1e-12);
+    EXPECT_EQ(ca.cregs(), cb.cregs());
+  }
+};
+
+TEST_F(OptimizerTests, reverse_test) {
+  using qengine::OpCode;
+  const uint64_t dim = 16;
+  qengine::Program<double> program;
+  for (uint64_t i = 1; i < dim; ++i)
+    program.push_back(make_instruction<double>(
+        OpCode::applyX, 0, i, std::sqrt(1.0 / dim),
+        std::sqrt(double(dim - i) / dim)));
+  for (uint64_t i = 0; i < dim; ++i)
+    program.push_back(make_instruction<double>(
+        OpCode::applyZ, 0, i, 0, 0, 15.0 * i / 8));
+  for (uint64_t i = dim; i > 0; --i)
+    program.push_back(make_instruction<double>(
+        OpCode::applyZconjugate, 0, i - 1, 0, 0, 15.0 * (i - 1) / 8));
+  for (uint64_t i = dim - 1; i > 0; --i)
+    program.push_back(make_instruction<double>(
+        OpCode::applyXconjugate, 0, i, std::sqrt(1.0 / dim),
+        std::sqrt(double(dim - i) / dim)));
+  program.push_back(make_instruction<double>(OpCode::measure, 0, 0));
+
+  qengine::OptimizationReport report;
+  const auto optimized = qengine::optimize(program, &report);
+
+  ASSERT_EQ(optimized.size(), 1);
+  EXPECT_EQ(optimized[0].op, OpCode::measure);
+  EXPECT_EQ(report.gates_before, program.size());
+  EXPECT_EQ(report.gates_after, 1);
+  EXPECT_EQ(report.reduction(), program.size() - 1);
+  EXPECT_EQ(report.diagonal_before, 2 * dim);
+  EXPECT_EQ(report.diagonal_after, 0);
+  EXPECT_EQ(report.rotations_cancelled, 2 * (dim - 1));
+}
+
+TEST_F(OptimizerTests, merge_diagonal) {
+  using qengine::OpCode;
+  const uint64_t dim = 8;
+  qengine::Program<double> program;
+  program.push_back(make_instruction<double>(
+      OpCode::applyX, 0, 1, 0.3, 0.8));
+  program.push_back(make_instruction<double>(
+      OpCode::applyX, 0, 2, 0.6, 0.1));
+  program.push_back(make_instruction<double>(
+      OpCode::applyZ, 0, 0, 0, 0, 0.4));
+  program.push_back(make_instruction<double>(
+      OpCode::applyZ, 0, 2, 0, 0, 0.7));
+  program.push_back(make_instruction<double>(
+      OpCode::applyX, 0, 6, 0.2, 0.9));
+  program.push_back(make_instruction<double>(
+      OpCode::applyZ, 0, 1, 0, 0, -0.5));
+  program.push_back(make_instruction<double>(
+      OpCode::applyX, 0, 2, 0.5, 0.5));
+
+  qengine::OptimizationReport report;
+  const auto optimized = qengine::optimize(program, &report);
+
+  // X(6) moves in front of the three phases, which become one diagonal
+  ASSERT_EQ(optimized.size(), 5);
+  EXPECT_EQ(optimized[2].op, OpCode::applyX);
+  EXPECT_EQ(optimized[2].i, 6);
+  EXPECT_EQ(optimized[3].op, OpCode::applyDiagonal);
+  EXPECT_EQ(report.diagonal_after, 1);
+  expect_same_state(program, optimized, 1, dim);
+}
+
+TEST_F(OptimizerTests, random_programs) {
+  using qengine::OpCode;
+  const uint64_t nreg = 2;
+  const uint64_t dim = 6;
+  std::mt19937 mte(11);
+  std::uniform_int_distribution<int> kind(0, 9);
+  std::uniform_int_distribution<uint64_t> reg(0, nreg - 1);
+  std::uniform_int_distribution<uint64_t> level(1, dim - 1);
+  std::uniform_real_distribution<double> value(-1.0, 1.0);
+
+  for (int trial = 0; trial < 50; ++trial) {
+    qengine::Program<double> program;
+    for (int k = 0; k < 60; ++k) {
+      const uint64_t r = reg(mte);
+      const uint64_t i = level(mte);
+      switch (kind(mte)) {
+      case 0:
+      case 1:
+      case 2:
+        program.push_back(make_instruction<double>(
+            OpCode::applyX, r, i, value(mte), value(mte)));
+        break;
+      case 3:
+        // repeat the previous instruction, inverted if it is a rotation
+        program.push_back(
+            program.empty()
+                ? make_instruction<double>(OpCode::applyZ, r, i)
+                : program.back());
+        if (program.back().op == OpCode::applyX)
+          program.back().op = OpCode::applyXconjugate;
+        break;
+      case 4:
+      case 5:
+        program.push_back(make_instruction<double>(
+            OpCode::applyZ, r, i - 1, 0, 0, value(mte)));
+        break;
+      case 6:
+        program.push_back(make_instruction<double>(
+            OpCode::applyZconjugate, r, i, 0, 0, value(mte)));
+        break;
+      case 7:
+        program.push_back(make_instruction<double>(
+            OpCode::measure, r, r));
+        break;
+      default:
+        program.push_back(make_instruction<double>(
+            OpCode::applyXconjugate, r, i, value(mte), value(mte)));
+        break;
+      }
+    }
+
+    qengine::OptimizationReport report;
+    const auto optimized = qengine::optimize(program, &report);
+    EXPECT_LE(optimized.size(), program.size());
+    EXPECT_EQ(report.gates_after, optimized.size());
+    expect_same_state(program, optimized, nreg, dim);
+  }
+}
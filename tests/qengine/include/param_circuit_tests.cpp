@@ -0,0 +1,91 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "instruction.h"
+#include "param_circuit.h"
+#include "types.h"
+
+class ParamCircuitTests : public ::testing::Test {
+protected:
+  qengine::ParamCircuit<double> ansatz() const {
+    qengine::ParamCircuit<double> circuit(2, 4);
+    qengine::Instruction<double> fixed{};
+    fixed.op = qengine::OpCode::applyX;
+    fixed.i = 2;
+    fixed.x = std::complex<double>(0.3, 0.4);
+    fixed.y = std::complex<double>(0.0, 1.0);
+
+    circuit.applyXparam(0, 1, 0);
+    circuit.applyZparam(0, 1, 1);
+    circuit.append(fixed);
+    circuit.applyXparam(0, 2, 2);
+    circuit.applyZparam(0, 2, 1);
+    circuit.applyXparam(0, 3, 0);
+    circuit.applyXparam(1, 1, 3);
+    circuit.applyXparam(1, 2, 2);
+    return circuit;
+  }
+};
+
+TEST_F(ParamCircuitTests, bind) {
+  qengine::ParamCircuit<double> circuit(1, 3);
+  circuit.applyXparam(0, 1, 0);
+  circuit.applyZparam(0, 1, 1);
+
+  const auto program = circuit.bind({M_PI / 2, 0.25});
+  EXPECT_EQ(circuit.nparams(), 2);
+  EXPECT_NEAR(std::abs(program[0].y - 1.0), 0.0, 1e-12);
+  EXPECT_EQ(program[1].tau, 0.25);
+
+  const auto qregs = circuit.run({M_PI / 2, 0.25});
+  EXPECT_NEAR(qregs[0].probabilities()[1], 1.0, 1e-12);
+}
+
+TEST_F(ParamCircuitTests, gradient_matches_finite_differences) {
+  const auto circuit = ansatz();
+  const std::vector<qengine::RVec<double>> observables = {
+    {0.0, 1.0, -2.0, 0.5}, {1.0, 0.0, 3.0, 0.0}};
+  const std::vector<double> params = {0.4, -1.1, 0.9, 2.0};
+
+  double value = 0.0;
+  const auto grad = circuit.gradient(params, observables, &value);
+  EXPECT_NEAR(value, circuit.expectation(params, observables), 1e-12);
+
+  ASSERT_EQ(grad.size(), params.size());
+  const double h = 1e-6;
+  for (uint64_t k = 0; k < params.size(); ++k) {
+    auto plus = params;
+    auto minus = params;
+    plus[k] += h;
+    minus[k] -= h;
+    const double fd = (circuit.expectation(plus, observables)
+                       - circuit.expectation(minus, observables)) / (2 * h);
+    EXPECT_NEAR(grad[k], fd, 1e-7);
+  }
+}
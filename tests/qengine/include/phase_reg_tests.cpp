@@ -0,0 +1,122 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "phase_reg.h"
+#include "qreg.h"
+
+class PhaseOnlyRegTests : public ::testing::Test {
+protected:
+  // F0 of examples/example.cpp: |0> to the uniform superposition.
+  static void f0(uint64_t dim, std::vector<double>& x,
+                 std::vector<double>& y) {
+    x.assign(dim - 1, std::sqrt(1.0 / dim));
+    y.resize(dim - 1);
+    for (uint64_t i = 1; i < dim; ++i)
+      y[i - 1] = std::sqrt(static_cast<double>(dim - i) / dim);
+  }
+};
+
+TEST_F(PhaseOnlyRegTests, matches_qreg) {
+  const uint64_t dim = 37;
+  std::vector<double> x, y;
+  f0(dim, x, y);
+  qengine::QReg<double> qreg(dim);
+  qreg.apply_givens_ladder(x, y);
+  qengine::PhaseOnlyReg<double> reg(dim);
+
+  std::vector<double> tau(dim);
+  for (uint64_t i = 0; i < dim; ++i)
+    tau[i] = 0.1 * i * i;
+  qreg.applyZ(3, 0.4);
+  qreg.applyZconjugate(5, 1.1);
+  qreg.applyPhaseLinear(0.25, 0.5);
+  qreg.applyPhasePolynomial({0.1, -0.3, 0.02});
+  qreg.applyPhaseLinearConjugate(0.05);
+  qreg.applyDiagonal(tau);
+  reg.applyZ(3, 0.4);
+  reg.applyZconjugate(5, 1.1);
+  reg.applyPhaseLinear(0.25, 0.5);
+  reg.applyPhasePolynomial({0.1, -0.3, 0.02});
+  reg.applyPhaseLinearConjugate(0.05);
+  reg.applyDiagonal(tau);
+
+  EXPECT_FALSE(reg.expanded());
+  EXPECT_EQ(reg.phases().size(), dim);
+  for (uint64_t i = 0; i < dim; ++i)
+    EXPECT_NEAR(std::abs(reg.amplitude(i) - qreg.data()[i]), 0.0, 1e-12);
+
+  qreg.applyX(4, 0.3, 0.8);
+  reg.applyX(4, 0.3, 0.8);
+  EXPECT_TRUE(reg.expanded());
+  EXPECT_TRUE(reg.phases().empty());
+  for (uint64_t i = 0; i < dim; ++i)
+    EXPECT_NEAR(std::abs(reg.amplitude(i) - qreg.data()[i]), 0.0, 1e-12);
+}
+
+// The reverse test of the hash circuit: the probability of 0 after
+// F0^dagger is the overlap with the unphased register.
+TEST_F(PhaseOnlyRegTests, reverse_test) {
+  const uint64_t dim = 64;
+  const double n = 97;
+  std::vector<double> x, y;
+  f0(dim, x, y);
+
+  for (double b : {5.0, 40.0}) {
+    qengine::PhaseOnlyReg<double> reg(dim);
+    reg.applyPhaseLinear(5.0 / n);
+    reg.applyPhaseLinearConjugate(b / n);
+    const auto overlap = qengine::PhaseOnlyReg<double>(dim).braket_product(reg);
+
+    reg.apply_givens_ladder_conjugate(x, y);
+    EXPECT_TRUE(reg.expanded());
+    EXPECT_NEAR(reg.probabilities()[0], std::norm(overlap), 1e-12);
+    if (b == 5.0)
+      EXPECT_NEAR(std::norm(overlap), 1.0, 1e-12);
+    else
+      EXPECT_LT(std::norm(overlap), 0.9);
+  }
+}
+
+TEST_F(PhaseOnlyRegTests, copies) {
+  qengine::PhaseOnlyReg<float> reg({0.6f, 0.8f});
+  auto copy = reg;
+  EXPECT_EQ(copy.magnitudes().data(), reg.magnitudes().data());
+
+  copy.applyX(1, 0.0f, 1.0f);
+  EXPECT_TRUE(copy.expanded());
+  EXPECT_FALSE(reg.expanded());
+  EXPECT_NEAR(reg.probabilities()[0], 0.36f, 1e-6f);
+  EXPECT_NEAR(copy.probabilities()[0], 0.64f, 1e-6f);
+
+  // phases stay reduced, so float keeps its accuracy over many gates
+  for (int k = 0; k < 100000; ++k)
+    reg.applyZ(1, 0.1);
+  EXPECT_LT(std::abs(reg.phases()[1]), 3.15f);
+  EXPECT_NEAR(reg.phases()[1], std::remainder(10000.0, 2 * M_PI), 1e-2);
+}
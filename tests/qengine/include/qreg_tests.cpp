@@ -20,6 +20,11 @@
 // CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "qreg.h"
@@ -74,3 +79,122 @@ TEST_F(QRegTests, applyX) {
 
   EXPECT_EQ(a.probabilities(), probs);
 }
+
+TEST_F(QRegTests, large_register) {
+  const uint64_t dim = 4 * qengine::kParallelThreshold;
+  qengine::QReg<double> a(dim);
+  for (uint64_t i = 1; i < dim; ++i)
+    a.applyX(i, 1.0, std::sqrt(double(dim - i)));
+  qengine::QReg<double> b(a);
+  b.normalize();
+
+  EXPECT_NEAR(a.braket_product(b).real(), 1.0, 1e-9);
+  EXPECT_NEAR(a.probabilities()[dim - 1], 1.0 / dim, 1e-12);
+}
+
+TEST_F(QRegTests, tracked_probabilities) {
+  qengine::QReg<double> a(5);
+  qengine::QReg<double> b(5);
+  b.track_probabilities();
+  for (uint64_t k = 0; k < 20; ++k) {
+    const uint64_t i = 1 + k % 4;
+    a.applyX(i, 1.0, 0.5 + k);
+    b.applyX(i, 1.0, 0.5 + k);
+    a.applyZ(i, 0.3);
+    b.applyZ(i, 0.3);
+  }
+  qengine::QReg<double> c(b);
+
+  const auto expected = a.probabilities();
+  const auto tracked = c.probabilities();
+  ASSERT_TRUE(c.tracks_probabilities());
+  for (uint64_t i = 0; i < 5; ++i)
+    EXPECT_NEAR(tracked[i], expected[i], 1e-12);
+
+  std::mt19937 mte(3);
+  std::vector<uint64_t> counts(5);
+  for (int k = 0; k < 20000; ++k)
+    ++counts[c.sample(mte)];
+  for (uint64_t i = 0; i < 5; ++i)
+    EXPECT_NEAR(counts[i] / 20000.0, expected[i], 0.02);
+}
+
+TEST_F(QRegTests, givens_ladder) {
+  const uint64_t dim = 6;
+  qengine::QReg<double> a(dim);
+  qengine::QReg<double> b(dim);
+  a.applyX(2, 0.3, 0.7);
+  a.applyZ(3, 0.4);
+  b.applyX(2, 0.3, 0.7);
+  b.applyZ(3, 0.4);
+
+  qengine::CVec<double> x, y;
+  for (uint64_t i = 1; i < dim; ++i) {
+    x.emplace_back(0.5 + i, 0.1 * i);
+    y.emplace_back(1.0, -0.2 * i);
+  }
+  for (uint64_t i = 1; i < dim; ++i)
+    a.applyX(i, x[i - 1], y[i - 1]);
+  b.apply_givens_ladder(x, y);
+  for (uint64_t i = 0; i < dim; ++i)
+    EXPECT_NEAR(std::abs(a.data()[i] - b.data()[i]), 0.0, 1e-12);
+
+  for (uint64_t i = dim - 1; i > 0; --i)
+    a.applyXconjugate(i, x[i - 1], y[i - 1]);
+  b.apply_givens_ladder_conjugate(x, y);
+  for (uint64_t i = 0; i < dim; ++i)
+    EXPECT_NEAR(std::abs(a.data()[i] - b.data()[i]), 0.0, 1e-12);
+}
+
+TEST_F(QRegTests, prepare_state) {
+  const uint64_t dim = 5;
+  qengine::RVec<double> x(dim - 1, std::sqrt(1.0 / dim));
+  qengine::RVec<double> y(dim - 1);
+  for (uint64_t i = 1; i < dim; ++i)
+    y[i - 1] = std::sqrt(static_cast<double>(dim - i) / dim);
+  qengine::QReg<double> a(dim);
+  a.apply_givens_ladder(x, y);
+
+  qengine::QReg<double> b(dim);
+  b.prepare_state(qengine::CVec<double>(dim, 1.0));
+  EXPECT_NEAR(std::abs(a.braket_product(b)), 1.0, 1e-12);
+
+  b.apply_givens_ladder_conjugate(x, y);
+  EXPECT_NEAR(b.probabilities()[0], 1.0, 1e-12);
+}
+
+TEST_F(QRegTests, phase_polynomial) {
+  const uint64_t dim = 1000;
+  qengine::QReg<double> a(dim);
+  a.prepare_state(qengine::CVec<double>(dim, 1.0));
+  qengine::QReg<double> b(a);
+
+  const qengine::RVec<double> coeffs({0.3, 1.7, -0.02, 1e-5});
+  for (uint64_t i = 0; i < dim; ++i) {
+    const double k = static_cast<double>(i);
+    a.applyZ(i, coeffs[0] + coeffs[1] * k + coeffs[2] * k * k
+                + coeffs[3] * k * k * k);
+  }
+  b.applyPhasePolynomial(coeffs);
+  for (uint64_t i = 0; i < dim; ++i)
+    EXPECT_NEAR(std::abs(a.data()[i] - b.data()[i]), 0.0, 1e-10);
+
+  for (uint64_t i = 0; i < dim; ++i)
+    a.applyZconjugate(i, 0.5 + 2.5 * static_cast<double>(i));
+  b.applyPhaseLinearConjugate(2.5, 0.5);
+  for (uint64_t i = 0; i < dim; ++i)
+    EXPECT_NEAR(std::abs(a.data()[i] - b.data()[i]), 0.0, 1e-10);
+}
+
+TEST_F(QRegTests, phase_fused) {
+  const uint64_t dim = 300;
+  qengine::QReg<double> a(dim);
+  a.prepare_state(qengine::CVec<double>(dim, 1.0));
+  qengine::QReg<double> b(a);
+
+  a.applyPhaseLinear(15.0 / 8);
+  a.applyPhaseLinearConjugate(13.0 / 8);
+  b.applyPhasePolynomial({0.0, 15.0 / 8}, {0.0, 13.0 / 8});
+  for (uint64_t i = 0; i < dim; ++i)
+    EXPECT_NEAR(std::abs(a.data()[i] - b.data()[i]), 0.0, 1e-12);
+}
@@ -0,0 +1,162 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "instruction.h"
+#include "sweep.h"
+#include "test_instructions.h"
+
+class SweepTests : public ::testing::Test {
+protected:
+  // The hash reverse-test of examples/example.cpp: F0, phases for word a,
+  // inverse phases for word b, F0^dagger, measure. dim depends on eps only.
+  qengine::SweepTemplate<double> hash_test() {
+    qengine::SweepTemplate<double> tmpl;
+    tmpl.structure = [](const qengine::ParamPoint& p) {
+      return static_cast<uint64_t>(std::llround(8 / (p["eps"] * p["eps"])));
+    };
+    tmpl.compile = [this, tmpl](const qengine::ParamPoint& p) {
+      ++ncompile;
+      const uint64_t dim = tmpl.structure(p);
+      qengine::CompiledCircuit<double> res{1, dim, {}};
+      for (uint64_t i = 1; i < dim; ++i)
+        res.program.push_back(make_instruction<double>(
+            qengine::OpCode::applyX, 0, i, std::sqrt(1.0 / dim),
+            std::sqrt(double(dim - i) / dim)));
+      for (uint64_t i = 0; i < dim; ++i)
+        res.program.push_back(make_instruction<double>(
+            qengine::OpCode::applyZ, 0, i, 0.0, 0.0));
+      for (uint64_t i = dim; i-- > 0;)
+        res.program.push_back(make_instruction<double>(
+            qengine::OpCode::applyZconjugate, 0, i, 0.0, 0.0));
+      for (uint64_t i = dim - 1; i > 0; --i)
+        res.program.push_back(make_instruction<double>(
+            qengine::OpCode::applyXconjugate, 0, i, std::sqrt(1.0 / dim),
+            std::sqrt(double(dim - i) / dim)));
+      res.program.push_back(make_instruction<double>(
+          qengine::OpCode::measure, 0, 0, 0.0, 0.0));
+      return res;
+    };
+    tmpl.bind = [](const qengine::ParamPoint& p,
+                   qengine::Program<double>& program) {
+      for (auto & ins : program) {
+        if (ins.op == qengine::OpCode::applyZ)
+          ins.tau = p["a"] * ins.i / 8;
+        else if (ins.op == qengine::OpCode::applyZconjugate)
+          ins.tau = p["b"] * ins.i / 8;
+      }
+    };
+    return tmpl;
+  }
+
+  std::atomic<uint64_t> ncompile{0};
+};
+
+TEST_F(SweepTests, grid) {
+  qengine::ParamGrid grid;
+  grid.add_axis("a", {1.0, 2.0}).add_axis("b", {3.0, 4.0, 5.0});
+
+  ASSERT_EQ(grid.size(), 6);
+  const auto p = grid.point(4);
+  EXPECT_EQ(p["a"], 2.0);
+  EXPECT_EQ(p["b"], 4.0);
+  EXPECT_EQ(p.values(), std::vector<double>({2.0, 4.0}));
+}
+
+TEST_F(SweepTests, reuses_structure) {
+  qengine::ParamGrid grid;
+  grid.add_axis("eps", {0.5, 0.8})
+      .add_axis("a", {3.0, 7.0, 15.0})
+      .add_axis("b", {3.0, 15.0});
+
+  std::ostringstream out;
+  qengine::BinarySink sink(out, 3);
+  qengine::SweepExecutor<double> sweep(hash_test(), 3);
+  sweep.run(grid, sink);
+
+  EXPECT_EQ(sweep.ncompiled(), 2);
+  EXPECT_EQ(ncompile, 2);
+
+  std::istringstream in(out.str());
+  const auto records = qengine::read_sweep_records(in);
+  ASSERT_EQ(records.size(), grid.size());
+  for (const auto & record : records) {
+    ASSERT_EQ(record.values.size(), 1);
+    if (record.params[1] == record.params[2]) {
+      EXPECT_EQ(record.values[0], 0.0);
+    }
+    EXPECT_EQ(record.params, grid.point(record.index).values());
+  }
+}
+
+TEST_F(SweepTests, retries_failed_compile) {
+  qengine::ParamGrid grid;
+  grid.add_axis("eps", {0.5}).add_axis("a", {3.0}).add_axis("b", {3.0});
+
+  auto tmpl = hash_test();
+  const auto compile = tmpl.compile;
+  bool fail = true;
+  tmpl.compile = [compile, &fail](const qengine::ParamPoint& p) {
+    if (fail)
+      throw std::runtime_error("compile failed");
+    return compile(p);
+  };
+
+  std::ostringstream out;
+  qengine::BinarySink sink(out, 3);
+  qengine::SweepExecutor<double> sweep(tmpl, 1);
+  EXPECT_THROW(sweep.run(grid, sink), std::runtime_error);
+  EXPECT_EQ(sweep.ncompiled(), 0);
+
+  fail = false;
+  sweep.run(grid, sink);
+  EXPECT_EQ(sweep.ncompiled(), 1);
+  EXPECT_EQ(ncompile, 1);
+}
+
+TEST_F(SweepTests, csv_sink) {
+  qengine::ParamGrid grid;
+  grid.add_axis("eps", {0.5}).add_axis("a", {1.0, 2.0}).add_axis("b", {1.0});
+
+  std::ostringstream out;
+  qengine::CsvSink sink(out, grid.names(), {"result"});
+  qengine::SweepExecutor<double> sweep(hash_test(), 1);
+  sweep.run(grid, sink);
+
+  std::istringstream in(out.str());
+  std::string line;
+  std::getline(in, line);
+  EXPECT_EQ(line, "index,eps,a,b,result");
+  uint64_t nlines = 0;
+  while (std::getline(in, line))
+    ++nlines;
+  EXPECT_EQ(nlines, 2);
+}
@@ -0,0 +1,198 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cmath>
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include "circuit.h"
+#include "instruction.h"
+#include "synthesis.h"
+#include "test_instructions.h"
+
+class SynthesisTests : public ::testing::Test {
+protected:
+  // Compiled operator and replay agree on a non-trivial start state.
+  static void expect_equivalent(const qengine::Program<double>& program,
+                                uint64_t dim) {
+    qengine::Program<double> prepare;
+    for (uint64_t i = 1; i < dim; ++i)
+      prepare.push_back(make_instruction<double>(
+          qengine::OpCode::applyX, 0, i, 0.4 + i, 1.0));
+    prepare.push_back(make_instruction<double>(
+        qengine::OpCode::applyZ, 0, 1, 0, 0, 0.7));
+
+    const auto op = qengine::synthesize(program, dim);
+    qengine::Circuit<double> expected(1, dim);
+    qengine::Circuit<double> actual(1, dim);
+    qengine::execute(expected, prepare);
+    qengine::execute(actual, prepare);
+    qengine::replay(expected, 0, program);
+    qengine::apply_operator(actual, 0, op, program);
+    for (uint64_t i = 0; i < dim; ++i)
+      EXPECT_NEAR(std::abs(actual.qregs()[0].data()[i]
+                           - expected.qregs()[0].data()[i]), 0.0, 1e-12);
+  }
+};
+
+TEST_F(SynthesisTests, diagonal) {
+  const uint64_t dim = 16;
+  qengine::Program<double> program;
+  for (int rep = 0; rep < 3; ++rep)
+    for (uint64_t i = 0; i < dim; ++i)
+      program.push_back(make_instruction<double>(
+          qengine::OpCode::applyZ, 0, i, 0, 0, 0.1 * i));
+
+  const auto op = qengine::synthesize(program, dim);
+  EXPECT_EQ(op.kind, qengine::OperatorKind::diagonal);
+  EXPECT_LT(op.cost, op.replay_cost);
+  expect_equivalent(program, dim);
+}
+
+TEST_F(SynthesisTests, permutation) {
+  const uint64_t dim = 8;
+  qengine::Program<double> program;
+  for (uint64_t i = 1; i < dim; ++i)
+    program.push_back(make_instruction<double>(
+        qengine::OpCode::applyX, 0, i, 0.0, 1.0));
+  program.push_back(make_instruction<double>(
+      qengine::OpCode::applyZ, 0, 3, 0, 0, 0.5));
+
+  const auto op = qengine::synthesize(program, dim);
+  EXPECT_EQ(op.kind, qengine::OperatorKind::permutation);
+  expect_equivalent(program, dim);
+}
+
+TEST_F(SynthesisTests, banded) {
+  const uint64_t dim = 64;
+  qengine::Program<double> program;
+  for (int rep = 0; rep < 4; ++rep)
+    for (uint64_t i = 1 + rep % 2; i < dim; i += 2)
+      program.push_back(make_instruction<double>(
+          qengine::OpCode::applyX, 0, i, 0.3, 0.2 + rep));
+
+  const auto op = qengine::synthesize(program, dim);
+  EXPECT_EQ(op.kind, qengine::OperatorKind::banded);
+  EXPECT_EQ(op.kl, 4);
+  EXPECT_EQ(op.ku, 4);
+  expect_equivalent(program, dim);
+}
+
+TEST_F(SynthesisTests, dense) {
+  const uint64_t dim = 4;
+  qengine::Program<double> program;
+  for (int rep = 0; rep < 4; ++rep) {
+    for (uint64_t i = 1; i < dim; ++i)
+      program.push_back(make_instruction<double>(
+          qengine::OpCode::applyX, 0, i, 0.5, 0.3 + rep));
+    for (uint64_t i = dim - 1; i > 0; --i)
+      program.push_back(make_instruction<double>(
+          qengine::OpCode::applyX, 0, i, 0.2, 0.9));
+  }
+
+  const auto op = qengine::synthesize(program, dim);
+  EXPECT_EQ(op.kind, qengine::OperatorKind::dense);
+  expect_equivalent(program, dim);
+}
+
+TEST_F(SynthesisTests, replay) {
+  const uint64_t dim = 64;
+  qengine::Program<double> program;
+  program.push_back(make_instruction<double>(
+      qengine::OpCode::applyX, 0, 5, 0.3, 0.4));
+
+  const auto op = qengine::synthesize(program, dim);
+  EXPECT_EQ(op.kind, qengine::OperatorKind::replay);
+  EXPECT_FALSE(op.profitable());
+  expect_equivalent(program, dim);
+}
+
+TEST_F(SynthesisTests, lone_gate) {
+  // diagonal, but applying it is no dearer than synthesizing it
+  const uint64_t dim = 32;
+  qengine::CMat<double> mat(dim);
+  for (uint64_t i = 0; i < dim; ++i)
+    mat(i, i) = std::polar(1.0, 0.1 * i);
+  qengine::Instruction<double> ins{};
+  ins.op = qengine::OpCode::apply;
+  ins.mat = mat;
+  const qengine::Program<double> program = {ins};
+
+  const auto op = qengine::synthesize(program, dim);
+  EXPECT_EQ(op.kind, qengine::OperatorKind::replay);
+  expect_equivalent(program, dim);
+}
+
+TEST_F(SynthesisTests, storage_cap) {
+  // beats replay as a dense matrix, but would store dim^2 entries
+  const uint64_t dim = 1 << 10;
+  qengine::Program<double> program;
+  for (int rep = 0; rep < 60; ++rep)
+    for (uint64_t i = 1; i < dim; ++i)
+      program.push_back(make_instruction<double>(
+          qengine::OpCode::applyX, 0, i, 0.5, 0.3 + rep));
+  ASSERT_GT(qengine::replay_cost(program, dim),
+            dim * dim + qengine::kGateOverhead);
+
+  const auto op = qengine::synthesize(program, dim);
+  EXPECT_EQ(op.kind, qengine::OperatorKind::replay);
+  EXPECT_EQ(op.mat.size(), 0);
+}
+
+TEST_F(SynthesisTests, cache) {
+  const uint64_t dim = 16;
+  qengine::Program<double> program;
+  for (uint64_t i = 0; i < dim; ++i)
+    program.push_back(make_instruction<double>(
+        qengine::OpCode::applyZ, 0, i, 0, 0, 0.2 * i));
+  program.push_back(make_instruction<double>(
+      qengine::OpCode::applyZ, 0, 0, 0, 0, 0.1));
+
+  qengine::SynthesisCache<double> cache;
+  const auto a = cache.compile(program, dim);
+  auto other_register = program;
+  for (auto & ins : other_register)
+    ins.idx_qreg = 1;
+  const auto b = cache.compile(other_register, dim);
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(cache.hits(), 1);
+  EXPECT_EQ(cache.misses(), 1);
+
+  program.back().tau = 0.2;
+  EXPECT_NE(cache.compile(program, dim), a);
+  EXPECT_EQ(cache.size(), 2);
+
+  qengine::Circuit<double> expected(2, dim);
+  qengine::Circuit<double> actual(2, dim);
+  for (uint64_t r = 0; r < 2; ++r) {
+    expected.applyX(r, 1, 0.3, 0.6);
+    actual.applyX(r, 1, 0.3, 0.6);
+    qengine::replay(expected, r, program);
+    cache.apply(actual, r, program);
+  }
+  EXPECT_EQ(cache.hits(), 3);
+  for (uint64_t r = 0; r < 2; ++r)
+    for (uint64_t i = 0; i < dim; ++i)
+      EXPECT_NEAR(std::abs(actual.qregs()[r].data()[i]
+                           - expected.qregs()[r].data()[i]), 0.0, 1e-12);
+}
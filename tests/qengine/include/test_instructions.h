@@ -0,0 +1,46 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QENGINE_TESTS_INCLUDE_TEST_INSTRUCTIONS_H_
+#define QENGINE_TESTS_INCLUDE_TEST_INSTRUCTIONS_H_
+
+#include <cstdint>
+
+#include "instruction.h"
+#include "types.h"
+
+// Gate or measure record; fields the opcode does not read stay zero.
+template <typename T>
+qengine::Instruction<T> make_instruction(
+    qengine::OpCode op, uint64_t idx_qreg, uint64_t i,
+    qengine::Cmplx<T> x = 0.0, qengine::Cmplx<T> y = 0.0, double tau = 0.0) {
+  qengine::Instruction<T> ins{};
+  ins.op = op;
+  ins.idx_qreg = idx_qreg;
+  ins.i = i;
+  ins.x = x;
+  ins.y = y;
+  ins.tau = tau;
+  return ins;
+}
+
+#endif // QENGINE_TESTS_INCLUDE_TEST_INSTRUCTIONS_H_
@@ -0,0 +1,128 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "density_reg.h"
+#include "instruction.h"
+#include "trajectory.h"
+
+class TrajectoryTests : public ::testing::Test {
+protected:
+  qengine::Instruction<double> applyX(uint64_t i, double x, double y) const {
+    qengine::Instruction<double> ins{};
+    ins.op = qengine::OpCode::applyX;
+    ins.i = i;
+    ins.x = x;
+    ins.y = y;
+    return ins;
+  }
+
+  qengine::Instruction<double> op(qengine::OpCode code, uint64_t i) const {
+    qengine::Instruction<double> ins = applyX(i, 1.0, 1.0);
+    ins.op = code;
+    return ins;
+  }
+};
+
+TEST_F(TrajectoryTests, noiseless) {
+  qengine::TrajectoryEngine<double> engine(1, 3, {0.0, 0.0}, 2);
+  qengine::Program<double> program = {
+    applyX(1, 0.0, 1.0), applyX(2, 0.0, 1.0),
+    op(qengine::OpCode::measure, 0)};
+
+  const auto histogram = engine.run(program, 100);
+
+  ASSERT_EQ(histogram.size(), 1);
+  EXPECT_EQ(histogram.at({2}), 100);
+}
+
+TEST_F(TrajectoryTests, damping) {
+  qengine::TrajectoryEngine<double> engine(1, 3, {0.0, 1.0}, 2);
+  qengine::Program<double> program = {
+    applyX(1, 0.0, 1.0), op(qengine::OpCode::measure, 0)};
+
+  EXPECT_EQ(engine.run(program, 50).at({0}), 50);
+}
+
+TEST_F(TrajectoryTests, threads) {
+  qengine::Program<double> program = {
+    applyX(1, 1.0, 1.0), applyX(2, 1.0, 2.0),
+    op(qengine::OpCode::applyZ, 1), op(qengine::OpCode::applyZ, 2),
+    applyX(2, 1.0, 1.0), op(qengine::OpCode::measure, 0)};
+
+  qengine::TrajectoryEngine<double> serial(1, 3, {0.1, 0.2}, 1);
+  qengine::TrajectoryEngine<double> parallel(1, 3, {0.1, 0.2}, 4);
+
+  EXPECT_EQ(serial.run(program, 500, 7), parallel.run(program, 500, 7));
+}
+
+TEST_F(TrajectoryTests, dephasing_matches_density) {
+  const double p = 0.25;
+  const uint64_t ntraj = 4000;
+  qengine::Program<double> program = {
+    applyX(1, 1.0, 1.0), op(qengine::OpCode::applyZ, 1),
+    op(qengine::OpCode::applyXconjugate, 1), op(qengine::OpCode::measure, 0)};
+  program[1].tau = 0.0;
+
+  qengine::DensityReg<double> rho(2);
+  rho.applyX(1, 1.0, 1.0);
+  rho.dephase(1, p);
+  rho.applyXconjugate(1, 1.0, 1.0);
+
+  qengine::TrajectoryEngine<double> engine(1, 2, {p, 0.0});
+  const auto histogram = engine.run(program, ntraj);
+  const double p_1 = static_cast<double>(histogram.at({1})) / ntraj;
+
+  EXPECT_NEAR(rho.probabilities()[1], p, 1e-12);
+  EXPECT_NEAR(p_1, p, 0.03);
+}
+
+TEST_F(TrajectoryTests, damping_matches_density) {
+  // consecutive damping steps on an unnormalized register
+  const double gamma = 0.3;
+  const uint64_t ntraj = 4000;
+  qengine::Program<double> program = {
+    applyX(1, 1.0, 1.0), applyX(2, 1.0, 1.0), applyX(1, 1.0, 2.0),
+    op(qengine::OpCode::measure, 0)};
+
+  qengine::DensityReg<double> rho(3);
+  rho.applyX(1, 1.0, 1.0);
+  rho.damp(1, gamma);
+  rho.applyX(2, 1.0, 1.0);
+  rho.damp(2, gamma);
+  rho.applyX(1, 1.0, 2.0);
+  rho.damp(1, gamma);
+
+  qengine::TrajectoryEngine<double> engine(1, 3, {0.0, gamma});
+  const auto histogram = engine.run(program, ntraj);
+  const auto expected = rho.probabilities();
+  for (qengine::CReg level = 0; level < 3; ++level) {
+    const auto it = histogram.find({level});
+    const double p = it == histogram.end()
+                   ? 0.0 : static_cast<double>(it->second) / ntraj;
+    EXPECT_NEAR(p, expected[level], 0.03);
+  }
+}
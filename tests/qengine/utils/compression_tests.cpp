@@ -0,0 +1,89 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "compression.h"
+
+class CompressionTests : public ::testing::Test {
+protected:
+  static std::vector<std::complex<double>> sample(uint64_t n) {
+    std::vector<std::complex<double>> a(n);
+    for (uint64_t k = 0; k < n; k += 3)
+      a[k] = std::complex<double>(std::sin(0.1 * k), std::cos(0.3 * k)) / 20.0;
+    return a;
+  }
+};
+
+TEST_F(CompressionTests, rle) {
+  std::vector<uint8_t> data;
+  for (int k = 0; k < 300; ++k)
+    data.push_back(7);
+  for (int k = 0; k < 200; ++k)
+    data.push_back(static_cast<uint8_t>(k));
+  data.insert(data.end(), {1, 1, 2, 2, 2});
+
+  const auto encoded = qengine::rle_encode(data.data(), data.size());
+  EXPECT_LT(encoded.size(), data.size());
+  EXPECT_EQ(qengine::rle_decode(encoded, data.size()), data);
+  EXPECT_TRUE(qengine::rle_encode(data.data(), 0).empty());
+}
+
+TEST_F(CompressionTests, lossless) {
+  const uint64_t n = 1000;
+  const auto a = sample(n);
+  const auto block = qengine::compress(a.data(), n);
+  EXPECT_EQ(block.codec, qengine::Codec::lossless);
+  EXPECT_LT(block.bytes.size(), n * sizeof(a[0]));
+
+  std::vector<std::complex<double>> b(n);
+  qengine::decompress(block, b.data());
+  EXPECT_EQ(a, b);
+
+  std::vector<std::complex<float>> basis(4096);
+  basis[0] = 1.0f;
+  const auto small = qengine::compress(basis.data(), basis.size());
+  EXPECT_LT(small.bytes.size(), basis.size() * sizeof(basis[0]) / 32);
+}
+
+TEST_F(CompressionTests, quantized) {
+  const uint64_t n = 1000;
+  const double tolerance = 1e-6;
+  const auto a = sample(n);
+  const auto block = qengine::compress(a.data(), n, tolerance);
+  EXPECT_EQ(block.codec, qengine::Codec::quantized);
+  EXPECT_LE(block.width, 3);
+  EXPECT_LT(block.bytes.size(),
+            qengine::compress(a.data(), n).bytes.size() / 2);
+
+  std::vector<std::complex<double>> b(n);
+  qengine::decompress(block, b.data());
+  for (uint64_t k = 0; k < n; ++k) {
+    EXPECT_LE(std::abs(a[k].real() - b[k].real()), tolerance);
+    EXPECT_LE(std::abs(a[k].imag() - b[k].imag()), tolerance);
+  }
+}
@@ -0,0 +1,89 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <complex>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "cpu_dispatch.h"
+
+class CpuDispatchTests : public ::testing::Test {
+protected:
+  template <typename T>
+  void compare(const qengine::kernel::Table<T>& table, T tol) const {
+    const uint64_t n = 37;
+    std::vector<std::complex<T>> a(n);
+    std::vector<std::complex<T>> b(n);
+    std::vector<T> r(n);
+    for (uint64_t k = 0; k < n; ++k) {
+      a[k] = std::complex<T>(T(0.1) * k, T(1) - T(0.05) * k);
+      b[k] = std::complex<T>(T(0.3), T(0.02) * k);
+      r[k] = T(0.5) * k;
+    }
+
+    std::complex<T> dot(0);
+    T norm = 0;
+    for (uint64_t k = 0; k < n; ++k) {
+      dot += std::conj(a[k]) * b[k];
+      norm += std::norm(a[k]);
+    }
+    EXPECT_NEAR(std::abs(table.dot_conj(a.data(), b.data(), n) - dot), 0, tol);
+    EXPECT_NEAR(table.norm2(a.data(), n), norm, tol);
+
+    const std::complex<T> alpha(T(0.5), T(-2));
+    auto y = b;
+    auto y_real = b;
+    table.axpy(alpha, a.data(), y.data(), n);
+    table.axpy_real(alpha, r.data(), y_real.data(), n);
+    table.scale(T(3), b.data(), n);
+    for (uint64_t k = 0; k < n; ++k) {
+      EXPECT_NEAR(std::abs(y[k] - (b[k] / T(3) + alpha * a[k])), 0, tol);
+      EXPECT_NEAR(std::abs(y_real[k] - (b[k] / T(3) + alpha * r[k])), 0, tol);
+    }
+  }
+};
+
+TEST_F(CpuDispatchTests, active_isa) {
+  const qengine::Isa isa = qengine::active_isa();
+
+  EXPECT_LE(static_cast<int>(isa), static_cast<int>(qengine::detect_isa()));
+  EXPECT_FALSE(std::string(qengine::isa_name(isa)).empty());
+}
+
+TEST_F(CpuDispatchTests, variants_agree) {
+  compare(qengine::kernel::Scalar<double>::table(), 1e-12);
+  compare(qengine::kernel::Scalar<float>::table(), 1e-3f);
+  compare(qengine::kernels<double>(), 1e-12);
+#ifdef QENGINE_HAS_DISPATCH
+  if (qengine::detect_isa() != qengine::Isa::scalar) {
+    compare(qengine::kernel::Avx2<double>::table(), 1e-12);
+    compare(qengine::kernel::Avx2<float>::table(), 1e-3f);
+  }
+  if (qengine::detect_isa() == qengine::Isa::avx512) {
+    compare(qengine::kernel::Avx512<double>::table(), 1e-12);
+    compare(qengine::kernel::Avx512<float>::table(), 1e-3f);
+  }
+#endif
+}
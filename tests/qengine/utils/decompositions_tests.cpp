@@ -0,0 +1,95 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <complex>
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include "decompositions.h"
+#include "types.h"
+
+class DecompositionsTests : public ::testing::Test {};
+
+TEST_F(DecompositionsTests, svd) {
+  using DCmplx = std::complex<double>;
+  using DCMat = qengine::Matrix<DCmplx>;
+
+  DCMat A(3, 2, { DCmplx(1.0, 2.0), DCmplx(0.5, 0.0), DCmplx(-1.0, 1.0),
+                  DCmplx(2.0, -1.0), DCmplx(0.0, 3.0), DCmplx(1.0, 1.0) });
+  const auto dec = qengine::svd(A);
+
+  ASSERT_EQ(dec.S.size(), 2);
+  EXPECT_GE(dec.S[0], dec.S[1]);
+
+  DCMat S(2, 2);
+  S(0, 0) = dec.S[0];
+  S(1, 1) = dec.S[1];
+  const DCMat B = dec.U * S * dec.Vh;
+  for (uint64_t j = 0; j < 2; ++j)
+    for (uint64_t i = 0; i < 3; ++i)
+      EXPECT_NEAR(std::abs(A(i, j) - B(i, j)), 0.0, 1e-12);
+
+  const DCMat UU = dec.U.dagger() * dec.U;
+  for (uint64_t j = 0; j < 2; ++j)
+    for (uint64_t i = 0; i < 2; ++i)
+      EXPECT_NEAR(std::abs(UU(i, j) - (i == j ? 1.0 : 0.0)), 0.0, 1e-12);
+}
+
+TEST_F(DecompositionsTests, svd_rank_one) {
+  using DCmplx = std::complex<double>;
+  using DCMat = qengine::Matrix<DCmplx>;
+
+  DCMat A(2, 2, {1.0, 1.0, 1.0, 1.0});
+  const auto dec = qengine::svd(A);
+
+  EXPECT_NEAR(dec.S[0], 2.0, 1e-12);
+  EXPECT_NEAR(dec.S[1], 0.0, 1e-12);
+}
+
+TEST_F(DecompositionsTests, eigh) {
+  using DCmplx = std::complex<double>;
+  using DCMat = qengine::Matrix<DCmplx>;
+
+  DCMat A(3, 3, { DCmplx(2.0, 0.0), DCmplx(1.0, -1.0), DCmplx(0.0, 0.5),
+                  DCmplx(1.0, 1.0), DCmplx(-1.0, 0.0), DCmplx(0.3, 0.0),
+                  DCmplx(0.0, -0.5), DCmplx(0.3, 0.0), DCmplx(0.5, 0.0) });
+  const auto dec = qengine::eigh(A);
+
+  ASSERT_EQ(dec.w.size(), 3);
+  EXPECT_LE(dec.w[0], dec.w[1]);
+  EXPECT_LE(dec.w[1], dec.w[2]);
+  EXPECT_NEAR(dec.w[0] + dec.w[1] + dec.w[2], 1.5, 1e-12);
+
+  DCMat W(3, 3);
+  for (uint64_t i = 0; i < 3; ++i)
+    W(i, i) = dec.w[i];
+  const DCMat B = dec.V * W * dec.V.dagger();
+  for (uint64_t j = 0; j < 3; ++j)
+    for (uint64_t i = 0; i < 3; ++i)
+      EXPECT_NEAR(std::abs(A(i, j) - B(i, j)), 0.0, 1e-12);
+
+  const DCMat VV = dec.V.dagger() * dec.V;
+  for (uint64_t j = 0; j < 3; ++j)
+    for (uint64_t i = 0; i < 3; ++i)
+      EXPECT_NEAR(std::abs(VV(i, j) - (i == j ? 1.0 : 0.0)), 0.0, 1e-12);
+}
@@ -0,0 +1,55 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "fenwick_tree.h"
+
+class FenwickTreeTests : public ::testing::Test {};
+
+TEST_F(FenwickTreeTests, prefix_sums) {
+  qengine::FenwickTree<double> tree({1.0, 2.0, 3.0, 4.0, 5.0});
+
+  EXPECT_EQ(tree.prefix_sum(0), 0.0);
+  EXPECT_EQ(tree.prefix_sum(3), 6.0);
+  EXPECT_EQ(tree.total(), 15.0);
+
+  tree.set(2, 0.5);
+  EXPECT_EQ(tree.prefix_sum(3), 3.5);
+  tree.add(4, 1.0);
+  EXPECT_EQ(tree.total(), 13.5);
+  EXPECT_EQ(tree.value(4), 6.0);
+}
+
+TEST_F(FenwickTreeTests, find) {
+  qengine::FenwickTree<double> tree({0.0, 1.0, 0.0, 2.0, 0.0, 0.0, 1.0});
+
+  EXPECT_EQ(tree.find(0.0), 1);
+  EXPECT_EQ(tree.find(0.99), 1);
+  EXPECT_EQ(tree.find(1.0), 3);
+  EXPECT_EQ(tree.find(2.5), 3);
+  EXPECT_EQ(tree.find(3.5), 6);
+  EXPECT_EQ(tree.find(10.0), 6);
+}
@@ -0,0 +1,101 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <complex>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "decompositions.h"
+#include "linalg_backend.h"
+#include "matrix.h"
+
+class LinalgBackendTests : public ::testing::Test {
+protected:
+  using DCmplx = std::complex<double>;
+
+  // Sizes straddle kGemmBlock and kBlasMinWork, so both the tiled edges
+  // and the vendor path are covered.
+  static qengine::Matrix<DCmplx> sample(uint64_t m, uint64_t n) {
+    qengine::Matrix<DCmplx> A(m, n);
+    for (uint64_t j = 0; j < n; ++j)
+      for (uint64_t i = 0; i < m; ++i)
+        A(i, j) = DCmplx(std::sin(0.3 * i + j), std::cos(0.7 * j - i));
+    return A;
+  }
+};
+
+TEST_F(LinalgBackendTests, backend_name) {
+  EXPECT_FALSE(std::string(qengine::backend_name()).empty());
+}
+
+TEST_F(LinalgBackendTests, gemm) {
+  const uint64_t m = 70, k = 130, n = 65;
+  const auto A = sample(m, k);
+  const auto B = sample(k, n);
+  const auto C = A * B;
+  ASSERT_EQ(C.nrows(), m);
+  ASSERT_EQ(C.ncols(), n);
+  for (uint64_t j = 0; j < n; ++j)
+    for (uint64_t i = 0; i < m; ++i) {
+      DCmplx expected = 0.0;
+      for (uint64_t l = 0; l < k; ++l)
+        expected += A(i, l) * B(l, j);
+      EXPECT_NEAR(std::abs(C(i, j) - expected), 0.0, 1e-10);
+    }
+
+  std::vector<float> a(m * k, 0.5f), b(k * n, 2.0f), c(m * n, 1.0f);
+  qengine::gemm(m, n, k, a.data(), b.data(), c.data());
+  for (auto v : c)
+    EXPECT_FLOAT_EQ(v, 1.0f + k);
+}
+
+TEST_F(LinalgBackendTests, tensor_times) {
+  const auto A = sample(3, 70);
+  const auto B = sample(80, 2);
+  const auto C = A.tensor_times(B);
+  ASSERT_EQ(C.nrows(), 240);
+  ASSERT_EQ(C.ncols(), 140);
+  for (uint64_t j = 0; j < 70; ++j)
+    for (uint64_t q = 0; q < 2; ++q)
+      for (uint64_t i = 0; i < 3; ++i)
+        for (uint64_t p = 0; p < 80; ++p)
+          EXPECT_EQ(C(i * 80 + p, j * 2 + q), A(i, j) * B(p, q));
+}
+
+TEST_F(LinalgBackendTests, decompositions) {
+  const uint64_t n = 24;
+  auto H = sample(n, n);
+  H = H + H.dagger();
+  const auto dec = qengine::eigh(H);
+  const auto ref = qengine::eigh_jacobi(H);
+  for (uint64_t k = 0; k < n; ++k)
+    EXPECT_NEAR(dec.w[k], ref.w[k], 1e-10);
+
+  const auto A = sample(30, n);
+  const auto svd = qengine::svd(A);
+  const auto svd_ref = qengine::svd_jacobi(A);
+  for (uint64_t k = 0; k < n; ++k)
+    EXPECT_NEAR(svd.S[k], svd_ref.S[k], 1e-10);
+}
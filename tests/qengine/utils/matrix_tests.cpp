@@ -103,6 +103,16 @@ TEST_F(MatrixTests, matrix_product) {
   EXPECT_EQ(A * B, C);
 }
 
+TEST_F(MatrixTests, matrix_product_equal) {
+  using DCMat = qengine::Matrix<std::complex<double>>;
+
+  DCMat A(2, 2, {1.0, 2.0, 3.0, 4.0});
+  DCMat B(2, 2, {0.0, 1.0, 1.0, 0.0});
+  A *= B;
+
+  EXPECT_EQ(A, DCMat (2, 2, {3.0, 4.0, 1.0, 2.0}));
+}
+
 TEST_F(MatrixTests, transpose) {
   using DCMat = qengine::Matrix<std::complex<double>>;
 
@@ -136,6 +146,24 @@ TEST_F(MatrixTests, conjugate) {
                                          5.0 - 1.0i, 6.0 - 1.0i}));
 }
 
+TEST_F(MatrixTests, dagger_real) {
+  using DMat = qengine::Matrix<double>;
+
+  DMat A(2, 3, {1.0, 2.0, 3.0, 4.0, 5.0, 6.0});
+
+  EXPECT_EQ(A.dagger(), A.transpose());
+  EXPECT_EQ(A.conjugate(), A);
+}
+
+TEST_F(MatrixTests, not_equal_shape) {
+  using DMat = qengine::Matrix<double>;
+
+  DMat A(2, 3, {1.0, 2.0, 3.0, 4.0, 5.0, 6.0});
+
+  EXPECT_TRUE(A != A.transpose());
+  EXPECT_FALSE(A != A);
+}
+
 TEST_F(MatrixTests, trace) {
   using DCmplx = std::complex<double>;
   using DCMat = qengine::Matrix<DCmplx>;
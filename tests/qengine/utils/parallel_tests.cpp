@@ -0,0 +1,143 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "parallel.h"
+
+class ParallelTests : public ::testing::Test {};
+
+TEST_F(ParallelTests, slices_cover_range) {
+  uint64_t next = 0;
+  for (uint64_t tid = 0; tid < 7; ++tid) {
+    const auto range = qengine::ThreadPool::slice(100, tid, 7);
+    EXPECT_EQ(range.first, next);
+    next = range.second;
+  }
+  EXPECT_EQ(next, 100);
+}
+
+TEST_F(ParallelTests, static_partition) {
+  qengine::ThreadPool pool(4, false);
+  std::vector<uint64_t> owner(1000);
+  std::vector<uint64_t> again(1000);
+  pool.run(1000, [&owner](uint64_t tid, uint64_t begin, uint64_t end) {
+    for (uint64_t i = begin; i < end; ++i)
+      owner[i] = tid;
+  });
+  pool.run(1000, [&again](uint64_t tid, uint64_t begin, uint64_t end) {
+    for (uint64_t i = begin; i < end; ++i)
+      again[i] = tid;
+  });
+
+  EXPECT_EQ(owner, again);
+  EXPECT_EQ(owner.front(), 0);
+  EXPECT_EQ(owner.back(), 3);
+}
+
+TEST_F(ParallelTests, nested_run_is_inline) {
+  qengine::ThreadPool pool(2, false);
+  std::atomic<uint64_t> count{0};
+  pool.run(2, [&pool, &count](uint64_t, uint64_t, uint64_t) {
+    pool.run(10, [&count](uint64_t, uint64_t begin, uint64_t end) {
+      count += end - begin;
+    });
+  });
+
+  EXPECT_EQ(count, 20);
+}
+
+TEST_F(ParallelTests, inline_run_keeps_partition) {
+  using Slices = std::vector<std::pair<uint64_t, uint64_t>>;
+  qengine::ThreadPool pool(3, false);
+  Slices pooled(3);
+  pool.run(100, [&pooled](uint64_t tid, uint64_t begin, uint64_t end) {
+    pooled[tid] = {begin, end};
+  });
+
+  std::mutex mutex;
+  std::vector<Slices> nested;
+  pool.run(3, [&pool, &mutex, &nested](uint64_t, uint64_t, uint64_t) {
+    Slices slices(3);
+    pool.run(100, [&slices](uint64_t tid, uint64_t begin, uint64_t end) {
+      slices[tid] = {begin, end};
+    });
+    std::lock_guard<std::mutex> lock(mutex);
+    nested.push_back(slices);
+  });
+
+  ASSERT_EQ(nested.size(), 3);
+  for (const auto & slices : nested)
+    EXPECT_EQ(slices, pooled);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST_F(ParallelTests, fork_after_use) {
+  qengine::ThreadPool pool(2, false);
+  std::atomic<uint64_t> count{0};
+  const auto job = [&count](uint64_t, uint64_t begin, uint64_t end) {
+    count += end - begin;
+  };
+  pool.run(10, job);
+
+  // the child has none of the workers; a hang ends with SIGALRM
+  const pid_t pid = ::fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    ::alarm(10);
+    count = 0;
+    pool.run(10, job);
+    ::_exit(count == 10 ? 0 : 1);
+  }
+  int status = 0;
+  ASSERT_EQ(::waitpid(pid, &status, 0), pid);
+  EXPECT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+
+  pool.run(10, job);
+  EXPECT_EQ(count, 20);
+}
+#endif
+
+TEST_F(ParallelTests, parallel_sum) {
+  const uint64_t n = 4 * qengine::kParallelThreshold;
+  const auto sum = qengine::parallel_sum<uint64_t>(
+      n, [](uint64_t begin, uint64_t end) {
+        uint64_t res = 0;
+        for (uint64_t i = begin; i < end; ++i)
+          res += i;
+        return res;
+      });
+
+  EXPECT_EQ(sum, n * (n - 1) / 2);
+}
@@ -0,0 +1,75 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "profiler.h"
+
+class ProfilerTests : public ::testing::Test {};
+
+TEST_F(ProfilerTests, record) {
+  qengine::Profiler profiler;
+  profiler.record("applyX", 0, 0, 100, 64, 16);
+  profiler.record("applyX", 1, 100, 300, 64, 16);
+  profiler.record("measure", 0, 400, 50, 8, 3);
+
+  const auto applyX = profiler.stats("applyX");
+  EXPECT_EQ(applyX.calls, 2);
+  EXPECT_EQ(applyX.nanoseconds, 400);
+  EXPECT_EQ(applyX.bytes, 128);
+  EXPECT_DOUBLE_EQ(applyX.gbytes_per_second(), 0.32);
+  EXPECT_DOUBLE_EQ(applyX.gflops(), 0.08);
+  EXPECT_EQ(profiler.stats().size(), 2);
+  EXPECT_EQ(profiler.stats("applyZ").calls, 0);
+
+  profiler.reset();
+  EXPECT_TRUE(profiler.stats().empty());
+}
+
+TEST_F(ProfilerTests, scope) {
+  qengine::Profiler profiler;
+  { qengine::ProfileScope scope(profiler, "applyZ", 0, 32, 6); }
+  profiler.enable(false);
+  { qengine::ProfileScope scope(profiler, "applyZ", 0, 32, 6); }
+
+  EXPECT_EQ(profiler.stats("applyZ").calls, 1);
+}
+
+TEST_F(ProfilerTests, report_and_trace) {
+  qengine::Profiler profiler;
+  profiler.enable_trace(true, 1);
+  profiler.record("applyX", 3, qengine::Profiler::now_ns(), 1000, 64, 16);
+  profiler.record("applyX", 3, qengine::Profiler::now_ns(), 1000, 64, 16);
+
+  std::ostringstream report;
+  profiler.report(report);
+  EXPECT_NE(report.str().find("applyX"), std::string::npos);
+
+  std::ostringstream trace;
+  profiler.chrome_trace(trace);
+  EXPECT_EQ(profiler.events().size(), 1);
+  EXPECT_NE(trace.str().find("\"tid\":3"), std::string::npos);
+  EXPECT_NE(trace.str().find("\"dur\":1.000"), std::string::npos);
+}
@@ -0,0 +1,61 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "matrix.h"
+#include "sparse_matrix.h"
+
+class SparseMatrixTests : public ::testing::Test {};
+
+TEST_F(SparseMatrixTests, triplets) {
+  qengine::SparseMatrix<double> A(3, 4, {
+    {2, 1, 5.0}, {0, 3, 1.0}, {0, 0, 2.0}, {2, 1, -1.0}});
+
+  EXPECT_EQ(A.nnz(), 3);
+  EXPECT_EQ(A(0, 0), 2.0);
+  EXPECT_EQ(A(0, 3), 1.0);
+  EXPECT_EQ(A(1, 2), 0.0);
+  EXPECT_EQ(A(2, 1), 4.0);
+  EXPECT_EQ(A.row_ptr(), std::vector<uint64_t>({0, 2, 2, 3}));
+}
+
+TEST_F(SparseMatrixTests, dense_roundtrip) {
+  qengine::Matrix<double> dense(2, 3, {1.0, 0.0, 0.0, 4.0, 3.0, 0.0});
+  qengine::SparseMatrix<double> A(dense);
+
+  EXPECT_EQ(A.nnz(), 3);
+  EXPECT_EQ(A.to_dense(), dense);
+}
+
+TEST_F(SparseMatrixTests, multiply) {
+  qengine::SparseMatrix<double> A(2, 2, {{0, 1, 2.0}, {1, 0, 3.0}});
+  const std::vector<std::complex<double>> x = {{1.0, 1.0}, {0.0, 2.0}};
+  const auto y = A * x;
+
+  EXPECT_EQ(y[0], std::complex<double>(0.0, 4.0));
+  EXPECT_EQ(y[1], std::complex<double>(3.0, 3.0));
+}
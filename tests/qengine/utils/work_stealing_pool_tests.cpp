@@ -0,0 +1,56 @@
+// Copyright (C) 2018 - 2019 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "work_stealing_pool.h"
+
+class WorkStealingPoolTests : public ::testing::Test {};
+
+TEST_F(WorkStealingPoolTests, nested_submit) {
+  qengine::WorkStealingPool pool(3);
+  std::atomic<uint64_t> count{0};
+  for (int k = 0; k < 10; ++k)
+    pool.submit([&pool, &count] {
+      for (int j = 0; j < 10; ++j)
+        pool.submit([&count] { ++count; });
+      ++count;
+    });
+  pool.wait();
+
+  EXPECT_EQ(count, 110);
+  EXPECT_EQ(pool.worker_index(), pool.nthreads());
+}
+
+TEST_F(WorkStealingPoolTests, rethrows) {
+  qengine::WorkStealingPool pool(2);
+  pool.submit([] { throw std::runtime_error("task"); });
+  pool.submit([] {});
+
+  EXPECT_THROW(pool.wait(), std::runtime_error);
+  pool.submit([] {});
+  EXPECT_NO_THROW(pool.wait());
+}